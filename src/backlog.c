@@ -0,0 +1,255 @@
+/*
+ * backlog.c	Keep reading the serial port while a menu is up.
+ *
+ *		When the terminal loop hands over to a menu, a dialog or
+ *		the file selector, nothing would read the port until it
+ *		comes back, and the driver throws data away once its
+ *		buffer is full. Instead, whenever wxgetch() has to wait
+ *		for a key, what comes in from the port is kept in a
+ *		backlog of up to "backlogsize" bytes. Back in terminal
+ *		mode the backlog goes through the emulator (and so into
+ *		the capture file) before anything newer.
+ *
+ *		Entry points:
+ *
+ *		backlog_start(fd)  - read fd while waiting for keys
+ *		backlog_stop()     - stop reading, keep what we have
+ *		backlog_pending()  - bytes waiting to be replayed
+ *		backlog_read(buf, size)
+ *		                   - take the oldest bytes out
+ *		backlog_clear()    - forget the backlog
+ *		backlog_lost()     - bytes dropped since the last call
+ *		backlog_wait(ms)   - sleep, but keep reading if active
+ *		backlog_key(ms)    - wait for a key, but keep reading
+ *		backlog_stats(...) - how full it got, and what was lost
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <poll.h>
+
+#include "port.h"
+#include "minicom.h"
+
+/* Limits for the "backlogsize" parameter. */
+#define BACKLOG_MIN	4096
+#define BACKLOG_MAX	(64 * 1024 * 1024)
+
+static int bl_fd = -1;
+static char *bl_buf;
+static int bl_size;
+static int bl_start;		/* Oldest byte */
+static int bl_len;		/* Bytes in the backlog */
+static long bl_lost;		/* Dropped because it was full */
+static long bl_hiwat;		/* Most bytes it ever held */
+static long bl_lostall;		/* Dropped, in all */
+
+/* Add data; when full, the oldest goes. */
+static void bl_add(const char *s, int len)
+{
+  int n, pos;
+
+  if (len > bl_size) {
+    bl_lost += len - bl_size;
+    bl_lostall += len - bl_size;
+    s += len - bl_size;
+    len = bl_size;
+  }
+  if (bl_len + len > bl_size) {
+    n = bl_len + len - bl_size;
+    bl_lost += n;
+    bl_lostall += n;
+    bl_start = (bl_start + n) % bl_size;
+    bl_len -= n;
+  }
+  while (len > 0) {
+    pos = (bl_start + bl_len) % bl_size;
+    n = bl_size - pos;
+    if (n > len)
+      n = len;
+    memcpy(bl_buf + pos, s, n);
+    bl_len += n;
+    s += n;
+    len -= n;
+  }
+  if (bl_len > bl_hiwat)
+    bl_hiwat = bl_len;
+}
+
+/*
+ * Called by wxgetch() instead of sleeping until a key is pressed.
+ */
+static void bl_wait(void)
+{
+  while (!backlog_key(-1))
+    ;
+}
+
+/*
+ * Wait up to ms milliseconds (-1: as long as it takes) for a key.
+ * If the backlog is active, what comes in from the port meanwhile
+ * goes into it. Returns 1 if a key can be read.
+ */
+int backlog_key(int ms)
+{
+  struct timeval start, now;
+  char *buf;
+  int size, n, x, left = ms;
+
+  gettimeofday(&start, NULL);
+  buf = io_rxbuf(&size);
+  do {
+    if (bl_fd < 0)
+      return (check_io(-1, 0, left, NULL, 0, NULL) & 2) != 0;
+    x = check_io(bl_fd, 0, ms < 0 ? 1000 : left, buf, size, &n);
+    if ((x & 1) && n > 0)
+      bl_add(buf, n);
+    else if ((x & 1) && n <= 0)
+      /* EOF or error: leave it to the terminal loop. */
+      backlog_stop();
+    if (x & 2)
+      return 1;
+    if (ms >= 0) {
+      gettimeofday(&now, NULL);
+      left = ms - (now.tv_sec - start.tv_sec) * 1000 -
+             (now.tv_usec - start.tv_usec) / 1000;
+    }
+  } while (ms < 0 || left > 0);
+  return 0;
+}
+
+/*
+ * Sleep for up to ms milliseconds. If the backlog is active, what
+ * comes in from the port meanwhile goes into it.
+ */
+void backlog_wait(int ms)
+{
+  char *buf;
+  int size, n, x;
+
+  if (bl_fd < 0) {
+    poll(NULL, 0, ms);
+    return;
+  }
+  buf = io_rxbuf(&size);
+  x = check_io(bl_fd, -1, ms, buf, size, &n);
+  if ((x & 1) && n > 0)
+    bl_add(buf, n);
+  else if (x & 1)
+    backlog_stop();
+}
+
+/*
+ * Start keeping what comes in on fd while the user is in a menu.
+ */
+void backlog_start(int fd)
+{
+  int size;
+
+  if (fd < 0)
+    return;
+  size = atoi(P_BACKLOGSIZE);
+  if (size < BACKLOG_MIN)
+    size = BACKLOG_MIN;
+  if (size > BACKLOG_MAX)
+    size = BACKLOG_MAX;
+
+  /* Only resize an empty backlog. */
+  if (size != bl_size && bl_len == 0) {
+    free(bl_buf);
+    bl_size = 0;
+    if ((bl_buf = malloc(size)) == NULL)
+      return;
+    bl_size = size;
+    bl_start = 0;
+  }
+  if (bl_buf == NULL)
+    return;
+  bl_fd = fd;
+  wxgetch_wait = bl_wait;
+}
+
+/*
+ * Stop reading the port, because the terminal loop or some other
+ * part of minicom takes over. The backlog stays until it is read.
+ */
+void backlog_stop(void)
+{
+  bl_fd = -1;
+  wxgetch_wait = NULL;
+}
+
+/*
+ * Bytes waiting to be replayed.
+ */
+int backlog_pending(void)
+{
+  return bl_len;
+}
+
+/*
+ * Take up to size of the oldest bytes out of the backlog.
+ */
+int backlog_read(char *buf, int size)
+{
+  int n, done = 0;
+
+  while (size > 0 && bl_len > 0) {
+    n = bl_size - bl_start;
+    if (n > bl_len)
+      n = bl_len;
+    if (n > size)
+      n = size;
+    memcpy(buf + done, bl_buf + bl_start, n);
+    bl_start = (bl_start + n) % bl_size;
+    bl_len -= n;
+    done += n;
+    size -= n;
+  }
+  if (bl_len == 0)
+    bl_start = 0;
+  return done;
+}
+
+/*
+ * Bytes that did not fit, since the last call.
+ */
+long backlog_lost(void)
+{
+  long n = bl_lost;
+
+  bl_lost = 0;
+  return n;
+}
+
+/*
+ * Forget the backlog, e.g. when a file transfer takes over the data.
+ */
+void backlog_clear(void)
+{
+  bl_start = 0;
+  bl_len = 0;
+}
+
+/*
+ * The size of the backlog, the most it ever held and how much was
+ * lost because it was full.
+ */
+void backlog_stats(long *size, long *hiwat, long *lost)
+{
+  *size = bl_size;
+  *hiwat = bl_hiwat;
+  *lost = bl_lostall;
+}
@@ -0,0 +1,418 @@
+/*
+ * bench.c	Throughput benchmark for the terminal pipeline.
+ *
+ *		Runs minicom on a pseudo terminal as its serial port and
+ *		another one as its screen, feeds it synthetic data from
+ *		the port side and counts what it writes to the screen.
+ *		Each workload gets a fresh minicom. Reported are the input
+ *		rate, CPU time of minicom per MB, and how many bytes went
+ *		to the screen per byte that came in.
+ *
+ *		Usage: minicom.bench [-s MB] [-t TERM] [path-to-minicom]
+ *
+ *		The data is made from a fixed seed, so runs can be
+ *		compared. "make bench" builds and runs it.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/* How long the screen must stay quiet before a run is over. */
+#define QUIET_MS	500
+/* Give up on a run after this long. */
+#define RUN_MAX_MS	120000
+
+#define COLS		80
+#define ROWS		25
+
+struct workload {
+  const char *name;
+  const char *flag;		/* Extra option for minicom */
+  void (*gen)(char *buf, long len);
+};
+
+static unsigned long seed;
+
+/* Same numbers every time. */
+static unsigned long rnd(void)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) & 0x7fff;
+}
+
+static const char *words[] = {
+  "usb", "device", "new", "high-speed", "using", "ehci_hcd", "address",
+  "eth0", "link", "up", "1000Mbps", "full", "duplex", "flow", "control",
+  "rx/tx", "mounted", "filesystem", "with", "ordered", "data", "mode",
+  "error", "timeout", "retrying", "ok", "done", "init", "probe", "of",
+};
+#define NWORDS	(int)(sizeof(words) / sizeof(words[0]))
+
+/* Lines of a kernel log. */
+static void gen_ascii(char *buf, long len)
+{
+  char line[128];
+  long pos = 0;
+  int n;
+
+  while (pos < len) {
+    n = sprintf(line, "[%6lu.%06lu]", rnd() % 100000, rnd() * 30UL);
+    while (n < 70)
+      n += sprintf(line + n, " %s", words[rnd() % NWORDS]);
+    n += sprintf(line + n, "\r\n");
+    if (n > len - pos)
+      n = len - pos;
+    memcpy(buf + pos, line, n);
+    pos += n;
+  }
+}
+
+/* Full screen programs: cursor moves, colours, clears and scrolls. */
+static void gen_redraw(char *buf, long len)
+{
+  char out[256];
+  long pos = 0;
+  int n, i;
+
+  while (pos < len) {
+    switch (rnd() % 8) {
+      case 0:
+        n = sprintf(out, "\033[H\033[2J");
+        break;
+      case 1:
+        n = sprintf(out, "\033[%lu;%luH\033[K", rnd() % ROWS + 1,
+                    rnd() % COLS + 1);
+        break;
+      case 2:
+        n = sprintf(out, "\033[%lu;%lum", rnd() % 8 + 30, rnd() % 8 + 40);
+        break;
+      case 3:
+        n = sprintf(out, "\033[%lu;%lur\033[%luS\033[r", rnd() % 5 + 1,
+                    rnd() % 10 + 10, rnd() % 3 + 1);
+        break;
+      case 4:
+        n = sprintf(out, "\033[1m\033[7m%s\033[0m", words[rnd() % NWORDS]);
+        break;
+      default:
+        n = sprintf(out, "\033[%lu;%luH", rnd() % ROWS + 1, rnd() % 40 + 1);
+        for (i = 0; i < 4; i++)
+          n += sprintf(out + n, "%s ", words[rnd() % NWORDS]);
+        break;
+    }
+    if (n > len - pos)
+      n = len - pos;
+    memcpy(buf + pos, out, n);
+    pos += n;
+  }
+}
+
+static const char *utf8[] = {
+  "\xc3\xa4", "\xc3\xb6", "\xc3\xbc", "\xc3\xa9", "\xce\xb1", "\xce\xb2",
+  "\xd0\x96", "\xe2\x94\x80", "\xe2\x94\x82", "\xe2\x82\xac",
+  "\xe6\x97\xa5", "\xe6\x9c\xac", "a", "b", " ", "x",
+};
+#define NUTF8	(int)(sizeof(utf8) / sizeof(utf8[0]))
+
+/* Text with accents, Greek, Cyrillic, box drawing and CJK. */
+static void gen_utf8(char *buf, long len)
+{
+  long pos = 0;
+  int n, col = 0;
+  const char *s;
+
+  while (pos < len) {
+    if (++col >= 70) {
+      s = "\r\n";
+      col = 0;
+    } else
+      s = utf8[rnd() % NUTF8];
+    n = strlen(s);
+    if (n > len - pos)
+      break;
+    memcpy(buf + pos, s, n);
+    pos += n;
+  }
+  memset(buf + pos, ' ', len - pos);
+}
+
+/* Line noise. */
+static void gen_binary(char *buf, long len)
+{
+  long pos;
+
+  for (pos = 0; pos < len; pos++)
+    buf[pos] = rnd() & 0xff;
+}
+
+static struct workload workloads[] = {
+  { "ascii",  NULL, gen_ascii },
+  { "redraw", NULL, gen_redraw },
+  { "utf8",   NULL, gen_utf8 },
+  { "binary", NULL, gen_binary },
+  { "hex",    "-wH", gen_ascii },	/* Wrapped, or it all goes on one line */
+};
+#define NWORKLOADS	(int)(sizeof(workloads) / sizeof(workloads[0]))
+
+static double now_ms(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/*
+ * Open a pseudo terminal, return the master. The slave is kept open
+ * too, so the master does not report a hangup before minicom opens it.
+ */
+static int open_pty(char *name, int size, int *slave)
+{
+  int fd;
+
+  if ((fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 ||
+      grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    perror("posix_openpt");
+    exit(1);
+  }
+  snprintf(name, size, "%s", ptsname(fd));
+  if ((*slave = open(name, O_RDWR | O_NOCTTY)) < 0) {
+    perror(name);
+    exit(1);
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(*slave, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+/* Read and count what there is. Returns the number of bytes. */
+static long drain(int fd)
+{
+  char buf[16384];
+  long total = 0;
+  int n;
+
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    total += n;
+  return total;
+}
+
+/* Start minicom with dev as its port and scr as its terminal. */
+static pid_t start(const char *minicom, const char *term, const char *dev,
+                   const char *scr, const char *flag, const char *home)
+{
+  struct winsize ws;
+  pid_t pid;
+  int fd;
+
+  if ((pid = fork()) != 0)
+    return pid;
+
+  setsid();
+  if ((fd = open(scr, O_RDWR)) < 0)
+    _exit(127);
+#ifdef TIOCSCTTY
+  ioctl(fd, TIOCSCTTY, 0);
+#endif
+  memset(&ws, 0, sizeof(ws));
+  ws.ws_col = COLS;
+  ws.ws_row = ROWS;
+  ioctl(fd, TIOCSWINSZ, &ws);
+  dup2(fd, 0);
+  dup2(fd, 1);
+  dup2(fd, 2);
+  if (fd > 2)
+    close(fd);
+  setenv("TERM", term, 1);
+  setenv("HOME", home, 1);
+  setenv("LANG", "C.UTF-8", 1);
+  unsetenv("LC_ALL");
+  unsetenv("MINICOM");
+  if (flag)
+    execl(minicom, minicom, "-o", flag, "-D", dev, (char *)NULL);
+  else
+    execl(minicom, minicom, "-o", "-D", dev, (char *)NULL);
+  _exit(127);
+}
+
+/*
+ * Wait until the screen has been quiet for QUIET_MS, counting what
+ * it gets. Returns the time the last byte came.
+ */
+static double settle(int scrfd, int devfd, long *scrbytes)
+{
+  struct pollfd fds[2];
+  double last = now_ms();
+
+  fds[0].fd = scrfd;
+  fds[0].events = POLLIN;
+  fds[1].fd = devfd;
+  fds[1].events = POLLIN;
+  while (poll(fds, 2, QUIET_MS) > 0) {
+    if (fds[0].revents & (POLLHUP | POLLERR))
+      break;
+    if (fds[0].revents & POLLIN) {
+      *scrbytes += drain(scrfd);
+      last = now_ms();
+    }
+    if (fds[1].revents & POLLIN)
+      drain(devfd);
+  }
+  return last;
+}
+
+static int run(const char *minicom, const char *term, const char *home,
+               struct workload *w, const char *data, long len)
+{
+  char devname[64], scrname[64];
+  struct pollfd fds[2];
+  struct rusage ru;
+  int devfd, scrfd, devslave, scrslave, status, n;
+  long pos = 0, scrbytes = 0;
+  double t0, t1, cpu, mb;
+  pid_t pid;
+
+  devfd = open_pty(devname, sizeof(devname), &devslave);
+  scrfd = open_pty(scrname, sizeof(scrname), &scrslave);
+  pid = start(minicom, term, devname, scrname, w->flag, home);
+  if (pid < 0) {
+    perror("fork");
+    return -1;
+  }
+
+  /* Let it draw its first screen. */
+  settle(scrfd, devfd, &scrbytes);
+  scrbytes = 0;
+
+  t0 = now_ms();
+  fds[0].fd = devfd;
+  fds[1].fd = scrfd;
+  fds[1].events = POLLIN;
+  while (pos < len && now_ms() - t0 < RUN_MAX_MS) {
+    fds[0].events = POLLOUT;
+    if (poll(fds, 2, 1000) < 0 && errno != EINTR)
+      break;
+    if (fds[1].revents & (POLLHUP | POLLERR))
+      break;
+    if (fds[1].revents & POLLIN)
+      scrbytes += drain(scrfd);
+    if (fds[0].revents & POLLOUT) {
+      n = write(devfd, data + pos, len - pos > 4096 ? 4096 : len - pos);
+      if (n > 0)
+        pos += n;
+    }
+    drain(devfd);
+  }
+  t1 = settle(scrfd, devfd, &scrbytes);
+
+  kill(pid, SIGKILL);
+  if (wait4(pid, &status, 0, &ru) < 0) {
+    perror("wait4");
+    return -1;
+  }
+  close(devfd);
+  close(scrfd);
+  close(devslave);
+  close(scrslave);
+
+  if (pos < len) {
+    fprintf(stderr, "%s: minicom stopped reading after %ld bytes\n",
+            w->name, pos);
+    return -1;
+  }
+  mb = len / (1024.0 * 1024.0);
+  cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+        ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+  if (t1 <= t0)
+    t1 = t0 + 1;
+  printf("%-8s %6.1f %8.3f %8.1f %10.4f %8.3f\n", w->name, mb,
+         (t1 - t0) / 1000.0, mb * 1000.0 / (t1 - t0), cpu / mb,
+         (double)scrbytes / len);
+  return 0;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-s MB] [-t TERM] [path-to-minicom]\n", prog);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  const char *minicom = "./minicom", *term = "vt100";
+  char home[] = "/tmp/minicom.benchXXXXXX";
+  long len = 4L * 1024 * 1024;
+  int c, i, err = 0;
+  char *data;
+
+  while ((c = getopt(argc, argv, "s:t:")) != EOF) {
+    switch (c) {
+      case 's':
+        len = (long)(atof(optarg) * 1024 * 1024);
+        break;
+      case 't':
+        term = optarg;
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (optind < argc)
+    minicom = argv[optind++];
+  if (optind < argc || len <= 0)
+    usage(argv[0]);
+  if (access(minicom, X_OK) < 0) {
+    perror(minicom);
+    return 1;
+  }
+
+  /* An empty home, so no personal configuration gets in the way. */
+  if (mkdtemp(home) == NULL) {
+    perror("mkdtemp");
+    return 1;
+  }
+  if ((data = malloc(len)) == NULL) {
+    perror("malloc");
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("%-8s %6s %8s %8s %10s %8s\n",
+         "workload", "MB", "seconds", "MB/s", "CPU s/MB", "out/in");
+  for (i = 0; i < NWORKLOADS; i++) {
+    seed = 1;
+    workloads[i].gen(data, len);
+    if (run(minicom, term, home, &workloads[i], data, len) < 0)
+      err = 1;
+    fflush(stdout);
+  }
+
+  free(data);
+  rmdir(home);
+  return err;
+}
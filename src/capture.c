@@ -0,0 +1,226 @@
+/*
+ * capture.c	Buffered writing of the capture file.
+ *
+ *		Received data is collected in a buffer and written out in
+ *		one go when the buffer is full, when the oldest byte in it
+ *		has waited for "capflushms" milliseconds, or when capturing
+ *		stops. A crash signal still gets the buffer to disk.
+ *
+ *		Entry points:
+ *
+ *		capture_open(name)   - start capturing to a file
+ *		capture_close()      - flush and close the capture file
+ *		capture_isopen()     - is there a capture file?
+ *		capture_write(s, len), capture_putc(c)
+ *		                     - add data to the buffer
+ *		capture_flush()      - write out the buffer now
+ *		capture_tick()       - flush if the latency is exceeded
+ *		capture_timeout()    - milliseconds until the next flush
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+
+/* Limits for the "capbufsize" parameter. */
+#define CAPBUF_MIN	512
+#define CAPBUF_MAX	(16 * 1024 * 1024)
+
+static int cap_fd = -1;
+static int cap_ready;		/* Buffer set up from the parameters */
+static char *cap_buf;
+static int cap_size;		/* Size of cap_buf, 0 to write through */
+static int cap_len;		/* Bytes waiting in cap_buf */
+static int cap_latency;		/* Max. milliseconds a byte may wait */
+static struct timeval cap_since; /* When the oldest byte came in */
+
+/* Write everything out; also used from the crash handler. */
+static void cap_drain(const char *s, int len)
+{
+  int n;
+  int bytes = len;
+  INSTR_START(t);
+
+  while (len > 0) {
+    n = write(cap_fd, s, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break; /* Disk full or such: drop it, like stdio would. */
+    s += n;
+    len -= n;
+  }
+  INSTR_END(IN_CAPTURE, t, bytes - len);
+}
+
+/* Save the buffer when we crash, then die as we would have. */
+static void cap_crash(int sig)
+{
+  if (cap_fd >= 0 && cap_len > 0)
+    cap_drain(cap_buf, cap_len);
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+/*
+ * Set up the buffer. This is done on the first write, as the -C
+ * option opens the file before the configuration has been read.
+ */
+static void cap_setup(void)
+{
+  static int crash_installed;
+  int size;
+
+  size = atoi(P_CAPBUFSIZE);
+  if (size < CAPBUF_MIN)
+    size = CAPBUF_MIN;
+  if (size > CAPBUF_MAX)
+    size = CAPBUF_MAX;
+  if ((cap_buf = malloc(size)) == NULL)
+    size = 0;
+  cap_size = size;
+  cap_len = 0;
+  cap_latency = atoi(P_CAPFLUSHMS);
+  if (cap_latency < 0)
+    cap_latency = 0;
+  cap_ready = 1;
+
+  if (!crash_installed) {
+    signal(SIGSEGV, cap_crash);
+    signal(SIGBUS, cap_crash);
+    signal(SIGFPE, cap_crash);
+    signal(SIGILL, cap_crash);
+    signal(SIGABRT, cap_crash);
+    crash_installed = 1;
+  }
+}
+
+/*
+ * Open a capture file for appending.
+ */
+int capture_open(const char *name)
+{
+  if (cap_fd >= 0)
+    capture_close();
+  if ((cap_fd = open(name, O_WRONLY | O_CREAT | O_APPEND, 0666)) < 0)
+    return -1;
+  return 0;
+}
+
+/*
+ * Is a capture file open?
+ */
+int capture_isopen(void)
+{
+  return cap_fd >= 0;
+}
+
+/*
+ * Write out what is in the buffer.
+ */
+void capture_flush(void)
+{
+  if (cap_fd < 0 || cap_len == 0)
+    return;
+  cap_drain(cap_buf, cap_len);
+  PROBE1(capture_flush, cap_len);
+  cap_len = 0;
+}
+
+/*
+ * Flush and close the capture file.
+ */
+void capture_close(void)
+{
+  if (cap_fd < 0)
+    return;
+  capture_flush();
+  close(cap_fd);
+  cap_fd = -1;
+  free(cap_buf);
+  cap_buf = NULL;
+  cap_size = 0;
+  cap_ready = 0;
+}
+
+/*
+ * Add data to the capture buffer.
+ */
+void capture_write(const char *s, int len)
+{
+  int n;
+
+  if (cap_fd < 0 || len <= 0)
+    return;
+  if (!cap_ready)
+    cap_setup();
+  if (cap_len == 0)
+    gettimeofday(&cap_since, NULL);
+
+  while (len > 0) {
+    if (cap_len == cap_size) {
+      capture_flush();
+      if (cap_size == 0) {
+        cap_drain(s, len);
+        return;
+      }
+    }
+    n = cap_size - cap_len;
+    if (n > len)
+      n = len;
+    memcpy(cap_buf + cap_len, s, n);
+    cap_len += n;
+    s += n;
+    len -= n;
+  }
+}
+
+void capture_putc(int c)
+{
+  char ch = c;
+
+  if (cap_fd >= 0 && cap_len > 0 && cap_len < cap_size)
+    cap_buf[cap_len++] = ch;
+  else
+    capture_write(&ch, 1);
+}
+
+/*
+ * Milliseconds until the buffer has to be flushed, -1 if it is empty.
+ */
+int capture_timeout(void)
+{
+  struct timeval now;
+  long ms;
+
+  if (cap_fd < 0 || cap_len == 0)
+    return -1;
+  gettimeofday(&now, NULL);
+  ms = (now.tv_sec - cap_since.tv_sec) * 1000 +
+       (now.tv_usec - cap_since.tv_usec) / 1000;
+  if (ms >= cap_latency)
+    return 0;
+  return cap_latency - ms;
+}
+
+/*
+ * Called from the main loop: flush if data has waited long enough.
+ */
+void capture_tick(void)
+{
+  if (capture_timeout() == 0)
+    capture_flush();
+}
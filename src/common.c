@@ -81,48 +81,3 @@ void do_log(const char *line, ...)
   (void)line;
 #endif
 }
-
-/* mbtowc (), except that mbtowc (.. , "", ..) == 1, errors are treated as
- * (wchar_t)*s */
-size_t one_mbtowc(wchar_t *pwc, const char *s, size_t n)
-{
-  int len;
-
-  len = mbtowc(pwc, s, n);
-  if (len == -1)
-    *pwc = *s;
-  if (len <= 0)
-    len = 1;
-  return len;
-}
-
-/* wctomb (), except that mbtowc (.. , 0) == 1, errors are treated as
- * *s = (char)wchar */
-size_t
-one_wctomb(char *s, wchar_t wchar)
-{
-  int len;
-
-  len = wctomb(s, wchar);
-  if (len == -1)
-    s[0] = (char)wchar;
-  if (len <= 0)
-    len = 1;
-  return len;
-}
-
-/* Number of characters in S */
-size_t
-mbslen(const char *s)
-{
-  size_t len;
-
-  len = 0;
-  while (*s != 0) {
-    wchar_t wc;
-
-    s += one_mbtowc(&wc, s, MB_LEN_MAX);
-    len++;
-  }
-  return len;
-}
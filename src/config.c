@@ -841,7 +841,7 @@ static void doscrkeyb(void)
   char *background_color_term = _(" H - Background Color (term):");
   char *foreground_color_stat = _(" I - Foreground Color (stat):");
   char *background_color_stat = _(" J - Background Color (stat):");
-  char *history_buffer_size   = _(" K - History Buffer Size    :");
+  char *history_buffer_size   = _(" K - History Buffer (MiB)   :");
   char *macros_file           = _(" L - Macros file            :");
   char *macros_enabled        = _(" N - Macros enabled         :");
   char *character_conversion  = _(" O - Character conversion   :");
@@ -869,7 +869,7 @@ static void doscrkeyb(void)
   mc_wprintf(w, "%s %s\n", background_color_stat, _(J_col[sbcolor]));
 
   /* MARK updated 02/17/95 - Configurable history buffer size */
-  mc_wprintf(w, "%s %s\n", history_buffer_size, P_HISTSIZE);
+  mc_wprintf(w, "%s %s\n", history_buffer_size, P_HISTMEM);
 
   /* fmg - macros support */
   mc_wprintf(w, "%s %s\n", macros_file, P_MACROS);
@@ -930,21 +930,6 @@ static void doscrkeyb(void)
         /* fmg - I'll let them change sfcolor=sbcolor because it's just
            another way of turning "off" the status line... */
 
-        /* MARK updated 02/17/95, Warn user to restart */
-        /* minicom if they changed history buffer size */
-        if (atoi(P_HISTSIZE) != num_hist_lines) {
-          w1 = mc_wopen(14, 9, 70, 15, BSINGLE, stdattr, mfcolor, mbcolor, 0, 0, 1);
-          mc_wtitle(w1, TMID, _("History Buffer Size"));
-          mc_wputs(w1, _("\n\
-                You have changed the history buffer size.\n\
-                You will need to save the configuration file and\n\
-                restart minicom for the change to take effect.\n\n\
-                Hit a key to Continue... "));
-          mc_wredraw(w1, 1);
-          c = wxgetch();
-          mc_wclose(w1, 1);
-        }
-
         mc_wclose(w, 1);
         /* If status line enabled/disabled resize screen. */
         if (P_STATLINE[0] != old_stat)
@@ -1095,19 +1080,16 @@ static void doscrkeyb(void)
         break;
       case 'K': /* MARK updated 02/17/95 - Config history size */
         pgets(w, mbslen (history_buffer_size) + 1, 10,
-              P_HISTSIZE, 6, 6, 0);
+              P_HISTMEM, 6, 6, 0);
 
-        /* In case gibberish or a value was out of bounds, */
-        /* limit history buffer size between 0 to 5000 lines */
-        /* 5000 line history at 80 columns consumes about */
-        /* 800 kilobytes including chars and attrs bytes! */
-        if (atoi(P_HISTSIZE) <= 0) 
-          strcpy(P_HISTSIZE,"0");
-        else if (atoi(P_HISTSIZE) >= 5000)
-          strcpy(P_HISTSIZE,"5000");
+        /* The history is kept packed, in at most this many MiB. */
+        /* Gibberish turns it off; the change is made right away. */
+        if (atol(P_HISTMEM) <= 0)
+          strcpy(P_HISTMEM, "0");
+        hist_apply();
 
         mc_wlocate(w, mbslen (history_buffer_size) + 1, 10);
-        mc_wprintf(w, "%s     ", P_HISTSIZE);
+        mc_wprintf(w, "%s     ", P_HISTMEM);
         break;
       case 'L': /* fmg - get local macros storage file */
         pgets(w, mbslen (macros_file) + 1, 11, P_MACROS, 64, 64, 1);
@@ -1856,6 +1838,7 @@ void doconv(void)
       case 'F':
         strcpy(P_CONVCAP, yesno(P_CONVCAP[0] == 'N'));
         markch(P_CONVCAP);
+        vt_std.mapcap = P_CONVCAP[0] == 'Y';
         redraw = 1;
         break;
     }
@@ -144,7 +144,7 @@ enum config_type {
 #define P_MACENAB	mpars[76].value	 /* macros enabled flag */
 
 #define P_SOUND		mpars[77].value
-#define P_HISTSIZE      mpars[78].value  /* History buffer size */
+#define P_HISTSIZE      mpars[78].value  /* Old history size, unused */
 
 #define P_CONVF		mpars[79].value  /* Char.conversion table */
 #define P_CONVCAP	mpars[80].value  /* Use conversion on capture file */
@@ -168,6 +168,23 @@ enum config_type {
 
 #define P_ANSWERBACK    mpars[92].value  /* User defined answerback string */
 
+#define P_RXBUFSIZE     mpars[93].value  /* Size of the receive buffer */
+#define P_CAPBUFSIZE    mpars[94].value  /* Size of the capture buffer */
+#define P_CAPFLUSHMS    mpars[95].value  /* Max. delay of capture data */
+#define P_FPS           mpars[96].value  /* Screen updates per second */
+#define P_RXTHREAD      mpars[97].value  /* Read the port in a thread */
+#define P_RXRINGSIZE    mpars[98].value  /* Its ring buffer, in MiB */
+#define P_BACKLOGSIZE   mpars[99].value  /* Data kept while in a menu */
+#define P_TICKLESS      mpars[100].value /* No wakeups when idle */
+#define P_TXPOLICY      mpars[101].value /* Output queue full: wait/drop/abort */
+#define P_TXQMAX        mpars[102].value /* Output queue limit, bytes */
+#define P_SHOWSTATS     mpars[103].value /* Rate and errors in status line */
+#define P_LATRATE       mpars[104].value /* Latency probes per second */
+#define P_LATPAYLOAD    mpars[105].value /* What a latency probe sends */
+#define P_HISTMEM       mpars[106].value /* History buffer budget, MiB */
+#define P_HISTDIR       mpars[107].value /* Keep the history in files here */
+#define P_HISTDISK      mpars[108].value /* Their budget, MiB */
+
 /* fmg - macros struct */
 
 #define P_MAC1          mmacs[0].value
@@ -173,14 +173,27 @@ const char* change_baud(const char *s)
  * Functions to talk to the modem.
  */
 
+/* Queue what mputs() has collected so far. */
+static void mflush(char *out, int *len)
+{
+  if (*len > 0)
+    txq_write(out, *len, 0);
+  *len = 0;
+}
+
 /*
  * Send a string to the modem.
- * If how == 0, '~'  sleeps 1 second.
- * If how == 1, "^~" sleeps 1 second.
+ * If how == 0, '~'  waits 1 second.
+ * If how == 1, "^~" waits 1 second.
+ * The string is queued in the bulk lane; the main loop or the dialer
+ * sends it, with as many characters as possible in one write.
  */
 void mputs(const char *s, int how)
 {
   char c;
+  char out[128];
+  int len = 0;
+  int lane = txq_lane(TXQ_BULK);
 
   while (*s) {
     if (*s == '^' && (*(s + 1))) {
@@ -188,7 +201,8 @@ void mputs(const char *s, int how)
       if (*s == '^')
         c = *s;
       else if (how == 1 && *s == '~') {
-        sleep(1);
+        mflush(out, &len);
+        txq_pause(1000);
         s++;
         continue;
       } else
@@ -200,16 +214,20 @@ void mputs(const char *s, int how)
           c = *s;
           break;
         case 'U':
+          mflush(out, &len);
           if (dial_user && *dial_user)
             mputs (dial_user, how);
           s++;
           continue;
         case 'P':
+          mflush(out, &len);
           if (dial_pass && *dial_pass)
             mputs (dial_pass, how);
           s++;
           continue;
         case 'B': /* line speed change. */
+          mflush(out, &len);
+          txq_drain();
           s = change_baud(++s);
           continue;
         case 'L': /* toggle linefeed addition */
@@ -221,7 +239,10 @@ void mputs(const char *s, int how)
           s++; /* again, move along. */
           continue;
 	case 'G': /* run a script */
+	  mflush(out, &len);
+	  txq_drain();
 	  runscript(0, s + 1, "", "");
+	  txq_lane(lane);
 	  return;
         default:
           s++;
@@ -229,13 +250,18 @@ void mputs(const char *s, int how)
       }
     } else
       c = *s;
-    if (how == 0 && c == '~')
-      sleep(1);
-    else
-      if (write(portfd, &c, 1) != 1)
-        break;
+    if (how == 0 && c == '~') {
+      mflush(out, &len);
+      txq_pause(1000);
+    } else {
+      if (len == (int)sizeof(out))
+        mflush(out, &len);
+      out[len++] = c;
+    }
     s++;
   }
+  mflush(out, &len);
+  txq_lane(lane);
 }
 
 /*
@@ -260,13 +286,18 @@ void modeminit(void)
 void modemreset(void)
 {
   WIN *w;
+  int lane;
 
   if (P_MRESET[0] == '\0')
     return;
 
   w = mc_tell(_("Resetting Modem"));
   mputs(P_MRESET, 0);
-  sleep(1);
+  /* mputs() queues in the bulk lane, so the wait goes after it there. */
+  lane = txq_lane(TXQ_BULK);
+  txq_pause(1000);
+  txq_lane(lane);
+  txq_drain();
   mc_wclose(w, 1);
 }
 
@@ -276,7 +307,7 @@ void modemreset(void)
 void hangup(void)
 {
   WIN *w;
-  int sec=1;
+  int sec=1, lane;
 
   w = mc_tell(_("Hanging up"));
 
@@ -294,7 +325,10 @@ void hangup(void)
     m_dtrtoggle(portfd, sec);   /* jl 23.06.97 */
   } else {
     mputs(P_MHANGUP, 0);
-    sleep(1);
+    lane = txq_lane(TXQ_BULK);
+    txq_pause(1000);
+    txq_lane(lane);
+    txq_drain();
   }
 #ifdef _DCDFLOW
   /* DCD has dropped, turn off hw flow control. */
@@ -428,7 +462,9 @@ long dial(struct dialent *d, struct dialent **d2)
   char *reason = _("Max retries");
   time_t now, last;
   struct tm *ptime;
-  char buf[128];
+  char *buf;
+  int buf_size;
+  int tmout;
   char modbuf[128];
   /*  char logline[128]; */
 
@@ -439,6 +475,10 @@ long dial(struct dialent *d, struct dialent **d2)
     return(retst);
   }
 
+  /* We read the modem ourselves from here on. What came in before
+   * goes to the screen and the capture file first, ahead of CONNECT. */
+  term_replay();
+
   dialwin = mc_wopen(18, 9, 62, 16, BSINGLE, stdattr, mfcolor, mbcolor, 0, 0, 1);
   mc_wtitle(dialwin, TMID, _("Autodial"));
   mc_wcursor(dialwin, CNONE);
@@ -502,6 +542,7 @@ MainLoop:
     mc_wputs(dialwin, _("\n\n\n Escape to cancel, space to retry."));
 
     /* Start the dial */
+    txq_drain();
     m_flush(portfd);
     switch (d->dialtype) {
       case 0:
@@ -524,12 +565,18 @@ MainLoop:
     /* Wait 'till the modem says something */
     modbuf[0] = 0;
     modidx = 0;
+    buf = io_rxbuf(&buf_size);
     s = buf;
     buf[0] = 0;
     while (dialtime > 0) {
       if (*s == 0) {
-        x = check_io(portfd_connected, 0, 1000, buf, sizeof(buf), NULL);
+        /* Wake up for the next character of a paced dial string. */
+        tmout = txq_timeout();
+        if (tmout < 0 || tmout > 1000)
+          tmout = 1000;
+        x = check_io(portfd_connected, 0, tmout, buf, buf_size, NULL);
         s = buf;
+        txq_run();
       }
       if (x & 2) {
         f = keyboard(KGETKEY, 0);
@@ -541,6 +588,7 @@ MainLoop:
         if (f == ' ') {
           mputs(P_MDIALCAN, 0);
           dialfailed(_("Cancelled"), 4);
+          txq_drain();
           m_flush(portfd);
           break;
         }
@@ -0,0 +1,265 @@
+/*
+ * histbench.c	Benchmark for the history store and its search.
+ *
+ *		Fills a history with generated log lines, then looks for
+ *		a word that is only in the last line (and one that is
+ *		only in the first, going back), the way the scroll back
+ *		buffer does: with hist_find() over the text the store
+ *		keeps, as a word and as a regular expression, and the
+ *		old way, unpacking every line, making it a wide string
+ *		and calling wcsstr() on it. Last, it counts the lines
+ *		with a word that is in many of them, as the scroll back
+ *		buffer does for its "hit 12 of 340". Then, as after a
+ *		resize, it shows the lines at other widths: how long it
+ *		takes to count the rows and get the last screen full.
+ *		One line in 16 is marked as wrapping into the next.
+ *
+ *		Usage: histbench [-n lines] [-d file]
+ *
+ *		The default is a million lines in memory; with -d, the
+ *		history is kept in that file, which is removed before
+ *		and after. If a search does not find its word, that
+ *		is an error: it says so, and exits 1.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+
+#include <locale.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#define COLS_	80
+
+static unsigned long seed;
+
+/* Same numbers every time. */
+static unsigned long rnd(void)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) & 0x7fff;
+}
+
+static const char *words[] = {
+  "usb", "device", "new", "high-speed", "using", "address", "eth0",
+  "link", "up", "full", "duplex", "mounted", "filesystem", "with",
+  "error", "timeout", "retrying", "ok", "done", "init", "probe", "of",
+};
+#define NWORDS	(int)(sizeof(words) / sizeof(words[0]))
+
+/* Line n: a time stamp and some words, with s in it if not NULL. */
+static void gen_line(ELM *line, long n, const char *s)
+{
+  char buf[COLS_ * 2];
+  int i, len;
+
+  len = sprintf(buf, "[%8ld.%06ld] ", n / 1000, (n % 1000) * 997);
+  while (len < COLS_ - 24) {
+    len += sprintf(buf + len, "%s ", words[rnd() % NWORDS]);
+    if (rnd() % 8 == 0)
+      len += sprintf(buf + len, "%lu ", rnd());
+  }
+  if (s)
+    len += sprintf(buf + len, "%s", s);
+  for (i = 0; i < COLS_; i++) {
+    line[i].value = i < len ? buf[i] : ' ';
+    line[i].attr = XA_NORMAL;
+    line[i].color = 0x70;
+  }
+}
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* The old way: each line into a wide string, both in upper case. */
+static long old_find(struct hist *h, const wchar_t *look, int case_matters)
+{
+  ELM line[COLS_];
+  wchar_t text[COLS_ + 1], pat[COLS_ + 1];
+  long n, lines = hist_lines(h);
+  int i;
+
+  for (i = 0; look[i]; i++)
+    pat[i] = case_matters ? look[i] : (wchar_t)towupper(look[i]);
+  pat[i] = 0;
+  for (n = 0; n < lines; n++) {
+    if (hist_get(h, n, line, COLS_) < 0)
+      continue;
+    for (i = 0; i < COLS_; i++)
+      text[i] = case_matters ? line[i].value : (wchar_t)towupper(line[i].value);
+    text[i] = 0;
+    if (wcsstr(text, pat))
+      return n;
+  }
+  return -1;
+}
+
+/* The history file and its index. */
+static void remove_files(const char *file)
+{
+  char name[PATH_MAX];
+
+  unlink(file);
+  snprintf(name, sizeof(name), "%s.idx", file);
+  unlink(name);
+}
+
+/* Print the time of a search; 1 if it did not find the needle. */
+static int report(const char *what, long found, double secs, long lines)
+{
+  if (found < 0) {
+    printf("  %-28s NOT FOUND\n", what);
+    return 1;
+  }
+  printf("  %-28s line %8ld  %8.1f ms  %7.0f Mlines/s\n", what, found,
+         secs * 1e3, lines / secs / 1e6);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  struct hist *h;
+  struct hfind *f;
+  ELM line[COLS_], row[MAXCOLS];
+  long lines = 1000000, n, found, used;
+  long long disk, raw;
+  const char *file = NULL;
+  double t, t2;
+  int c, i, width, bad = 0;
+
+  while ((c = getopt(argc, argv, "n:d:")) != EOF) {
+    switch (c) {
+      case 'n':
+        lines = atol(optarg);
+        break;
+      case 'd':
+        file = optarg;
+        break;
+      default:
+        fprintf(stderr, "Usage: histbench [-n lines] [-d file]\n");
+        return 1;
+    }
+  }
+  if (lines < 2)
+    lines = 2;
+  setlocale(LC_CTYPE, "");
+
+  /* Enough to keep them all. */
+  if ((h = hist_open(1L << 30)) == NULL) {
+    fprintf(stderr, "histbench: out of memory\n");
+    return 1;
+  }
+  if (file) {
+    remove_files(file);
+    if (hist_file(h, file, 1LL << 40) < 0) {
+      perror(file);
+      return 1;
+    }
+  }
+
+  t = now();
+  for (n = 0; n < lines; n++) {
+    gen_line(line, n, n == 0 ? "Needle First" : n == lines - 1 ? "Needle Last" : NULL);
+    hist_add(h, line, COLS_, n % 16 == 7);
+  }
+  t = now() - t;
+  hist_stats(h, &used, &disk, &raw);
+  printf("%ld lines added in %.0f ms, %.0f ns a line\n", lines, t * 1e3,
+         t * 1e9 / lines);
+  printf("  %lld MB as ELMs, kept in %.1f MB of memory", raw >> 20, used / 1048576.0);
+  if (disk)
+    printf(" and %.1f MB on disk", disk / 1048576.0);
+  printf("\nfind \"Needle Last\" from the first line, \"Needle First\" from the last\n");
+
+  f = hist_findopen(L"Needle Last", 0, 0, NULL, 0);
+  t = now();
+  found = hist_find(h, f, 0, lines - 1);
+  bad += report("hist_find, case matters", found, now() - t, lines);
+  hist_findclose(f);
+
+  f = hist_findopen(L"needle last", 1, 0, NULL, 0);
+  t = now();
+  found = hist_find(h, f, 0, lines - 1);
+  bad += report("hist_find, no case", found, now() - t, lines);
+  hist_findclose(f);
+
+  f = hist_findopen(L"Needle First", 0, 0, NULL, 0);
+  t = now();
+  found = hist_find(h, f, lines - 1, 0);
+  bad += report("hist_find, going back", found, now() - t, lines);
+  hist_findclose(f);
+
+  f = hist_findopen(L"Need[a-z]+ La?st", 0, 1, NULL, 0);
+  t = now();
+  found = hist_find(h, f, 0, lines - 1);
+  bad += report("hist_find, regex", found, now() - t, lines);
+  hist_findclose(f);
+
+  f = hist_findopen(L"need[a-z]+ la?st", 1, 1, NULL, 0);
+  t = now();
+  found = hist_find(h, f, 0, lines - 1);
+  bad += report("hist_find, regex, no case", found, now() - t, lines);
+  hist_findclose(f);
+
+  t = now();
+  found = old_find(h, L"Needle Last", 1);
+  bad += report("line by line, case matters", found, now() - t, lines);
+
+  t = now();
+  found = old_find(h, L"needle last", 0);
+  bad += report("line by line, no case", found, now() - t, lines);
+
+  f = hist_findopen(L"timeout", 0, 0, NULL, 0);
+  t = now();
+  for (found = 0, n = hist_find(h, f, 0, lines - 1); n >= 0; ) {
+    found++;
+    n = n < lines - 1 ? hist_find(h, f, n + 1, lines - 1) : -1;
+  }
+  t = now() - t;
+  printf("  %-28s %ld lines  %8.1f ms\n", "count \"timeout\"", found, t * 1e3);
+  hist_findclose(f);
+
+  f = hist_findopen(L"Needle Last", 0, 0, NULL, 0);
+  printf("shown at another width\n");
+  for (i = 0; i < 3; i++) {
+    width = i == 0 ? 132 : i == 1 ? 60 : COLS_;
+    hist_width(h, width);
+    t = now();
+    n = hist_lines(h);
+    t = now() - t;
+    t2 = now();
+    for (found = n > 50 ? n - 50 : 0; found < n; found++)
+      hist_get(h, found, row, width);
+    t2 = now() - t2;
+    printf("  %3d columns: %8ld rows, counted in %7.1f ms, last 50 in %5.2f ms\n",
+           width, n, t * 1e3, t2 * 1e3);
+    t = now();
+    found = hist_find(h, f, 0, n - 1);
+    bad += report("hist_find", found, now() - t, n);
+  }
+  hist_findclose(f);
+
+  hist_close(h);
+  if (file)
+    remove_files(file);
+  return bad != 0;
+}
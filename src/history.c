@@ -0,0 +1,2180 @@
+/*
+ * history.c	The scrollback store.
+ *
+ *		A line that leaves the top of the screen is not kept as
+ *		a row of ELMs, but as its text and the runs of equal
+ *		attributes, with the blank end cut off. Lines go into a
+ *		chunk of up to HIST_CHUNK bytes; a full chunk is packed
+ *		with a small LZ77 coder and stays packed until a line
+ *		in it is looked at. The last few chunks that were looked
+ *		at are kept unpacked. When the store uses more than its
+ *		budget, the oldest chunks are thrown away.
+ *
+ *		With hist_file(), the packed chunks go to a file instead,
+ *		which is read through mmap(), so only the open chunk and
+ *		the cache take memory. The file only grows; next to it
+ *		is an index with, for every HIST_GROUP lines, where the
+ *		chunk with the first of them starts, so a line is found
+ *		without a search. The file header has the narrowest and
+ *		widest line in the file, and whether its last line goes
+ *		on, so they are known without reading the chunks. When
+ *		the file is at half the disk
+ *		budget, it becomes name.1 and a new one is started; an
+ *		older name.1 goes. A store that opens the same file
+ *		again has the lines that were in it.
+ *
+ *		A line is stored as (numbers are LEB128 varints)
+ *
+ *		  bytes  cells  flags  fill-attr fill-color  used
+ *		  { attr color n  n * character }  ...  until used
+ *
+ *		where "bytes" is the size of the rest, "cells" the width
+ *		of the line and the cells after "used" are blanks in the
+ *		fill attributes. HL_WRAP in flags says that the text went
+ *		on in the next line, because it did not fit.
+ *
+ *		Lines are stored as wide as the screen was. Shown at
+ *		another width (hist_width(), after a resize), a run of
+ *		lines that wrapped into each other is one long line that
+ *		is wrapped again, and a line that was wider is cut in
+ *		pieces; lines as wide as the screen is now are shown as
+ *		they are. What is stored is not changed;
+ *		the rows each chunk gives are counted when needed and
+ *		kept in a table, so only chunks that were added or lost
+ *		their first line are counted again.
+ *
+ *		Next to the records, a chunk has the text of its lines
+ *		for searching: the characters up to "used", in lower case
+ *		and UTF-8, each line ending in a newline. It is packed on
+ *		its own, so a search unpacks only the text and runs over
+ *		one piece of memory per chunk, not line by line. For a
+ *		regular expression the byte after the text is set to 0
+ *		while it runs, so there is room for one more.
+ *
+ *		Entry points:
+ *
+ *		hist_open(budget) - a new store of at most budget bytes
+ *		hist_close(h)     - free it
+ *		hist_file(h, name, disk)
+ *		                  - keep the lines in file name, and
+ *		                    name.1, using at most disk bytes
+ *		hist_budget(h, budget)
+ *		                  - change the budget
+ *		hist_add(h, line, len, wrap)
+ *		                  - add a line of len cells; with wrap, the
+ *		                    next one goes on with its text
+ *		hist_width(h, width)
+ *		                  - show the lines at this width
+ *		hist_lines(h)     - number of lines kept, as shown
+ *		hist_get(h, no, buf, width)
+ *		                  - line no (0 is the oldest) into width cells
+ *		hist_stats(h, &used, &disk, &raw)
+ *		                  - bytes used in memory and on disk, and
+ *		                    what the lines would take as ELMs
+ *		hist_findopen(pattern, fold, regex, err, errlen)
+ *		                  - compile a search, case-less with fold;
+ *		                    the text as it is, or with regex an
+ *		                    extended regular expression
+ *		hist_findclose(f) - free it
+ *		hist_find(h, f, from, to)
+ *		                  - first line from "from" to "to" (either
+ *		                    way) that has the pattern
+ *		hist_match(f, line, len)
+ *		                  - whether a line of len cells has it
+ *		hist_marks(f, line, len, mark)
+ *		                  - which of its cells are in a match
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <regex.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+#include "port.h"
+#include "minicom.h"
+#include "intl.h"
+
+#define HIST_CHUNK	65536		/* Unpacked size of records, and text */
+#define HIST_LINEMAX	(MAXCOLS * 9 + 16) /* Largest line record */
+#define HIST_TEXTMAX	(MAXCOLS * 4 + 1)  /* Largest line text */
+#define HIST_CACHE	4		/* Chunks kept unpacked */
+#define HIST_JOIN	64		/* Most lines wrapped into one */
+#define HL_WRAP		1		/* Flag: the line goes on in the next */
+#define LZ_HASHBITS	12
+
+#define HIST_GROUP	16		/* Lines per entry of the file index */
+#define HIST_FMAGIC	"MCHIST4\n"	/* Start of a history file */
+#define HIST_CMAGIC	0x4b48434dU	/* Start of a chunk in it */
+#define HIST_FSHAPE	((int)sizeof(HIST_FMAGIC) - 1) /* Its shape */
+#define HIST_FHEAD	(HIST_FSHAPE + (int)sizeof(uint32_t))
+#define HIST_MAPMIN	(1L << 20)	/* Least that is mapped */
+
+struct hchunk {
+  long first;			/* Number of its first line */
+  int lines;
+  int size;			/* Bytes in data: records, then text */
+  int rec, prec;		/* Bytes of records, and of them in data */
+  int text, ptext;		/* The same for the text */
+  long cells;			/* Cells in its lines */
+  int wlo, whi;			/* Narrowest and widest line */
+  int wrap;			/* Its last line goes on in the next */
+  unsigned char *data;		/* A part is packed if it got smaller */
+};
+
+struct hcache {
+  long first;			/* Chunk in here, -1 if none */
+  unsigned char *raw;		/* Records, and the text at HIST_CHUNK */
+  int hasrec, hastext;		/* Which of them are unpacked */
+  int *offs;			/* Where each record starts in raw */
+  int *toffs;			/* Where its text starts, and one more */
+  int maxoffs;
+  unsigned age;
+};
+
+/* A chunk in a file: this header, then the data. */
+struct hdisk {
+  uint32_t magic;
+  uint32_t first;		/* Its first line in the file */
+  uint32_t lines;
+  uint32_t rec, prec;		/* Bytes of records, and packed */
+  uint32_t text, ptext;		/* The same for the text */
+  uint32_t shape;		/* Narrowest and widest line, and wrap */
+  uint64_t cells;		/* Cells in the file up to its end */
+};
+
+#define SHAPE(lo, hi, wrap)	((uint32_t)(lo) | (uint32_t)(hi) << 12 | \
+				 (uint32_t)(wrap) << 24)
+#define SHAPE_LO(s)		(int)((s) & 0xfff)
+#define SHAPE_HI(s)		(int)(((s) >> 12) & 0xfff)
+#define SHAPE_WRAP(s)		(int)(((s) >> 24) & 1)
+#define SHAPE_NONE		SHAPE(MAXCOLS, 0, 0)
+
+/* A sealed chunk as it is shown: how many rows it gives. */
+struct hview {
+  long first;			/* Number of its first line */
+  int lines;
+  int wlo, whi, wrap;		/* As in struct hchunk */
+  long rows;			/* -1 if not counted yet */
+  long before;			/* Rows of the chunks before it */
+};
+
+/* A history file, and its index of uint64_t offsets. */
+struct hseg {
+  int fd, ifd;			/* -1 if there is no file */
+  unsigned char *map;
+  size_t mapped;
+  off_t size;			/* Bytes in the file */
+  uint64_t *idx;
+  size_t imapped;
+  long groups;			/* Entries in the index */
+  long first;			/* Number of its first line */
+  long lines;
+  long long cells;
+  uint32_t shape;		/* Of all its chunks, as in the header */
+};
+
+struct hist {
+  long budget;
+  long used;			/* Bytes in chunks and their index */
+  long first;			/* Number of the oldest line */
+  long next;			/* Number of the next line */
+  long long cells;		/* Cells in the lines kept */
+
+  struct hchunk *chunks;	/* Packed chunks are chunks[c0 .. nchunks-1] */
+  int c0, nchunks, maxchunks;
+
+  unsigned char *open;		/* The chunk being filled, text at HIST_CHUNK */
+  int openlen, opentlen;
+  int *openoffs, *opentoffs;
+  int openlines, maxopen;
+  long openfirst;
+  long opencells;
+  int openlo, openhi;		/* Narrowest and widest line in it */
+
+  struct hcache cache[HIST_CACHE];
+  unsigned clock;
+
+  char *name;			/* The file, NULL if there is none */
+  long long disk;		/* Its budget */
+  struct hseg seg[2];		/* name.1 and name */
+
+  int width;			/* Shown at, 0 for as stored */
+  int wlo, whi;			/* Narrowest and widest line ever kept */
+  int lastwrap;			/* The last line goes on in the next */
+  int join;			/* Lines wrapped into the last one */
+  long jfirst;			/* Where that run of lines starts */
+  struct hview *view;		/* Sealed chunks, if viewed */
+  int nview, maxview;
+  int viewed;			/* The table is there */
+  int sums;			/* view[0 .. sums-1].before are right */
+  long openrows;		/* Rows of the open chunk, -1 if not known */
+  long vline, vrow;		/* A line that starts a run, and its row */
+};
+
+/* A compiled search. */
+struct hfind {
+  int fold;
+  unsigned char *pat;		/* In lower case, as in the text */
+  int len;
+  int skip[256];
+  unsigned char *exact;		/* As given, if not fold */
+  int elen;
+  int eskip[256];
+  int regex;			/* Compiled: 1 re, 2 ere as well */
+  regex_t re;			/* Case-less, for the text */
+  regex_t ere;			/* As given, if not fold */
+};
+
+/* Fixed cost of a store: the open chunk and the cache. */
+#define HIST_FIXED	((HIST_CACHE + 1) * 2 * HIST_CHUNK)
+#define DISK_SIZE(d)	((d)->prec + (d)->ptext)
+
+static unsigned char *put_num(unsigned char *p, unsigned long n)
+{
+  while (n >= 0x80) {
+    *p++ = (n & 0x7f) | 0x80;
+    n >>= 7;
+  }
+  *p++ = n;
+  return p;
+}
+
+static const unsigned char *get_num(const unsigned char *p,
+                                    const unsigned char *end,
+                                    unsigned long *n)
+{
+  int shift = 0;
+
+  *n = 0;
+  while (p < end && shift < 35) {
+    *n |= (unsigned long)(*p & 0x7f) << shift;
+    if ((*p++ & 0x80) == 0)
+      return p;
+    shift += 7;
+  }
+  return NULL;
+}
+
+/*
+ * LZ77, in the way of LZ4: a token with the number of literals in
+ * the high and the match length - 4 in the low nibble, more length
+ * in bytes of 255 where a nibble is 15, the literals, and a two byte
+ * offset. The last sequence has only literals. Returns the packed
+ * size, or -1 if that is not smaller.
+ */
+static int lz_len(unsigned char **op, unsigned char *end, int n)
+{
+  unsigned char *o = *op;
+
+  for (; n >= 255; n -= 255) {
+    if (o >= end)
+      return -1;
+    *o++ = 255;
+  }
+  if (o >= end)
+    return -1;
+  *o++ = n;
+  *op = o;
+  return 0;
+}
+
+static int lz_emit(unsigned char **op, unsigned char *end,
+                   const unsigned char *lit, int nlit, int off, int mlen)
+{
+  unsigned char *o = *op, *token;
+
+  if (o >= end)
+    return -1;
+  token = o++;
+  *token = (nlit < 15 ? nlit : 15) << 4;
+  if (nlit >= 15 && lz_len(&o, end, nlit - 15) < 0)
+    return -1;
+  if (o + nlit > end)
+    return -1;
+  memcpy(o, lit, nlit);
+  o += nlit;
+  if (mlen) {
+    mlen -= 4;
+    *token |= mlen < 15 ? mlen : 15;
+    if (o + 2 > end)
+      return -1;
+    *o++ = off & 0xff;
+    *o++ = off >> 8;
+    if (mlen >= 15 && lz_len(&o, end, mlen - 15) < 0)
+      return -1;
+  }
+  *op = o;
+  return 0;
+}
+
+static int lz_pack(const unsigned char *in, int n, unsigned char *out)
+{
+  int tab[1 << LZ_HASHBITS];
+  unsigned char *o = out, *end = out + n - 1;
+  unsigned int v;
+  int i = 0, anchor = 0, ref, len, h;
+
+  memset(tab, 0xff, sizeof(tab));
+  while (i + 4 <= n) {
+    memcpy(&v, in + i, 4);
+    h = (v * 2654435761U) >> (32 - LZ_HASHBITS);
+    ref = tab[h];
+    tab[h] = i;
+    if (ref < 0 || i - ref > 65535 || memcmp(in + ref, in + i, 4) != 0) {
+      i++;
+      continue;
+    }
+    for (len = 4; i + len < n && in[ref + len] == in[i + len]; len++)
+      ;
+    if (lz_emit(&o, end, in + anchor, i - anchor, i - ref, len) < 0)
+      return -1;
+    i += len;
+    anchor = i;
+  }
+  if (lz_emit(&o, end, in + anchor, n - anchor, 0, 0) < 0)
+    return -1;
+  return o - out;
+}
+
+static int lz_count(const unsigned char **ip, const unsigned char *end,
+                    int n)
+{
+  const unsigned char *p = *ip;
+  int c;
+
+  if (n == 15) {
+    do {
+      if (p >= end)
+        return -1;
+      n += c = *p++;
+    } while (c == 255);
+  }
+  *ip = p;
+  return n;
+}
+
+/* Returns the unpacked size, or -1 if the data is damaged. */
+static int lz_unpack(const unsigned char *in, int n, unsigned char *out,
+                     int size)
+{
+  const unsigned char *p = in, *end = in + n;
+  unsigned char *o = out, *oend = out + size;
+  int token, nlit, mlen, off, i;
+
+  while (p < end) {
+    token = *p++;
+    if ((nlit = lz_count(&p, end, token >> 4)) < 0 ||
+        p + nlit > end || o + nlit > oend)
+      return -1;
+    memcpy(o, p, nlit);
+    o += nlit;
+    p += nlit;
+    if (p == end)
+      break;
+    if (p + 2 > end)
+      return -1;
+    off = p[0] | (p[1] << 8);
+    p += 2;
+    if ((mlen = lz_count(&p, end, token & 15)) < 0)
+      return -1;
+    mlen += 4;
+    if (off == 0 || off > o - out || o + mlen > oend)
+      return -1;
+    if (off >= mlen)
+      memcpy(o, o - off, mlen);
+    else {
+      /* Overlaps what it makes: byte by byte. */
+      for (i = 0; i < mlen; i++)
+        o[i] = o[i - off];
+    }
+    o += mlen;
+  }
+  return o - out;
+}
+
+
+/* The cells before the blanks that end the line like its last cell. */
+static int line_used(const ELM *line, int len)
+{
+  const ELM *e;
+  int used;
+
+  for (used = len; used > 0; used--) {
+    e = line + used - 1;
+    if (e->value != ' ' || e->attr != line[len - 1].attr ||
+        e->color != line[len - 1].color)
+      break;
+  }
+  return used;
+}
+
+/* n bytes of in into out, packed if that makes them smaller. */
+static int part_pack(const unsigned char *in, int n, unsigned char *out)
+{
+  int size;
+
+  if ((size = lz_pack(in, n, out)) < 0) {
+    memcpy(out, in, n);
+    size = n;
+  }
+  return size;
+}
+
+static int part_unpack(const unsigned char *in, int psize,
+                       unsigned char *out, int size)
+{
+  if (psize == size) {
+    memcpy(out, in, size);
+    return 0;
+  }
+  return lz_unpack(in, psize, out, HIST_CHUNK) == size ? 0 : -1;
+}
+
+/* Put a line into rec, returns the bytes used. */
+static int line_pack(const ELM *line, int len, int flags, unsigned char *rec)
+{
+  unsigned char body[HIST_LINEMAX], *p = body, *q;
+  const ELM *e, *end;
+  int used, n, i;
+  char attr, color;
+
+  if (len > MAXCOLS)
+    len = MAXCOLS;
+  attr = len ? line[len - 1].attr : 0;
+  color = len ? line[len - 1].color : 0;
+  used = line_used(line, len);
+  p = put_num(p, len);
+  *p++ = flags;
+  *p++ = attr;
+  *p++ = color;
+  p = put_num(p, used);
+  for (e = line, end = line + used; e < end; e += n) {
+    for (n = 1; e + n < end && e[n].attr == e->attr &&
+                e[n].color == e->color; n++)
+      ;
+    *p++ = e->attr;
+    *p++ = e->color;
+    p = put_num(p, n);
+    for (i = 0; i < n; i++)
+      p = put_num(p, (unsigned int)e[i].value);
+  }
+  q = put_num(rec, p - body);
+  memcpy(q, body, p - body);
+  return q - rec + (p - body);
+}
+
+/* The size of the record at p, -1 if it is damaged. */
+static int line_size(const unsigned char *p, const unsigned char *end)
+{
+  const unsigned char *q;
+  unsigned long n;
+
+  if ((q = get_num(p, end, &n)) == NULL || n > (unsigned long)(end - q))
+    return -1;
+  return q - p + n;
+}
+
+/* Fill width cells from the record at p. -1 if it is damaged. */
+static int line_unpack(const unsigned char *p, const unsigned char *end,
+                       ELM *buf, int width)
+{
+  unsigned long n, used, done, c;
+  ELM fill, *e = buf, *bend = buf + width;
+  char attr, color;
+  int size;
+
+  if ((size = line_size(p, end)) < 0)
+    return -1;
+  end = p + size;
+  p = get_num(p, end, &n);
+  /* The width it had and the flags; not needed to fill a line. */
+  if ((p = get_num(p, end, &n)) == NULL || p + 3 > end)
+    return -1;
+  p++;
+  fill.value = ' ';
+  fill.attr = *p++;
+  fill.color = *p++;
+  if ((p = get_num(p, end, &used)) == NULL)
+    return -1;
+  for (done = 0; done < used; ) {
+    if (p + 2 > end)
+      return -1;
+    attr = *p++;
+    color = *p++;
+    if ((p = get_num(p, end, &n)) == NULL)
+      return -1;
+    for (; n > 0 && done < used; n--, done++) {
+      if ((p = get_num(p, end, &c)) == NULL)
+        return -1;
+      if (e < bend) {
+        e->value = c;
+        e->attr = attr;
+        e->color = color;
+        e++;
+      }
+    }
+  }
+  while (e < bend)
+    *e++ = fill;
+  return 0;
+}
+
+/*
+ * Of the record at p, the width, the cells before the blank end and
+ * the blank; returns the flags, or -1 if it is damaged.
+ */
+static int line_head(const unsigned char *p, const unsigned char *end,
+                     int *cells, int *used, ELM *fill)
+{
+  unsigned long n;
+  int size, flags;
+
+  if ((size = line_size(p, end)) < 0)
+    return -1;
+  end = p + size;
+  p = get_num(p, end, &n);
+  if ((p = get_num(p, end, &n)) == NULL || p + 3 > end)
+    return -1;
+  *cells = n;
+  flags = *p++;
+  fill->value = ' ';
+  fill->attr = *p++;
+  fill->color = *p++;
+  if ((p = get_num(p, end, &n)) == NULL)
+    return -1;
+  *used = n < (unsigned long)*cells ? (int)n : *cells;
+  return flags;
+}
+
+static int put_utf8(unsigned char *s, unsigned long c)
+{
+  if (c < 0x80) {
+    s[0] = c;
+    return 1;
+  }
+  if (c < 0x800) {
+    s[0] = 0xc0 | (c >> 6);
+    s[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  if (c > 0x10ffff)
+    c = 0xfffd;
+  if (c < 0x10000) {
+    s[0] = 0xe0 | (c >> 12);
+    s[1] = 0x80 | ((c >> 6) & 0x3f);
+    s[2] = 0x80 | (c & 0x3f);
+    return 3;
+  }
+  s[0] = 0xf0 | (c >> 18);
+  s[1] = 0x80 | ((c >> 12) & 0x3f);
+  s[2] = 0x80 | ((c >> 6) & 0x3f);
+  s[3] = 0x80 | (c & 0x3f);
+  return 4;
+}
+
+/*
+ * The text of len cells as a search sees it, in UTF-8 and with fold
+ * in lower case. Control characters become blanks. Returns the bytes
+ * put in s, at most len * 4. If at is not NULL, at[i] is where cell
+ * i starts in s.
+ */
+static int line_text(const ELM *line, int len, int fold, unsigned char *s,
+                     int *at)
+{
+  unsigned char *p = s;
+  unsigned long c;
+  int i;
+
+  for (i = 0; i < len; i++) {
+    if (at)
+      at[i] = p - s;
+    c = (unsigned long)(unsigned int)line[i].value;
+    if (c < ' ')
+      c = ' ';
+    else if (fold)
+      c = c < 0x80 ? (unsigned long)tolower((int)c) :
+                     (unsigned long)towlower((wint_t)c);
+    p += put_utf8(p, c);
+  }
+  return p - s;
+}
+
+/*
+ * The table of rows a chunk gives when shown. It is only there once
+ * the store is shown at a width some of its lines do not have.
+ */
+static int view_add(struct hist *h, long first, int lines, uint32_t shape)
+{
+  struct hview *v;
+  int max;
+
+  if (h->nview == h->maxview) {
+    max = h->maxview ? h->maxview * 2 : 64;
+    if ((v = realloc(h->view, max * sizeof(struct hview))) == NULL)
+      return -1;
+    h->view = v;
+    h->maxview = max;
+  }
+  v = &h->view[h->nview++];
+  v->first = first;
+  v->lines = lines;
+  v->wlo = SHAPE_LO(shape);
+  v->whi = SHAPE_HI(shape);
+  v->wrap = SHAPE_WRAP(shape);
+  v->rows = -1;
+  h->openrows = -1;
+  h->vline = -1;
+  return 0;
+}
+
+/* Chunk i has to be counted again. */
+static void view_dirty(struct hist *h, int i)
+{
+  h->view[i].rows = -1;
+  if (h->sums > i)
+    h->sums = i;
+  h->openrows = -1;
+  h->vline = -1;
+}
+
+/* Lines before the first that is kept went: so did their chunks. */
+static void view_trim(struct hist *h)
+{
+  int n;
+
+  if (!h->viewed)
+    return;
+  for (n = 0; n < h->nview && h->view[n].first + h->view[n].lines <= h->first;
+       n++)
+    ;
+  if (n == 0)
+    return;
+  h->nview -= n;
+  memmove(h->view, h->view + n, h->nview * sizeof(struct hview));
+  /* Its first lines may have gone on from one that is gone. */
+  if (h->nview > 0)
+    view_dirty(h, 0);
+  h->sums = 0;
+  h->openrows = -1;
+  h->vline = -1;
+}
+
+static void hist_drop(struct hist *h)
+{
+  struct hchunk *c = &h->chunks[h->c0++];
+
+  h->first = c->first + c->lines;
+  h->cells -= c->cells;
+  h->used -= c->size + sizeof(struct hchunk);
+  free(c->data);
+  if (h->c0 == h->nchunks)
+    h->c0 = h->nchunks = 0;
+}
+
+/* Throw away the oldest chunks until the store fits its budget. */
+static void hist_trim(struct hist *h)
+{
+  while (h->used + HIST_FIXED > h->budget && h->c0 < h->nchunks)
+    hist_drop(h);
+  view_trim(h);
+}
+
+static void seg_init(struct hseg *s)
+{
+  memset(s, 0, sizeof(struct hseg));
+  s->fd = s->ifd = -1;
+}
+
+static void seg_close(struct hseg *s)
+{
+  if (s->map)
+    munmap(s->map, s->mapped);
+  if (s->idx)
+    munmap(s->idx, s->imapped);
+  /* This also lets go of the lock. */
+  if (s->fd >= 0)
+    close(s->fd);
+  if (s->ifd >= 0)
+    close(s->ifd);
+  seg_init(s);
+}
+
+/*
+ * Have at least need bytes of fd mapped, doubling what is mapped as
+ * the file grows. Returns the new map, or NULL (and the old one stays).
+ */
+static void *map_grow(int fd, void *map, size_t *mapped, size_t need)
+{
+  size_t n = *mapped ? *mapped : HIST_MAPMIN;
+  void *m;
+
+  if (need <= *mapped)
+    return map;
+  while (n < need)
+    n *= 2;
+  if ((m = mmap(NULL, n, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    return NULL;
+  if (map)
+    munmap(map, *mapped);
+  *mapped = n;
+  return m;
+}
+
+/* The header of the chunk at off. -1 if there is none there. */
+static int seg_chunk(struct hseg *s, off_t off, struct hdisk *d)
+{
+  if (off < HIST_FHEAD || off + (off_t)sizeof(struct hdisk) > s->size)
+    return -1;
+  memcpy(d, s->map + off, sizeof(struct hdisk));
+  if (d->magic != HIST_CMAGIC || d->lines == 0 ||
+      d->rec > HIST_CHUNK || d->prec > d->rec ||
+      d->text > HIST_CHUNK || d->ptext > d->text ||
+      off + (off_t)sizeof(struct hdisk) + DISK_SIZE(d) > s->size)
+    return -1;
+  return 0;
+}
+
+/* Shape a with the chunk of shape b after it. */
+static uint32_t shape_add(uint32_t a, uint32_t b)
+{
+  int lo = SHAPE_LO(a), hi = SHAPE_HI(a);
+
+  if (SHAPE_LO(b) < lo)
+    lo = SHAPE_LO(b);
+  if (SHAPE_HI(b) > hi)
+    hi = SHAPE_HI(b);
+  return SHAPE(lo, hi, SHAPE_WRAP(b));
+}
+
+/* Start the file over, with only its header. */
+static int seg_head(struct hseg *s)
+{
+  unsigned char head[HIST_FHEAD];
+
+  s->shape = SHAPE_NONE;
+  memcpy(head, HIST_FMAGIC, HIST_FSHAPE);
+  memcpy(head + HIST_FSHAPE, &s->shape, sizeof(uint32_t));
+  if (pwrite(s->fd, head, HIST_FHEAD, 0) != HIST_FHEAD)
+    return -1;
+  s->size = HIST_FHEAD;
+  return 0;
+}
+
+/* Index the chunk at off, which has lines first .. first + lines - 1. */
+static int seg_index(struct hseg *s, uint64_t off, long first, long lines)
+{
+  uint64_t buf[256];
+  void *m;
+  long g, n;
+
+  for (g = s->groups; g * HIST_GROUP < first + lines; g += n) {
+    for (n = 0; n < 256 && (g + n) * HIST_GROUP < first + lines; n++)
+      buf[n] = off;
+    if (pwrite(s->ifd, buf, n * sizeof(uint64_t),
+               (off_t)g * sizeof(uint64_t)) != (ssize_t)(n * sizeof(uint64_t)))
+      return -1;
+  }
+  if (g == s->groups)
+    return 0;
+  if ((m = map_grow(s->ifd, s->idx, &s->imapped,
+                    g * sizeof(uint64_t))) == NULL)
+    return -1;
+  s->idx = m;
+  s->groups = g;
+  return 0;
+}
+
+/*
+ * Open history file name and its index; with create, make it if it
+ * is not there and lock it. What follows the last whole chunk (from
+ * a minicom that was killed while writing) is cut off, and a bad
+ * index is made again. -1 with errno set on error.
+ */
+static int seg_open(struct hseg *s, const char *name, int create)
+{
+  char iname[PATH_MAX], magic[HIST_FSHAPE];
+  struct stat st;
+  struct hdisk d;
+  off_t off;
+  void *m;
+  int e;
+
+  snprintf(iname, sizeof(iname), "%s.idx", name);
+  if ((s->fd = open(name, create ? O_RDWR | O_CREAT : O_RDWR, 0600)) < 0)
+    goto fail;
+  if (create && flock(s->fd, LOCK_EX | LOCK_NB) < 0)
+    goto fail;
+  if (fstat(s->fd, &st) < 0)
+    goto fail;
+  s->size = st.st_size;
+  if (s->size == 0) {
+    if (seg_head(s) < 0)
+      goto fail;
+  } else if (s->size < HIST_FSHAPE ||
+             pread(s->fd, magic, HIST_FSHAPE, 0) != HIST_FSHAPE) {
+    errno = EINVAL;
+    goto fail;
+  } else if (memcmp(magic, HIST_FMAGIC, HIST_FSHAPE) != 0 ||
+             s->size < HIST_FHEAD) {
+    /* Not ours: leave it alone. One of an older minicom starts over. */
+    if (!create || memcmp(magic, HIST_FMAGIC, HIST_FSHAPE - 2) != 0) {
+      errno = EINVAL;
+      goto fail;
+    }
+    if (ftruncate(s->fd, 0) < 0 || seg_head(s) < 0)
+      goto fail;
+  } else if (pread(s->fd, &s->shape, sizeof(uint32_t), HIST_FSHAPE) !=
+             sizeof(uint32_t))
+    goto fail;
+  if ((m = map_grow(s->fd, NULL, &s->mapped, s->size)) == NULL)
+    goto fail;
+  s->map = m;
+
+  if ((s->ifd = open(iname, O_RDWR | O_CREAT, 0600)) < 0 ||
+      fstat(s->ifd, &st) < 0)
+    goto fail;
+  s->groups = st.st_size / sizeof(uint64_t);
+  if (s->groups > 0) {
+    if ((m = map_grow(s->ifd, NULL, &s->imapped,
+                      s->groups * sizeof(uint64_t))) == NULL)
+      goto fail;
+    s->idx = m;
+  }
+
+  /*
+   * The index is right up to its last entry; the rest is checked.
+   * The shape in the header may not have the chunks after that yet.
+   */
+  off = HIST_FHEAD;
+  if (s->groups > 0) {
+    off = s->idx[s->groups - 1];
+    if (seg_chunk(s, off, &d) == 0 &&
+        d.first <= (s->groups - 1) * HIST_GROUP &&
+        d.first + d.lines > (s->groups - 1) * HIST_GROUP)
+      s->lines = d.first;
+    else {
+      off = HIST_FHEAD;
+      s->groups = 0;
+      if (ftruncate(s->ifd, 0) < 0)
+        goto fail;
+    }
+  }
+  while (seg_chunk(s, off, &d) == 0 && d.first == s->lines) {
+    if (seg_index(s, off, d.first, d.lines) < 0)
+      goto fail;
+    s->lines += d.lines;
+    s->cells = d.cells;
+    s->shape = shape_add(s->shape, d.shape);
+    off += sizeof(struct hdisk) + DISK_SIZE(&d);
+  }
+  if (off < s->size) {
+    if (ftruncate(s->fd, off) < 0)
+      goto fail;
+    s->size = off;
+  }
+  return 0;
+
+fail:
+  e = errno;
+  seg_close(s);
+  errno = e;
+  return -1;
+}
+
+/* Write a chunk to the end of the file. */
+static int seg_append(struct hseg *s, const struct hchunk *c)
+{
+  struct hdisk d;
+  off_t off = s->size;
+  void *m;
+
+  d.magic = HIST_CMAGIC;
+  d.first = s->lines;
+  d.lines = c->lines;
+  d.rec = c->rec;
+  d.prec = c->prec;
+  d.text = c->text;
+  d.ptext = c->ptext;
+  d.shape = SHAPE(c->wlo, c->whi, c->wrap);
+  d.cells = s->cells + c->cells;
+  if (pwrite(s->fd, &d, sizeof(d), off) != sizeof(d) ||
+      pwrite(s->fd, c->data, c->size, off + sizeof(d)) != c->size ||
+      (m = map_grow(s->fd, s->map, &s->mapped,
+                    off + sizeof(d) + c->size)) == NULL)
+    return -1;
+  s->map = m;
+  s->size = off + sizeof(d) + c->size;
+  s->lines += c->lines;
+  s->cells = d.cells;
+  s->shape = shape_add(s->shape, d.shape);
+  if (pwrite(s->fd, &s->shape, sizeof(uint32_t), HIST_FSHAPE) !=
+      sizeof(uint32_t))
+    return -1;
+  /* Without it, the index is made again when the file is opened. */
+  return seg_index(s, off, d.first, c->lines);
+}
+
+/* The file is full: it becomes name.1, and a new one is started. */
+static int hist_rotate(struct hist *h)
+{
+  char old[PATH_MAX], iname[PATH_MAX], iold[PATH_MAX];
+  struct hseg *s = &h->seg[1];
+
+  snprintf(old, sizeof(old), "%s.1", h->name);
+  snprintf(iname, sizeof(iname), "%s.idx", h->name);
+  snprintf(iold, sizeof(iold), "%s.1.idx", h->name);
+  if (rename(h->name, old) < 0 || rename(iname, iold) < 0)
+    return -1;
+  h->first = s->first;
+  h->cells -= h->seg[0].cells;
+  seg_close(&h->seg[0]);
+  h->seg[0] = *s;
+  seg_init(s);
+  view_trim(h);
+  if (seg_open(s, h->name, 1) < 0) {
+    s->first = h->seg[0].first + h->seg[0].lines;
+    return -1;
+  }
+  s->first = h->seg[0].first + h->seg[0].lines;
+  return 0;
+}
+
+/* Put a sealed chunk in the file. */
+static int hist_write(struct hist *h, const struct hchunk *c)
+{
+  struct hseg *s = &h->seg[1];
+
+  if (s->lines > 0 &&
+      s->size + (long long)sizeof(struct hdisk) + c->size > h->disk / 2 &&
+      hist_rotate(h) < 0)
+    goto fail;
+  if (seg_append(s, c) < 0)
+    goto fail;
+  return 0;
+
+fail:
+  /* From now on, new lines are kept in memory. */
+  h->disk = 0;
+  return -1;
+}
+
+/* Keep a sealed chunk in memory. */
+static int hist_keep(struct hist *h, struct hchunk *c)
+{
+  struct hchunk *n;
+  unsigned char *d;
+  int max;
+
+  if (h->nchunks == h->maxchunks) {
+    if (h->c0 > 0) {
+      memmove(h->chunks, h->chunks + h->c0,
+              (h->nchunks - h->c0) * sizeof(struct hchunk));
+      h->nchunks -= h->c0;
+      h->c0 = 0;
+    } else {
+      max = h->maxchunks ? h->maxchunks * 2 : 64;
+      if ((n = realloc(h->chunks, max * sizeof(struct hchunk))) == NULL)
+        return -1;
+      h->chunks = n;
+      h->maxchunks = max;
+    }
+  }
+  if (c->size < c->rec + c->text && (d = realloc(c->data, c->size)) != NULL)
+    c->data = d;
+  h->chunks[h->nchunks++] = *c;
+  h->used += c->size + sizeof(struct hchunk);
+  return 0;
+}
+
+/* Pack the open chunk and start a new one. -1 if out of memory. */
+static int hist_seal(struct hist *h)
+{
+  struct hchunk c;
+
+  c.first = h->openfirst;
+  c.lines = h->openlines;
+  c.rec = h->openlen;
+  c.text = h->opentlen;
+  c.cells = h->opencells;
+  c.wlo = h->openlo;
+  c.whi = h->openhi;
+  c.wrap = h->lastwrap;
+  if ((c.data = malloc(c.rec + c.text)) == NULL)
+    return -1;
+  c.prec = part_pack(h->open, c.rec, c.data);
+  c.ptext = part_pack(h->open + HIST_CHUNK, c.text, c.data + c.prec);
+  c.size = c.prec + c.ptext;
+  if (h->disk > 0 && hist_write(h, &c) == 0)
+    free(c.data);
+  else if (hist_keep(h, &c) < 0) {
+    free(c.data);
+    return -1;
+  }
+  if (h->viewed &&
+      view_add(h, c.first, c.lines, SHAPE(c.wlo, c.whi, c.wrap)) < 0) {
+    free(h->view);
+    h->view = NULL;
+    h->nview = h->maxview = h->viewed = 0;
+  }
+
+  h->openfirst += h->openlines;
+  h->openlen = 0;
+  h->opentlen = 0;
+  h->openlines = 0;
+  h->opencells = 0;
+  h->openlo = MAXCOLS;
+  h->openhi = 0;
+  hist_trim(h);
+  return 0;
+}
+
+/*
+ * A new store that uses at most budget bytes. NULL if there is no
+ * memory for it.
+ */
+struct hist *hist_open(long budget)
+{
+  struct hist *h;
+  int i;
+
+  if ((h = calloc(1, sizeof(struct hist))) == NULL)
+    return NULL;
+  if ((h->open = malloc(2 * HIST_CHUNK + 1)) == NULL) {
+    free(h);
+    return NULL;
+  }
+  for (i = 0; i < HIST_CACHE; i++)
+    h->cache[i].first = -1;
+  h->openlo = h->wlo = MAXCOLS;
+  h->openrows = h->vline = -1;
+  seg_init(&h->seg[0]);
+  seg_init(&h->seg[1]);
+  hist_budget(h, budget);
+  return h;
+}
+
+/*
+ * Keep the packed lines in file name (and name.1) from now on, using
+ * at most disk bytes. The lines a store that had the file before left
+ * there come first. The store must still be empty. -1 with errno set
+ * if the file cannot be used; the store then stays in memory.
+ */
+int hist_file(struct hist *h, const char *name, long long disk)
+{
+  char old[PATH_MAX];
+  struct hseg *s;
+  int e, i;
+
+  if (h == NULL || h->name || h->next > 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if ((h->name = strdup(name)) == NULL)
+    return -1;
+  if (seg_open(&h->seg[1], name, 1) < 0) {
+    e = errno;
+    free(h->name);
+    h->name = NULL;
+    errno = e;
+    return -1;
+  }
+  snprintf(old, sizeof(old), "%s.1", name);
+  if (seg_open(&h->seg[0], old, 0) < 0)
+    seg_init(&h->seg[0]);
+  h->seg[1].first = h->seg[0].lines;
+  h->next = h->openfirst = h->seg[1].first + h->seg[1].lines;
+  h->cells = h->seg[0].cells + h->seg[1].cells;
+
+  /* How wide its lines are, and whether the last one goes on. */
+  for (i = 0; i < 2; i++) {
+    s = &h->seg[i];
+    if (s->fd < 0 || s->lines == 0)
+      continue;
+    if (SHAPE_LO(s->shape) < h->wlo)
+      h->wlo = SHAPE_LO(s->shape);
+    if (SHAPE_HI(s->shape) > h->whi)
+      h->whi = SHAPE_HI(s->shape);
+    h->lastwrap = SHAPE_WRAP(s->shape);
+  }
+  h->join = 1;
+  h->jfirst = h->next - 1;
+  if (disk < 2 * HIST_MINMEM)
+    disk = 2 * HIST_MINMEM;
+  h->disk = disk;
+  return 0;
+}
+
+void hist_close(struct hist *h)
+{
+  int i;
+
+  if (h == NULL)
+    return;
+  /* What is in the open chunk is there next time, too. */
+  if (h->disk > 0 && h->openlines > 0)
+    hist_seal(h);
+  if (h->name) {
+    seg_close(&h->seg[0]);
+    seg_close(&h->seg[1]);
+    free(h->name);
+  }
+  while (h->c0 < h->nchunks)
+    hist_drop(h);
+  for (i = 0; i < HIST_CACHE; i++) {
+    free(h->cache[i].raw);
+    free(h->cache[i].offs);
+    free(h->cache[i].toffs);
+  }
+  free(h->chunks);
+  free(h->view);
+  free(h->openoffs);
+  free(h->opentoffs);
+  free(h->open);
+  free(h);
+}
+
+/*
+ * Change the budget. If the store is over it now, the oldest lines
+ * go right away.
+ */
+void hist_budget(struct hist *h, long budget)
+{
+  if (budget < HIST_MINMEM)
+    budget = HIST_MINMEM;
+  h->budget = budget;
+  hist_trim(h);
+}
+
+/*
+ * Add a line of len cells; with wrap, its text goes on in the next
+ * line. If there is no memory, it is lost.
+ */
+void hist_add(struct hist *h, const ELM *line, int len, int wrap)
+{
+  unsigned char rec[HIST_LINEMAX + 8], text[HIST_TEXTMAX];
+  int n, t, *o;
+  long i;
+
+  if (len > MAXCOLS)
+    len = MAXCOLS;
+  /* A run of lines that wrapped into each other is shown as one. */
+  if (h->lastwrap)
+    h->join++;
+  else {
+    h->join = 1;
+    h->jfirst = h->next;
+  }
+  if (h->join >= HIST_JOIN)
+    wrap = 0;
+  n = line_pack(line, len, wrap ? HL_WRAP : 0, rec);
+  t = line_text(line, line_used(line, len), 1, text, NULL);
+  text[t++] = '\n';
+  if ((h->openlen + n > HIST_CHUNK || h->opentlen + t > HIST_CHUNK) &&
+      hist_seal(h) < 0)
+    return;
+  if (h->openlines == h->maxopen) {
+    if ((o = realloc(h->openoffs, (h->maxopen + 1024) * sizeof(int))) == NULL)
+      return;
+    h->openoffs = o;
+    if ((o = realloc(h->opentoffs, (h->maxopen + 1025) * sizeof(int))) == NULL)
+      return;
+    h->opentoffs = o;
+    h->maxopen += 1024;
+  }
+  h->openoffs[h->openlines] = h->openlen;
+  h->opentoffs[h->openlines++] = h->opentlen;
+  memcpy(h->open + h->openlen, rec, n);
+  memcpy(h->open + HIST_CHUNK + h->opentlen, text, t);
+  h->openlen += n;
+  h->opentlen += t;
+  h->opentoffs[h->openlines] = h->opentlen;
+  h->opencells += len;
+  h->cells += len;
+  h->next++;
+  if (len < h->openlo)
+    h->openlo = len;
+  if (len > h->openhi)
+    h->openhi = len;
+  if (len < h->wlo)
+    h->wlo = len;
+  if (len > h->whi)
+    h->whi = len;
+  h->lastwrap = wrap;
+
+  /* Chunks with the start of the run it goes on with change, too. */
+  if (h->viewed) {
+    h->openrows = -1;
+    for (i = h->nview - 1; h->jfirst < h->openfirst && i >= 0; i--) {
+      view_dirty(h, i);
+      if (h->view[i].first <= h->jfirst && (i == 0 || !h->view[i - 1].wrap))
+        break;
+    }
+  }
+}
+
+/*
+ * The records (or with text, the text) of chunk c unpacked, from
+ * the cache if they are there.
+ */
+static struct hcache *hist_unpack(struct hist *h, struct hchunk *c, int text)
+{
+  struct hcache *k, *old = &h->cache[0];
+  const unsigned char *p, *end;
+  int i, n, *o;
+
+  h->clock++;
+  for (i = 0; i < HIST_CACHE; i++) {
+    k = &h->cache[i];
+    if (k->first == c->first)
+      break;
+    if (k->age < old->age)
+      old = k;
+  }
+  if (i == HIST_CACHE) {
+    k = old;
+    k->first = -1;
+    k->hasrec = k->hastext = 0;
+    if (k->raw == NULL && (k->raw = malloc(2 * HIST_CHUNK + 1)) == NULL)
+      return NULL;
+    if (c->lines > k->maxoffs) {
+      if ((o = realloc(k->offs, c->lines * sizeof(int))) == NULL)
+        return NULL;
+      k->offs = o;
+      if ((o = realloc(k->toffs, (c->lines + 1) * sizeof(int))) == NULL)
+        return NULL;
+      k->toffs = o;
+      k->maxoffs = c->lines;
+    }
+    k->first = c->first;
+  }
+  k->age = h->clock;
+
+  if (!text && !k->hasrec) {
+    if (part_unpack(c->data, c->prec, k->raw, c->rec) < 0)
+      return NULL;
+    p = k->raw;
+    end = p + c->rec;
+    for (i = 0; i < c->lines; i++) {
+      if ((n = line_size(p, end)) < 0)
+        return NULL;
+      k->offs[i] = p - k->raw;
+      p += n;
+    }
+    k->hasrec = 1;
+  }
+  if (text && !k->hastext) {
+    if (part_unpack(c->data + c->prec, c->ptext, k->raw + HIST_CHUNK,
+                    c->text) < 0)
+      return NULL;
+    p = k->raw + HIST_CHUNK;
+    end = p + c->text;
+    for (i = 0; i < c->lines; i++) {
+      k->toffs[i] = p - (k->raw + HIST_CHUNK);
+      if ((p = memchr(p, '\n', end - p)) == NULL)
+        return NULL;
+      p++;
+    }
+    k->toffs[i] = p - (k->raw + HIST_CHUNK);
+    k->hastext = 1;
+  }
+  return k;
+}
+
+/*
+ * The chunk that has line, unpacked as hist_unpack() does, and what
+ * it is in c. If the line is in the file, the index says where to
+ * start looking.
+ */
+static struct hcache *hist_chunk(struct hist *h, long line, struct hchunk *c,
+                                 int text)
+{
+  struct hseg *s;
+  struct hdisk d;
+  long rel;
+  off_t off;
+  int lo, hi, mid;
+
+  if (h->name && line < h->seg[1].first + h->seg[1].lines) {
+    s = &h->seg[line < h->seg[1].first ? 0 : 1];
+    rel = line - s->first;
+    if (rel < 0 || rel / HIST_GROUP >= s->groups)
+      return NULL;
+    /* At most HIST_GROUP steps. */
+    off = s->idx[rel / HIST_GROUP];
+    for (;;) {
+      if (seg_chunk(s, off, &d) < 0 || rel < (long)d.first)
+        return NULL;
+      if (rel < (long)(d.first + d.lines))
+        break;
+      off += sizeof(struct hdisk) + DISK_SIZE(&d);
+    }
+    c->first = s->first + d.first;
+    c->lines = d.lines;
+    c->size = DISK_SIZE(&d);
+    c->rec = d.rec;
+    c->prec = d.prec;
+    c->text = d.text;
+    c->ptext = d.ptext;
+    c->cells = 0;
+    c->data = s->map + off + sizeof(struct hdisk);
+    return hist_unpack(h, c, text);
+  }
+  if (h->c0 == h->nchunks)
+    return NULL;
+
+  /* The last chunk that starts at or before the line. */
+  lo = h->c0;
+  hi = h->nchunks - 1;
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    if (h->chunks[mid].first <= line)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  *c = h->chunks[lo];
+  return hist_unpack(h, c, text);
+}
+
+/* Line (counting all that were ever added) into width cells of buf. */
+static int row_get(struct hist *h, long line, ELM *buf, int width)
+{
+  struct hchunk c;
+  struct hcache *k;
+
+  if (line < h->first || line >= h->next)
+    return -1;
+  if (line >= h->openfirst)
+    return line_unpack(h->open + h->openoffs[line - h->openfirst],
+                       h->open + h->openlen, buf, width);
+  if ((k = hist_chunk(h, line, &c, 0)) == NULL)
+    return -1;
+  return line_unpack(k->raw + k->offs[line - c.first],
+                     k->raw + c.rec, buf, width);
+}
+
+/* What line_head() says of a line. */
+static int row_head(struct hist *h, long line, int *cells, int *used,
+                    ELM *fill)
+{
+  struct hchunk c;
+  struct hcache *k;
+
+  if (line < h->first || line >= h->next)
+    return -1;
+  if (line >= h->openfirst)
+    return line_head(h->open + h->openoffs[line - h->openfirst],
+                     h->open + h->openlen, cells, used, fill);
+  if ((k = hist_chunk(h, line, &c, 0)) == NULL)
+    return -1;
+  return line_head(k->raw + k->offs[line - c.first],
+                   k->raw + c.rec, cells, used, fill);
+}
+
+/* Whether the text of line goes on in the next one. */
+static int row_wraps(struct hist *h, long line)
+{
+  ELM fill;
+  int cells, used, f;
+
+  f = row_head(h, line, &cells, &used, &fill);
+  return f > 0 && (f & HL_WRAP) && line + 1 < h->next;
+}
+
+/*
+ * The cells of line that are text of its run: all of them if it goes
+ * on in the next line (*wraps), else the ones before the blank end.
+ * A damaged line is a blank one, as wide as the screen.
+ */
+static int row_len(struct hist *h, long line, int *cells, int *wraps)
+{
+  ELM fill;
+  int used, f;
+
+  if ((f = row_head(h, line, cells, &used, &fill)) < 0) {
+    *cells = used = h->width;
+    f = 0;
+  }
+  *wraps = (f & HL_WRAP) && line + 1 < h->next;
+  return *wraps ? *cells : used;
+}
+
+/* Whether the lines are shown as they are stored. */
+static int hist_plain(struct hist *h)
+{
+  return h->width == 0 || h->next == h->first ||
+         (h->wlo == h->width && h->whi == h->width);
+}
+
+/*
+ * The run of lines that starts at line: in *lines how many there are,
+ * in *plain whether they are all as wide as the screen and so shown
+ * as they are. Returns the rows it is shown in.
+ */
+static long run_rows(struct hist *h, long line, int *lines, int *plain)
+{
+  long len = 0;
+  int n, cells, wraps;
+
+  *plain = 1;
+  wraps = 1;
+  for (n = 0; wraps && line + n < h->next; n++) {
+    len += row_len(h, line + n, &cells, &wraps);
+    if (cells != h->width)
+      *plain = 0;
+  }
+  *lines = n;
+  if (*plain)
+    return n;
+  return len > 0 ? (len + h->width - 1) / h->width : 1;
+}
+
+/* The first line from line up to end that starts a run. */
+static long run_start(struct hist *h, long line, long end)
+{
+  while (line < end && line > h->first && row_wraps(h, line - 1))
+    line++;
+  return line;
+}
+
+/* Rows of the runs that start in lines first .. end - 1. */
+static long view_count(struct hist *h, long first, long end)
+{
+  long rows = 0;
+  int n, plain;
+
+  for (first = run_start(h, first, end); first < end; first += n)
+    rows += run_rows(h, first, &n, &plain);
+  return rows;
+}
+
+/* Rows of sealed chunk i; most are all as wide as the screen. */
+static long view_rows(struct hist *h, int i)
+{
+  struct hview *v = &h->view[i];
+
+  if (v->rows < 0) {
+    if (v->wlo == h->width && v->whi == h->width && !v->wrap &&
+        (i == 0 || !h->view[i - 1].wrap))
+      v->rows = v->lines;
+    else
+      v->rows = view_count(h, v->first, v->first + v->lines);
+  }
+  return v->rows;
+}
+
+/* Rows of all sealed chunks, making the sums before each right. */
+static long view_sealed(struct hist *h)
+{
+  struct hview *v;
+  int i;
+
+  for (i = h->sums; i < h->nview; i++) {
+    v = &h->view[i];
+    v->before = i ? v[-1].before + view_rows(h, i - 1) : 0;
+  }
+  h->sums = h->nview;
+  if (h->nview == 0)
+    return 0;
+  return h->view[h->nview - 1].before + view_rows(h, h->nview - 1);
+}
+
+/* Rows of the open chunk. */
+static long view_open(struct hist *h)
+{
+  if (h->openrows < 0)
+    h->openrows = view_count(h, h->openfirst, h->next);
+  return h->openrows;
+}
+
+/* Make the table of the sealed chunks. -1 if out of memory. */
+static int view_ready(struct hist *h)
+{
+  struct hchunk *c;
+  struct hseg *s;
+  struct hdisk d;
+  off_t off;
+  int i;
+
+  if (h->viewed)
+    return 0;
+  h->nview = 0;
+  for (i = 0; h->name && i < 2; i++) {
+    s = &h->seg[i];
+    for (off = HIST_FHEAD; s->fd >= 0 && seg_chunk(s, off, &d) == 0;
+         off += sizeof(struct hdisk) + DISK_SIZE(&d))
+      if (s->first + (long)d.first >= h->first &&
+          view_add(h, s->first + d.first, d.lines, d.shape) < 0)
+        goto fail;
+  }
+  for (i = h->c0; i < h->nchunks; i++) {
+    c = &h->chunks[i];
+    if (view_add(h, c->first, c->lines, SHAPE(c->wlo, c->whi, c->wrap)) < 0)
+      goto fail;
+  }
+  h->viewed = 1;
+  h->sums = 0;
+  return 0;
+
+fail:
+  free(h->view);
+  h->view = NULL;
+  h->nview = h->maxview = 0;
+  return -1;
+}
+
+/* Whether the lines are shown through the table. */
+static int hist_shown(struct hist *h)
+{
+  return !hist_plain(h) && view_ready(h) == 0;
+}
+
+/*
+ * The run that row no is shown in: returns the line it starts at (-1
+ * if there is none) and in *k which of its rows no is.
+ */
+static long view_seek(struct hist *h, long no, long *k, int *plain)
+{
+  long line, end, base, rows, sealed;
+  int lo, hi, mid, n;
+
+  sealed = view_sealed(h);
+  if (no >= sealed) {
+    base = sealed;
+    line = h->openfirst;
+    end = h->next;
+  } else {
+    for (lo = 0, hi = h->nview - 1; lo < hi; ) {
+      mid = (lo + hi + 1) / 2;
+      if (h->view[mid].before <= no)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    base = h->view[lo].before;
+    line = h->view[lo].first;
+    end = line + h->view[lo].lines;
+  }
+  line = run_start(h, line, end);
+  /* Going on from the run looked up last saves counting. */
+  if (h->vline >= line && h->vline < end && h->vrow <= no) {
+    line = h->vline;
+    base = h->vrow;
+  }
+  for (; line < end; line += n, base += rows) {
+    rows = run_rows(h, line, &n, plain);
+    if (no < base + rows) {
+      h->vline = line;
+      h->vrow = base;
+      *k = no - base;
+      return line;
+    }
+  }
+  return -1;
+}
+
+/*
+ * The first line that row no shows a part of, or with last the last
+ * one. -1 if there is no such row.
+ */
+static long view_line(struct hist *h, long no, int last)
+{
+  long line, k, at, pos;
+  int plain, cells, wraps;
+
+  if ((line = view_seek(h, no, &k, &plain)) < 0 || plain)
+    return line < 0 ? -1 : line + k;
+  at = k * h->width + (last ? h->width : 1);
+  for (pos = 0; ; line++) {
+    pos += row_len(h, line, &cells, &wraps);
+    if (at <= pos || !wraps)
+      return line;
+  }
+}
+
+/* The rows line is shown in: the first in *top, returns the last. */
+static long view_rows_of(struct hist *h, long line, long *top)
+{
+  long s, start, base, off, rows, last;
+  int lo, hi, mid, n, plain, cells, wraps, len;
+
+  for (s = line; s > h->first && row_wraps(h, s - 1); s--)
+    ;
+  if (s >= h->openfirst) {
+    base = view_sealed(h);
+    start = h->openfirst;
+  } else {
+    view_sealed(h);
+    for (lo = 0, hi = h->nview - 1; lo < hi; ) {
+      mid = (lo + hi + 1) / 2;
+      if (h->view[mid].first <= s)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    base = h->view[lo].before;
+    start = h->view[lo].first;
+  }
+  start = run_start(h, start, s);
+  if (h->vline >= start && h->vline <= s) {
+    start = h->vline;
+    base = h->vrow;
+  }
+  for (; start < s; start += n)
+    base += run_rows(h, start, &n, &plain);
+  h->vline = s;
+  h->vrow = base;
+
+  rows = run_rows(h, s, &n, &plain);
+  if (plain) {
+    *top = base + line - s;
+    return *top;
+  }
+  for (off = 0; s < line; s++)
+    off += row_len(h, s, &cells, &wraps);
+  len = row_len(h, line, &cells, &wraps);
+  *top = base + off / h->width;
+  last = len > 0 ? base + (off + len - 1) / h->width : *top;
+  if (last > base + rows - 1)
+    last = base + rows - 1;
+  if (*top > last)
+    *top = last;
+  return last;
+}
+
+/*
+ * Row k of the run that starts at line, into width cells of buf: the
+ * text of the run from cell k * width of the screen on.
+ */
+static int view_slice(struct hist *h, long line, long k, ELM *buf, int width)
+{
+  ELM row[MAXCOLS], fill;
+  long at = k * h->width, pos = 0;
+  int out = 0, max, len, cells, used, wraps;
+
+  max = width < h->width ? width : h->width;
+  for (;; line++) {
+    len = row_len(h, line, &cells, &wraps);
+    if (at < pos + len && out < max) {
+      if (row_get(h, line, row, cells) < 0)
+        return -1;
+      for (; at < pos + len && out < max; at++)
+        buf[out++] = row[at - pos];
+    }
+    pos += len;
+    if (!wraps || out >= max)
+      break;
+  }
+  if (row_head(h, line, &cells, &used, &fill) < 0)
+    return -1;
+  while (out < width)
+    buf[out++] = fill;
+  return 0;
+}
+
+/*
+ * Show the lines at width from now on, 0 for as they are stored. The
+ * rows are counted again when they are needed.
+ */
+void hist_width(struct hist *h, int width)
+{
+  int i;
+
+  if (h == NULL || width == h->width)
+    return;
+  h->width = width < 0 ? 0 : width > MAXCOLS ? MAXCOLS : width;
+  for (i = 0; i < h->nview; i++)
+    h->view[i].rows = -1;
+  h->sums = 0;
+  h->openrows = -1;
+  h->vline = -1;
+}
+
+/*
+ * How many lines are kept, as rows of the width they are shown at.
+ */
+long hist_lines(struct hist *h)
+{
+  if (h == NULL)
+    return 0;
+  if (!hist_shown(h))
+    return h->next - h->first;
+  return view_sealed(h) + view_open(h);
+}
+
+/*
+ * Line no, 0 being the oldest that is kept, into width cells of buf.
+ * Returns -1 if there is no such line, or it could not be unpacked.
+ */
+int hist_get(struct hist *h, long no, ELM *buf, int width)
+{
+  long line, k;
+  int plain;
+
+  if (h == NULL || no < 0 || no >= hist_lines(h))
+    return -1;
+  if (!hist_shown(h))
+    return row_get(h, h->first + no, buf, width);
+  if ((line = view_seek(h, no, &k, &plain)) < 0)
+    return -1;
+  if (plain)
+    return row_get(h, line + k, buf, width);
+  return view_slice(h, line, k, buf, width);
+}
+
+/* Boyer-Moore-Horspool: how far to move on for each last byte. */
+static void bm_init(const unsigned char *p, int n, int *skip)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+    skip[i] = n;
+  for (i = 0; i < n - 1; i++)
+    skip[p[i]] = n - 1 - i;
+}
+
+/* Where the n bytes of p are first found in s .. end, NULL if not. */
+static const unsigned char *bm_find(const unsigned char *s,
+                                    const unsigned char *end,
+                                    const unsigned char *p, int n,
+                                    const int *skip)
+{
+  unsigned char last = p[n - 1], c;
+
+  while (end - s >= n) {
+    c = s[n - 1];
+    if (c == last && memcmp(s, p, n - 1) == 0)
+      return s;
+    s += skip[c];
+  }
+  return NULL;
+}
+
+/*
+ * Where the pattern is first found in s .. end, NULL if not, and in
+ * *n how many bytes of s it took. With exact, the pattern as given
+ * is looked for, else the lower case one. For a regular expression
+ * *end is set to 0 for a while, so there must be a byte for that;
+ * notbol says s is not where a line starts.
+ */
+static unsigned char *pat_find(struct hfind *f, int exact, unsigned char *s,
+                               unsigned char *end, int notbol, int *n)
+{
+  regmatch_t m;
+  unsigned char save;
+  int r;
+
+  if (!f->regex) {
+    if (exact) {
+      *n = f->elen;
+      return (unsigned char *)bm_find(s, end, f->exact, f->elen, f->eskip);
+    }
+    *n = f->len;
+    return (unsigned char *)bm_find(s, end, f->pat, f->len, f->skip);
+  }
+  save = *end;
+  *end = 0;
+  r = regexec(exact ? &f->ere : &f->re, (char *)s, 1, &m,
+              notbol ? REG_NOTBOL : 0);
+  *end = save;
+  if (r != 0)
+    return NULL;
+  *n = m.rm_eo - m.rm_so;
+  return s + m.rm_so;
+}
+
+/*
+ * A search for pattern; with fold, case does not matter. Without
+ * regex the pattern is looked for as it is, with it the pattern is an
+ * extended regular expression, and is compiled here, once. NULL if the
+ * pattern is empty or wrong, or there is no memory; then err (if not
+ * NULL) says why.
+ */
+struct hfind *hist_findopen(const wchar_t *pattern, int fold, int regex,
+                            char *err, int errlen)
+{
+  ELM e[MAXCOLS];
+  unsigned char text[HIST_TEXTMAX];
+  struct hfind *f;
+  int len, r;
+
+  if (err && errlen > 0)
+    snprintf(err, errlen, "%s", _("No pattern"));
+  for (len = 0; pattern[len] && len < MAXCOLS; len++)
+    e[len].value = pattern[len];
+  if (len == 0 || (f = calloc(1, sizeof(struct hfind))) == NULL)
+    return NULL;
+  f->fold = fold;
+
+  if (regex) {
+    /* The case-less one finds the lines, ere says if case matters. */
+    text[line_text(e, len, 0, text, NULL)] = 0;
+    r = regcomp(&f->re, (char *)text, REG_EXTENDED | REG_ICASE | REG_NEWLINE);
+    if (r == 0) {
+      f->regex = 1;
+      if (!fold &&
+          (r = regcomp(&f->ere, (char *)text, REG_EXTENDED | REG_NEWLINE)) == 0)
+        f->regex = 2;
+    }
+    if (r != 0) {
+      if (err && errlen > 0)
+        regerror(r, f->regex ? &f->ere : &f->re, err, errlen);
+      hist_findclose(f);
+      return NULL;
+    }
+    return f;
+  }
+
+  if ((f->pat = malloc(len * 4)) == NULL ||
+      (!fold && (f->exact = malloc(len * 4)) == NULL)) {
+    if (err && errlen > 0)
+      snprintf(err, errlen, "%s", _("Out of memory"));
+    hist_findclose(f);
+    return NULL;
+  }
+  f->len = line_text(e, len, 1, f->pat, NULL);
+  bm_init(f->pat, f->len, f->skip);
+  if (!fold) {
+    f->elen = line_text(e, len, 0, f->exact, NULL);
+    bm_init(f->exact, f->elen, f->eskip);
+  }
+  return f;
+}
+
+void hist_findclose(struct hfind *f)
+{
+  if (f == NULL)
+    return;
+  if (f->regex > 0)
+    regfree(&f->re);
+  if (f->regex > 1)
+    regfree(&f->ere);
+  free(f->pat);
+  free(f->exact);
+  free(f);
+}
+
+/*
+ * Whether the first len cells of line have the pattern. Blanks at
+ * the end do not count, as in the text that hist_find() looks at.
+ */
+int hist_match(struct hfind *f, const ELM *line, int len)
+{
+  unsigned char text[HIST_TEXTMAX];
+  int n;
+
+  if (f == NULL)
+    return 0;
+  if (len > MAXCOLS)
+    len = MAXCOLS;
+  n = line_text(line, line_used(line, len), f->fold, text, NULL);
+  return pat_find(f, !f->fold, text, text + n, 0, &n) != NULL;
+}
+
+/*
+ * Like hist_match(), but finds every place the pattern is in the
+ * line, and sets mark[i] to 1 for the cells in them, 0 for others.
+ * Returns how many places there are.
+ */
+int hist_marks(struct hfind *f, const ELM *line, int len, char *mark)
+{
+  unsigned char text[HIST_TEXTMAX], *p, *q, *end;
+  int at[MAXCOLS], used, found = 0, i, n;
+
+  if (len > MAXCOLS)
+    len = MAXCOLS;
+  memset(mark, 0, len);
+  if (f == NULL)
+    return 0;
+  used = line_used(line, len);
+  end = text + line_text(line, used, f->fold, text, at);
+  for (p = text; p <= end; p = q + (n > 0 ? n : 1)) {
+    if ((q = pat_find(f, !f->fold, p, end, p > text, &n)) == NULL)
+      break;
+    found++;
+    for (i = 0; i < used; i++)
+      if (at[i] >= q - text && at[i] < q - text + n)
+        mark[i] = 1;
+  }
+  return found;
+}
+
+/*
+ * The text is in lower case. If case matters, what is found there
+ * is only a line that may have the pattern; the line itself says.
+ */
+static int hist_verify(struct hist *h, struct hfind *f, long line)
+{
+  ELM buf[MAXCOLS];
+
+  if (f->fold)
+    return 1;
+  return row_get(h, line, buf, MAXCOLS) == 0 && hist_match(f, buf, MAXCOLS);
+}
+
+/*
+ * The first line from "from" to "to" as they are stored, going back if
+ * to < from, that has the pattern of f. Returns its number, or -1 if
+ * there is none.
+ */
+static long find_lines(struct hist *h, struct hfind *f, long from, long to)
+{
+  unsigned char *text, *p, *end;
+  const int *toffs;
+  struct hchunk c;
+  struct hcache *k;
+  long line, last, first;
+  int n, a, b, i, m, lo, hi;
+
+  if ((n = h->next - h->first) == 0)
+    return -1;
+  if (from < 0 && to < 0)
+    return -1;
+  if (from >= n && to >= n)
+    return -1;
+  from = from < 0 ? 0 : from >= n ? n - 1 : from;
+  to = to < 0 ? 0 : to >= n ? n - 1 : to;
+
+  line = h->first + from;
+  last = h->first + to;
+  while (from <= to ? line <= last : line >= last) {
+    if (line >= h->openfirst) {
+      first = h->openfirst;
+      n = h->openlines;
+      text = h->open + HIST_CHUNK;
+      toffs = h->opentoffs;
+    } else {
+      if ((k = hist_chunk(h, line, &c, 1)) == NULL)
+        return -1;
+      first = c.first;
+      n = c.lines;
+      text = k->raw + HIST_CHUNK;
+      toffs = k->toffs;
+    }
+
+    /*
+     * Lines a to b of this chunk; forward, all in one go. A regular
+     * expression may go on over the end of a line, so there the line
+     * on its own has to have it, too.
+     */
+    a = line - first;
+    if (from <= to) {
+      b = last - first < n - 1 ? last - first : n - 1;
+      p = text + toffs[a];
+      end = text + toffs[b + 1];
+      while ((p = pat_find(f, 0, p, end, 0, &m)) != NULL) {
+        for (lo = a, hi = b; lo < hi; ) {
+          i = (lo + hi + 1) / 2;
+          if (toffs[i] <= p - text)
+            lo = i;
+          else
+            hi = i - 1;
+        }
+        if ((!f->regex || pat_find(f, 0, text + toffs[lo],
+                                   text + toffs[lo + 1] - 1, 0, &m)) &&
+            hist_verify(h, f, first + lo))
+          return first + lo - h->first;
+        p = text + toffs[lo + 1];
+      }
+      line = first + b + 1;
+    } else {
+      b = last - first > 0 ? last - first : 0;
+      for (i = a; i >= b; i--)
+        if (pat_find(f, 0, text + toffs[i], text + toffs[i + 1] - 1, 0, &m) &&
+            hist_verify(h, f, first + i))
+          return first + i - h->first;
+      line = first + b - 1;
+    }
+  }
+  return -1;
+}
+
+/*
+ * The first line from "from" to "to" as they are stored, going back if
+ * to < from, whose text goes on in the next one; -1 if there is none.
+ */
+static long find_wrap(struct hist *h, long from, long to)
+{
+  const unsigned char *raw, *end;
+  const int *offs;
+  struct hchunk c;
+  struct hcache *k;
+  long line = h->first + from, last = h->first + to, first;
+  int step = to < from ? -1 : 1;
+  int n, i, b, f, cells, used;
+  ELM fill;
+
+  while (step > 0 ? line <= last : line >= last) {
+    if (line >= h->openfirst) {
+      first = h->openfirst;
+      n = h->openlines;
+      raw = h->open;
+      end = h->open + h->openlen;
+      offs = h->openoffs;
+    } else {
+      if ((k = hist_chunk(h, line, &c, 0)) == NULL)
+        return -1;
+      first = c.first;
+      n = c.lines;
+      raw = k->raw;
+      end = k->raw + c.rec;
+      offs = k->offs;
+    }
+    if (step > 0)
+      b = last - first < n - 1 ? last - first : n - 1;
+    else
+      b = last - first > 0 ? last - first : 0;
+    for (i = line - first; step > 0 ? i <= b : i >= b; i += step)
+      if ((f = line_head(raw + offs[i], end, &cells, &used, &fill)) > 0 &&
+          (f & HL_WRAP) && first + i + 1 < h->next)
+        return first + i - h->first;
+    line = first + b + step;
+  }
+  return -1;
+}
+
+/*
+ * The run that line is in, its text looked at as one: a place with
+ * the pattern may go on over the end of a row, or of a stored line.
+ * Returns the row such a place starts in, if it is from "from" to
+ * "to": the first, or going back the last. -1 if there is none, -2
+ * if out of memory. *next is the line after the run, going back the
+ * one before it.
+ */
+static long run_find(struct hist *h, struct hfind *f, long line,
+                     long from, long to, long *next)
+{
+  ELM row[MAXCOLS], *cells;
+  unsigned char *text, *p, *q, *end;
+  long s, e, top, no, found = -1;
+  int *at, len, pos, n, c, lo, hi, mid, wraps;
+  int back = to < from;
+
+  for (s = h->first + line; s > h->first && row_wraps(h, s - 1); s--)
+    ;
+  for (e = s, len = 0; ; e++) {
+    len += row_len(h, e, &c, &wraps);
+    if (!wraps)
+      break;
+  }
+  *next = back ? s - 1 - h->first : e + 1 - h->first;
+  view_rows_of(h, s, &top);
+
+  cells = malloc((len + 1) * sizeof(ELM));
+  at = malloc((len + 1) * sizeof(int));
+  text = malloc(len * 4 + 1);
+  if (cells == NULL || at == NULL || text == NULL) {
+    found = -2;
+    goto out;
+  }
+  for (pos = 0; s <= e; s++) {
+    n = row_len(h, s, &c, &wraps);
+    if (row_get(h, s, row, c) < 0)
+      goto out;
+    memcpy(cells + pos, row, n * sizeof(ELM));
+    pos += n;
+  }
+
+  end = text + line_text(cells, len, f->fold, text, at);
+  for (p = text; p <= end; p = q + (n > 0 ? n : 1)) {
+    if ((q = pat_find(f, !f->fold, p, end, p > text, &n)) == NULL)
+      break;
+    /* The cell the place starts in. */
+    for (lo = 0, hi = len > 0 ? len - 1 : 0; lo < hi; ) {
+      mid = (lo + hi + 1) / 2;
+      if (at[mid] <= q - text)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    no = top + lo / h->width;
+    if (back ? no > from : no > to)
+      break;
+    if (back ? no >= to : no >= from) {
+      found = no;
+      if (!back)
+        break;
+    }
+  }
+out:
+  free(cells);
+  free(at);
+  free(text);
+  return found;
+}
+
+/*
+ * The first line from "from" to "to", going back if to < from, that
+ * has the pattern of f. Returns its number, or -1 if there is none.
+ * Shown at another width, the stored lines are searched, and the text
+ * of the run they are in says which row has the pattern: where it
+ * starts. A run can have it across the end of a line that goes on in
+ * the next, where neither line has it, so those runs are looked at
+ * too.
+ */
+long hist_find(struct hist *h, struct hfind *f, long from, long to)
+{
+  long n, line, last, no, hit, end, w;
+  int back = to < from;
+
+  if (h == NULL || f == NULL)
+    return -1;
+  if (!hist_shown(h))
+    return find_lines(h, f, from, to);
+  if ((n = hist_lines(h)) == 0 || (from < 0 && to < 0) ||
+      (from >= n && to >= n))
+    return -1;
+  from = from < 0 ? 0 : from >= n ? n - 1 : from;
+  to = to < 0 ? 0 : to >= n ? n - 1 : to;
+
+  if ((line = view_line(h, from, back)) < 0 ||
+      (last = view_line(h, to, !back)) < 0)
+    return -1;
+  line -= h->first;
+  last -= h->first;
+  while (back ? line >= last : line <= last) {
+    /* The runs that go on over a line end, then the one that has it. */
+    hit = find_lines(h, f, line, last);
+    end = hit >= 0 ? hit : last;
+    while (back ? line >= end : line <= end) {
+      if ((w = find_wrap(h, line, end)) < 0 && (w = hit) < 0)
+        return -1;
+      if ((no = run_find(h, f, w, from, to, &line)) != -1)
+        return no < 0 ? -1 : no;
+    }
+    if (hit < 0)
+      break;
+  }
+  return -1;
+}
+
+/*
+ * The bytes the store uses in memory and on disk, and the bytes the
+ * lines in it would take as rows of ELMs.
+ */
+void hist_stats(struct hist *h, long *used, long long *disk, long long *raw)
+{
+  int i;
+
+  *used = h ? h->used + HIST_FIXED + h->maxopen * 2 * sizeof(int) : 0;
+  *disk = 0;
+  for (i = 0; h && h->name && i < 2; i++)
+    *disk += h->seg[i].size + h->seg[i].groups * sizeof(uint64_t);
+  *raw = h ? h->cells * (long long)sizeof(ELM) : 0;
+}
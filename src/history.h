@@ -0,0 +1,41 @@
+/*
+ * history.h	The scrollback store, see history.c.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef __MINICOM__SRC__HISTORY_H__
+#define __MINICOM__SRC__HISTORY_H__
+
+/* Smallest budget that makes sense: the open chunk and the cache. */
+#define HIST_MINMEM	(1L << 20)
+
+struct hist;
+struct hfind;
+
+struct hist *hist_open(long budget);
+void hist_close(struct hist *h);
+int  hist_file(struct hist *h, const char *name, long long disk);
+void hist_budget(struct hist *h, long budget);
+void hist_add(struct hist *h, const ELM *line, int len, int wrap);
+void hist_width(struct hist *h, int width);
+long hist_lines(struct hist *h);
+int  hist_get(struct hist *h, long no, ELM *buf, int width);
+void hist_stats(struct hist *h, long *used, long long *disk, long long *raw);
+
+struct hfind *hist_findopen(const wchar_t *pattern, int fold, int regex,
+                            char *err, int errlen);
+void hist_findclose(struct hfind *f);
+long hist_find(struct hist *h, struct hfind *f, long from, long to);
+int  hist_match(struct hfind *f, const ELM *line, int len);
+int  hist_marks(struct hfind *f, const ELM *line, int len, char *mark);
+
+#endif /* ! __MINICOM__SRC__HISTORY_H__ */
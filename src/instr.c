@@ -0,0 +1,127 @@
+/*
+ * instr.c	Counters and timers for the hot paths.
+ *
+ *		With --enable-instrument, the places named in instr.h
+ *		count how often they ran, how many bytes they handled
+ *		and how long it took. The table tells whether time goes
+ *		to reading, parsing, drawing or writing on a given host.
+ *		Minicom writes it to the log on SIGUSR1 and to standard
+ *		error when it exits; vtbench prints it after the run.
+ *
+ *		Entry points:
+ *
+ *		instr_text(lines) - the table as text, returns the lines
+ *		instr_dump(fp)    - write the table to fp
+ *		instr_reset()     - start counting again
+ *
+ *		Without --enable-instrument there is no table.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "instr.h"
+
+#ifdef INSTRUMENT
+struct instr instr_stage[IN_NSTAGES];
+
+/* Names; the indented ones are part of the stage above them. */
+static const char *instr_names[IN_NSTAGES] = {
+  "read", "iconv", "emulate", "  cells", "flush", "  moves",
+  "  terminal", "capture",
+};
+
+static double ns_per_tick;
+
+static unsigned long long ns_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#if !defined(__GNUC__) || !(defined(__x86_64__) || defined(__i386__))
+unsigned long long instr_clock(void)
+{
+  return ns_now();
+}
+#endif
+
+/* How long is a tick? Watch both clocks for a few milliseconds. */
+static double calibrate(void)
+{
+  unsigned long long n0, t0, n1, t1;
+
+  n0 = ns_now();
+  t0 = instr_now();
+  do
+    n1 = ns_now();
+  while (n1 - n0 < 5000000);
+  t1 = instr_now();
+  return t1 > t0 ? (double)(n1 - n0) / (t1 - t0) : 1.0;
+}
+
+int instr_text(char lines[INSTR_LINES][INSTR_WIDTH])
+{
+  struct instr *in;
+  double ms;
+  int i;
+
+  if (ns_per_tick == 0)
+    ns_per_tick = calibrate();
+
+  snprintf(lines[0], INSTR_WIDTH, "%-10s %12s %14s %10s %9s",
+           "stage", "calls", "bytes", "ms", "ns/call");
+  for (i = 0; i < IN_NSTAGES; i++) {
+    in = &instr_stage[i];
+    ms = in->ticks * ns_per_tick / 1e6;
+    snprintf(lines[i + 1], INSTR_WIDTH, "%-10s %12llu %14llu %10.1f %9.0f",
+             instr_names[i], in->calls, in->bytes, ms,
+             in->calls ? ms * 1e6 / in->calls : 0.0);
+  }
+  snprintf(lines[i + 1], INSTR_WIDTH,
+           "(indented stages are part of the one above)");
+  return i + 2;
+}
+
+void instr_reset(void)
+{
+  memset(instr_stage, 0, sizeof(instr_stage));
+}
+#else
+int instr_text(char lines[INSTR_LINES][INSTR_WIDTH])
+{
+  (void)lines;
+  return 0;
+}
+
+void instr_reset(void)
+{
+}
+#endif
+
+void instr_dump(FILE *fp)
+{
+  char lines[INSTR_LINES][INSTR_WIDTH];
+  int i, n;
+
+  n = instr_text(lines);
+  for (i = 0; i < n; i++)
+    fprintf(fp, "%s\n", lines[i]);
+}
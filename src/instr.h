@@ -0,0 +1,76 @@
+/*
+ * instr.h	Counters and timers for the hot paths.
+ *
+ *		Only there when configured with --enable-instrument;
+ *		otherwise the macros are empty and cost nothing.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef __MINICOM__SRC__INSTR_H__
+#define __MINICOM__SRC__INSTR_H__
+
+/* The stages, in the order they are shown. */
+enum {
+  IN_READ,		/* Reading the port in check_io() */
+  IN_ICONV,		/* Character set conversion */
+  IN_EMUL,		/* vt_out(): parsing and drawing in memory */
+  IN_CELL,		/* _write(): one cell, part of IN_EMUL */
+  IN_FLUSH,		/* mc_wflush(): bringing the terminal up to date */
+  IN_MOVE,		/* _moveto(): cursor motion, part of IN_FLUSH */
+  IN_TERM,		/* write() to the terminal, mostly in IN_FLUSH */
+  IN_CAPTURE,		/* write() to the capture file */
+  IN_NSTAGES
+};
+
+/* Lines of text from instr_text(). */
+#define INSTR_LINES	(IN_NSTAGES + 2)
+#define INSTR_WIDTH	72
+
+#ifdef INSTRUMENT
+struct instr {
+  unsigned long long calls;
+  unsigned long long bytes;
+  unsigned long long ticks;
+};
+
+extern struct instr instr_stage[IN_NSTAGES];
+
+/*
+ * The time stamp counter where there is one, it is the cheapest
+ * clock; instr_text() works out how long a tick was.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define instr_now()	__builtin_ia32_rdtsc()
+#else
+unsigned long long instr_clock(void);
+#  define instr_now()	instr_clock()
+#endif
+
+#define INSTR_START(t)	unsigned long long t = instr_now()
+#define INSTR_END(stage, t, n) \
+	do { \
+	  struct instr *in_ = &instr_stage[stage]; \
+	  in_->calls++; \
+	  in_->bytes += (n); \
+	  in_->ticks += instr_now() - (t); \
+	} while (0)
+#else
+#define INSTR_START(t)
+#define INSTR_END(stage, t, n)	do { (void)(n); } while (0)
+#endif
+
+/* Prototypes from instr.c */
+int instr_text(char lines[INSTR_LINES][INSTR_WIDTH]);
+void instr_dump(FILE *fp);
+void instr_reset(void);
+
+#endif /* ! __MINICOM__SRC__INSTR_H__ */
@@ -1,7 +1,10 @@
 /*
- * ipc.c	talk to the keyserv process.
+ * ipc.c	talk to the keyserv process, and wait for I/O.
  *
- *		Entry point:
+ *		Entry points:
+ *
+ *		check_io(fd1, fd2, tmout, buf, bufsize, bytes_read)
+ *		wait for the serial port and/or keyboard to become ready.
  *
  *		keyserv(command, arg)
  *		command can be KINSTALL, KUNINSTALL, or a command for keyserv.
@@ -23,46 +26,113 @@
 #endif
 
 #include <strings.h>
+#include <poll.h>
 
 #include "port.h"
 #include "minicom.h"
 #include "intl.h"
 
-/* Check if there is IO pending. */
+/* Limits for the "rxbufsize" parameter. */
+#define RXBUF_MIN	128
+#define RXBUF_MAX	(1024 * 1024)
+
+static char rx_fallback[RXBUF_MIN];
+static char *rx_buf;
+static int rx_size;
+
+/*
+ * Return the buffer that data from the serial port is read into.
+ * It is shared by the terminal loop, the dialer and the backlog
+ * and is sized by the "rxbufsize" parameter, so that a single
+ * wakeup can take everything the driver has queued up instead of
+ * a few dozen bytes at a time.
+ */
+char *io_rxbuf(int *size)
+{
+  int want = atoi(P_RXBUFSIZE);
+  char *n;
+
+  if (want < RXBUF_MIN)
+    want = RXBUF_MIN;
+  if (want > RXBUF_MAX)
+    want = RXBUF_MAX;
+
+  if (want != rx_size && (n = realloc(rx_buf, want)) != NULL) {
+    rx_buf = n;
+    rx_size = want;
+  }
+
+  if (rx_buf == NULL) {
+    *size = sizeof(rx_fallback);
+    return rx_fallback;
+  }
+  *size = rx_size;
+  return rx_buf;
+}
+
+/*
+ * Check if there is IO pending.
+ *
+ * Waits up to tmout milliseconds until fd1 (the serial port) or fd2
+ * (the keyboard) becomes readable. Bit 0 of the return value is set
+ * for fd1, bit 1 for fd2. If buf is given and fd1 is readable, one
+ * read() of up to bufsize - 1 bytes is done into it and the data is
+ * zero terminated. If the reader thread runs for fd1, the data comes
+ * from its ring instead.
+ */
 int check_io(int fd1, int fd2, int tmout, char *buf,
              int bufsize, int *bytes_read)
 {
   int n = 0, i;
-  struct timeval tv;
-  fd_set fds;
+  int nfds = 0;
+  int i1 = -1, i2 = -1;
+  int ring = 0;
+  struct pollfd fds[2];
 
-  tv.tv_sec = tmout / 1000;
-  tv.tv_usec = (tmout % 1000) * 1000L;
-
-  i = fd1;
-  if (fd2 > fd1)
-    i = fd2;
+  if (fd1 >= 0 && rxring_owns(fd1)) {
+    ring = 1;
+    if (rxring_ready())
+      tmout = 0;
+  }
 
-  FD_ZERO(&fds);
-  if (fd1 >= 0)
-    FD_SET(fd1, &fds);
-  else
-    fd1 = 0;
-  if (fd2 >= 0)
-    FD_SET(fd2, &fds);
-  else
-    fd2 = 0;
+  if (fd1 >= 0) {
+    fds[nfds].fd = ring ? rxring_fd() : fd1;
+    fds[nfds].events = POLLIN;
+    i1 = nfds++;
+  }
+  if (fd2 >= 0) {
+    fds[nfds].fd = fd2;
+    fds[nfds].events = POLLIN;
+    i2 = nfds++;
+  }
 
   if (fd2 == 0 && io_pending)
     n = 2;
-  else if (select(i + 1, &fds, NULL, NULL, &tv) > 0)
-    n = 1 * (FD_ISSET(fd1, &fds) > 0) + 2 * (FD_ISSET(fd2, &fds) > 0);
+  else if (poll(fds, nfds, tmout) > 0) {
+    /* A hangup or error is reported as readable so that the
+     * following read() gets to see the EOF or error. */
+    if (i1 >= 0 && (fds[i1].revents & (POLLIN | POLLHUP | POLLERR)))
+      n |= 1;
+    if (i2 >= 0 && (fds[i2].revents & (POLLIN | POLLHUP | POLLERR)))
+      n |= 2;
+  }
+  if (ring)
+    n = (n & ~1) | rxring_ready();
 
   /* If there is data put it in the buffer. */
   if (buf) {
     i = 0;
     if ((n & 1) == 1) {
-      i = read(fd1, buf, bufsize - 1);
+      INSTR_START(t);
+      if (ring)
+        i = rxring_read(buf, bufsize - 1, NULL);
+      else {
+        i = read(fd1, buf, bufsize - 1);
+        PROBE2(serial_read, fd1, i);
+      }
+      INSTR_END(IN_READ, t, i > 0 ? i : 0);
+      if (i > 0)
+        stats_rx(i);
 #ifdef USE_SOCKET
       if (!i && portfd_is_socket && portfd == fd1)
         term_socket_close();
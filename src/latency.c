@@ -0,0 +1,423 @@
+/*
+ * latency.c	Measure the time from a key going out to its echo.
+ *
+ *		While the test runs, a probe (the "latpayload" string)
+ *		is sent through vt_send() like a typed key, at most
+ *		"latrate" times a second, and the time is taken. The
+ *		data coming in is searched for the echo; the time in
+ *		between is one sample. Only one probe is out at a time,
+ *		so an echo cannot be taken for the wrong one. A probe
+ *		that is not back within LAT_LOST_MS is counted as lost.
+ *
+ *		The last sample is shown in the status line. C-A V, L
+ *		shows the minimum, median, 99th percentile, maximum
+ *		and a histogram, and can write them to a file.
+ *
+ *		Entry points:
+ *
+ *		lat_start()       - start the test
+ *		lat_stop()        - stop it, the samples are kept
+ *		lat_running()     - is it running?
+ *		lat_tick()        - called from the main loop: send a probe
+ *		lat_timeout()     - ms until lat_tick() has work to do
+ *		lat_rx(buf, len)  - data came in from the port
+ *		lat_forget()      - minicom is going into a menu
+ *		lat_field(buf, size)
+ *		                  - short text for the status line
+ *		lat_summary(buf, size, brief)
+ *		                  - one line with the results
+ *		lat_window()      - show the results, start and stop
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+#include "intl.h"
+
+#define LAT_LOST_MS	2000		/* A probe not back by then is lost */
+#define LAT_SAMPLES	65536		/* Samples kept for the percentiles */
+#define LAT_BUCKETS	32		/* Histogram: 2^i to 2^(i+1) us */
+#define LAT_ROWS	10		/* Histogram lines in the window */
+#define LAT_WIDTH	60
+
+static int lat_on;			/* Test is running */
+static const char *lat_probe;		/* What is sent */
+static int lat_plen;
+static int lat_match;			/* Bytes of the echo seen so far */
+static int lat_out;			/* A probe is on its way */
+static long long lat_sent;		/* When it was sent, us */
+static long long lat_next;		/* When the next one may go */
+static long lat_interval;		/* us between probes */
+
+static unsigned *lat_samples;		/* Ring of the last samples, us */
+static long lat_nsamples;		/* Samples taken in all */
+static long lat_lost;
+static unsigned lat_min, lat_max, lat_last;
+static long lat_hist[LAT_BUCKETS];
+
+static long long lat_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int lat_bucket(unsigned us)
+{
+  int i = 0;
+
+  while (us > 1 && i < LAT_BUCKETS - 1) {
+    us >>= 1;
+    i++;
+  }
+  return i;
+}
+
+static void lat_reset(void)
+{
+  lat_nsamples = 0;
+  lat_lost = 0;
+  lat_min = lat_max = lat_last = 0;
+  memset(lat_hist, 0, sizeof(lat_hist));
+}
+
+/*
+ * Start the test. Returns -1 if there is no memory for it.
+ */
+int lat_start(void)
+{
+  int rate;
+
+  if (lat_samples == NULL &&
+      (lat_samples = malloc(LAT_SAMPLES * sizeof(unsigned))) == NULL)
+    return -1;
+  lat_probe = P_LATPAYLOAD[0] ? P_LATPAYLOAD : "~";
+  lat_plen = strlen(lat_probe);
+  rate = atoi(P_LATRATE);
+  if (rate < 1)
+    rate = 1;
+  if (rate > 1000)
+    rate = 1000;
+  lat_interval = 1000000L / rate;
+  lat_match = 0;
+  lat_out = 0;
+  lat_next = lat_now();
+  lat_on = 1;
+  return 0;
+}
+
+void lat_stop(void)
+{
+  lat_on = 0;
+  lat_out = 0;
+}
+
+int lat_running(void)
+{
+  return lat_on;
+}
+
+/*
+ * Called from the main loop. Gives up on a probe that does not
+ * come back, and sends the next one when it is time.
+ */
+void lat_tick(void)
+{
+  long long now;
+  const char *p;
+
+  if (!lat_on || portfd_connected < 0)
+    return;
+  now = lat_now();
+  if (lat_out && now - lat_sent >= LAT_LOST_MS * 1000LL) {
+    lat_lost++;
+    lat_out = 0;
+    lat_match = 0;
+  }
+  if (lat_out || now < lat_next)
+    return;
+  lat_out = 1;
+  lat_match = 0;
+  lat_sent = lat_now();
+  lat_next = lat_sent + lat_interval;
+  for (p = lat_probe; *p; p++)
+    vt_send((unsigned char)*p);
+}
+
+/*
+ * Milliseconds until lat_tick() has something to do, -1 if never.
+ */
+int lat_timeout(void)
+{
+  long long now, due;
+
+  if (!lat_on)
+    return -1;
+  now = lat_now();
+  due = lat_out ? lat_sent + LAT_LOST_MS * 1000LL : lat_next;
+  if (due <= now)
+    return 0;
+  return (due - now + 999) / 1000;
+}
+
+/*
+ * While a menu is up, data waits in the backlog, so an echo would
+ * come late. Forget the probe, and wait with the next one until an
+ * echo that is still on its way has come in.
+ */
+void lat_forget(void)
+{
+  if (!lat_on)
+    return;
+  lat_out = 0;
+  lat_match = 0;
+  lat_next = lat_now() + LAT_LOST_MS * 1000LL;
+}
+
+/*
+ * Look for the echo in what came in.
+ */
+void lat_rx(const char *buf, int len)
+{
+  unsigned us;
+  int i;
+
+  if (!lat_out)
+    return;
+  for (i = 0; i < len; i++) {
+    if (buf[i] == lat_probe[lat_match])
+      lat_match++;
+    else
+      lat_match = buf[i] == lat_probe[0];
+    if (lat_match < lat_plen)
+      continue;
+
+    us = lat_now() - lat_sent;
+    lat_samples[lat_nsamples % LAT_SAMPLES] = us;
+    if (lat_nsamples == 0 || us < lat_min)
+      lat_min = us;
+    if (us > lat_max)
+      lat_max = us;
+    lat_last = us;
+    lat_nsamples++;
+    lat_hist[lat_bucket(us)]++;
+    lat_out = 0;
+    lat_match = 0;
+    return;
+  }
+}
+
+/* Print a time in microseconds in a few characters. */
+static void lat_time(char *buf, int size, unsigned us)
+{
+  if (us < 1000)
+    snprintf(buf, size, "%uus", us);
+  else if (us < 100000)
+    snprintf(buf, size, "%.2fms", us / 1000.0);
+  else
+    snprintf(buf, size, "%ums", us / 1000);
+}
+
+/*
+ * The short text for the status line, empty if the test is not
+ * running.
+ */
+void lat_field(char *buf, int size)
+{
+  char t[16];
+
+  buf[0] = 0;
+  if (!lat_on)
+    return;
+  if (lat_nsamples == 0)
+    snprintf(buf, size, "LAT %s", lat_lost ? _("lost") : "...");
+  else {
+    lat_time(t, sizeof(t), lat_last);
+    snprintf(buf, size, "LAT %s", t);
+  }
+}
+
+static int lat_cmp(const void *a, const void *b)
+{
+  unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* The median and 99th percentile of the samples that are kept. */
+static void lat_percentiles(unsigned *p50, unsigned *p99)
+{
+  unsigned *s;
+  long n = lat_nsamples < LAT_SAMPLES ? lat_nsamples : LAT_SAMPLES;
+
+  *p50 = *p99 = 0;
+  if (n == 0 || (s = malloc(n * sizeof(unsigned))) == NULL)
+    return;
+  memcpy(s, lat_samples, n * sizeof(unsigned));
+  qsort(s, n, sizeof(unsigned), lat_cmp);
+  *p50 = s[n / 2];
+  *p99 = s[n * 99 / 100];
+  free(s);
+}
+
+/*
+ * One line with the results, empty if there are none. The brief one
+ * leaves out the minimum and maximum.
+ */
+void lat_summary(char *buf, int size, int brief)
+{
+  char a[16], b[16], c[16], d[16];
+  unsigned p50, p99;
+
+  buf[0] = 0;
+  if (lat_nsamples == 0 && lat_lost == 0)
+    return;
+  lat_percentiles(&p50, &p99);
+  lat_time(a, sizeof(a), lat_min);
+  lat_time(b, sizeof(b), p50);
+  lat_time(c, sizeof(c), p99);
+  lat_time(d, sizeof(d), lat_max);
+  if (brief)
+    snprintf(buf, size, _("p50 %s, p99 %s, %ld lost"), b, c, lat_lost);
+  else
+    snprintf(buf, size, _("%ld back, %ld lost, min %s p50 %s p99 %s max %s"),
+             lat_nsamples, lat_lost, a, b, c, d);
+}
+
+/*
+ * Write the results, the histogram and the samples to a file.
+ */
+static int lat_write(const char *name)
+{
+  char line[LAT_WIDTH];
+  FILE *fp;
+  long i, n;
+
+  if ((fp = fopen(name, "w")) == NULL)
+    return -1;
+  lat_summary(line, sizeof(line), 0);
+  fprintf(fp, "# minicom latency: %s\n", line);
+  fprintf(fp, "# probe \"%s\", %ld us apart\n", lat_probe ? lat_probe : "",
+          lat_interval);
+  fprintf(fp, "# from_us,to_us,count\n");
+  for (i = 0; i < LAT_BUCKETS; i++)
+    if (lat_hist[i])
+      fprintf(fp, "%lu,%lu,%ld\n", i ? 1UL << i : 0UL, (1UL << (i + 1)) - 1,
+              lat_hist[i]);
+  fprintf(fp, "# samples_us\n");
+  n = lat_nsamples < LAT_SAMPLES ? lat_nsamples : LAT_SAMPLES;
+  for (i = lat_nsamples - n; i < lat_nsamples; i++)
+    fprintf(fp, "%u\n", lat_samples[i % LAT_SAMPLES]);
+  return fclose(fp);
+}
+
+/* Draw the window contents. */
+static void lat_draw(WIN *w)
+{
+  char line[LAT_WIDTH], t1[16], t2[16];
+  long most = 0;
+  int i, lo, hi, y, bar;
+
+  mc_wlocate(w, 1, 1);
+  mc_wprintf(w, "%s %s", lat_on ? _("Running,") : _("Stopped,"),
+             lat_nsamples || lat_lost ? "" : _("no samples yet"));
+  mc_wclreol(w);
+  lat_summary(line, sizeof(line), 0);
+  mc_wlocate(w, 1, 2);
+  mc_wputs(w, line);
+  mc_wclreol(w);
+
+  /* The buckets that have samples, and as many before as fit. */
+  for (hi = LAT_BUCKETS - 1; hi > 0 && lat_hist[hi] == 0; hi--)
+    ;
+  for (lo = 0; lo < hi && lat_hist[lo] == 0; lo++)
+    ;
+  if (hi - lo >= LAT_ROWS)
+    lo = hi - LAT_ROWS + 1;
+  for (i = lo; i <= hi; i++)
+    if (lat_hist[i] > most)
+      most = lat_hist[i];
+
+  for (y = 0; y < LAT_ROWS; y++) {
+    mc_wlocate(w, 1, 4 + y);
+    i = lo + y;
+    if (most > 0 && i <= hi) {
+      lat_time(t1, sizeof(t1), i ? 1U << i : 0);
+      lat_time(t2, sizeof(t2), 1U << (i + 1));
+      bar = lat_hist[i] * 30 / most;
+      if (bar == 0 && lat_hist[i] > 0)
+        bar = 1;
+      mc_wprintf(w, "%8s - %-8s %-30.*s %ld", t1, t2, bar,
+                 "##############################", lat_hist[i]);
+    }
+    mc_wclreol(w);
+  }
+}
+
+/*
+ * Show the results until a key is pressed. 'S' starts or stops the
+ * test, 'R' forgets the samples and 'W' writes them to a file.
+ */
+void lat_window(void)
+{
+  static char name[128] = "minicom.lat";
+  WIN *w;
+  int x1, x2, c, first;
+  const char *s;
+
+  x1 = COLS / 2 - LAT_WIDTH / 2;
+  x2 = COLS / 2 + LAT_WIDTH / 2;
+  w = mc_wopen(x1, 4, x2, 7 + LAT_ROWS, BDOUBLE, stdattr,
+               mfcolor, mbcolor, 0, 0, 1);
+  mc_wtitle(w, TMID, _("Latency"));
+  mc_wcursor(w, CNONE);
+
+  for (first = 1; ; first = 0) {
+    lat_draw(w);
+    s = lat_on ? _("S stop, R reset, W write to file, other key: back")
+               : _("S start, R reset, W write to file, other key: back");
+    mc_wlocate(w, (x2 - x1) / 2 - strlen(s) / 2, LAT_ROWS + 5);
+    mc_wputs(w, s);
+    mc_wclreol(w);
+    if (first)
+      mc_wredraw(w, 1);
+    else
+      mc_wflush();
+
+    if (!backlog_key(1000))
+      continue;
+    c = wxgetch();
+    if (c == 'r' || c == 'R')
+      lat_reset();
+    else if (c == 'w' || c == 'W') {
+      if (input(_("Write results to which file?"), name) != NULL &&
+          name[0] && lat_write(name) < 0)
+        werror(_("Cannot write %s"), name);
+    } else if (c == 's' || c == 'S') {
+      if (lat_on)
+        lat_stop();
+      else {
+        if (lat_start() < 0)
+          werror(_("Out of memory"));
+        /* The test runs in the terminal. */
+        break;
+      }
+    } else
+      break;
+  }
+  mc_wclose(w, 1);
+}
@@ -78,6 +78,8 @@ void leave(const char *s)
 {
   if (stdwin)
     mc_wclose(stdwin, 1);
+  rxring_stop();
+  rxring_drop();
   if (portfd > 0) {
     m_restorestate(portfd);
     close(portfd);
@@ -140,6 +142,8 @@ void term_socket_connect(void)
  */
 void term_socket_close(void)
 {
+  term_replay();
+  txq_clear();
   close(portfd);
   portfd_is_connected = 0;
   portfd = -1;
@@ -313,33 +317,29 @@ nolock:
 }
 
 
-/* Function to write output. */
+/* Function to write output. It is queued, and paced if so configured. */
 static void do_output(const char *s, int len)
 {
   char buf[256];
+  int f, cr;
 
   if (len == 0)
     len = strlen(s);
+  /* A return key gets the newline delay. */
+  cr = vt_nl_delay > 0 && memchr(s, '\r', len) != NULL;
 
   if (P_PARITY[0] == 'M') {
-    int f;
-    for (f = 0; f < len && f < (int)sizeof(buf); f++)
-      buf[f] = *s++ | 0x80;
-    len = f;
-    s = buf;
-  }
-
-  int r;
-  int b = vt_ch_delay ? 1 : len;
-  while (len && (r = write(portfd, s, b)) >= 0)
-    {
-      s   += r;
-      len -= r;
-      if (vt_ch_delay)
-        usleep(vt_ch_delay * 1000);
-      else
-        b = len;
+    while (len > 0) {
+      for (f = 0; f < len && f < (int)sizeof(buf); f++)
+        buf[f] = *s++ | 0x80;
+      txq_write(buf, f, vt_ch_delay);
+      len -= f;
     }
+  } else
+    txq_write(s, len, vt_ch_delay);
+
+  if (cr)
+    txq_pause(vt_nl_delay);
 }
 
 /* Function to handle keypad mode switches. */
@@ -350,6 +350,76 @@ static void kb_handler(int a, int b)
   curs_status();
 }
 
+/*
+ * How many bytes the history buffer may use, 0 for none.
+ */
+long hist_memory(void)
+{
+  long mb = atol(P_HISTMEM);
+
+  if (mb <= 0)
+    return 0;
+  /* What a long can count on 32 bit systems. */
+  if (mb > 2047)
+    mb = 2047;
+  return mb << 20;
+}
+
+/*
+ * With "histdir" set, keep the history of the port in a file there,
+ * named after the port: /dev/ttyUSB0 has ttyUSB0.hist. The next
+ * minicom on the port finds the lines again.
+ */
+static void hist_attach(struct hist *h)
+{
+  char dir[PATH_MAX], name[PATH_MAX];
+  long long mb = atol(P_HISTDISK);
+  const char *s;
+  char *d;
+  int n;
+
+  if (h == NULL || P_HISTDIR[0] == 0 || dial_tty == NULL || mb <= 0)
+    return;
+  if (strncmp(P_HISTDIR, "~/", 2) == 0)
+    snprintf(dir, sizeof(dir), "%s%s", homedir, P_HISTDIR + 1);
+  else
+    snprintf(dir, sizeof(dir), "%s", P_HISTDIR);
+  mkdir(dir, 0700);
+
+  s = strncmp(dial_tty, "/dev/", 5) == 0 ? dial_tty + 5 : dial_tty;
+  n = snprintf(name, sizeof(name), "%s/", dir);
+  for (d = name + n; *s && d < name + sizeof(name) - 8; s++)
+    *d++ = isalnum((unsigned char)*s) || *s == '-' || *s == '.' ? *s : '_';
+  strcpy(d, ".hist");
+
+  if (hist_file(h, name, mb << 20) < 0)
+    werror(_("Cannot keep the history in %s: %s"), name, strerror(errno));
+}
+
+/*
+ * Give the history of the terminal window the budget that is set now.
+ */
+void hist_apply(void)
+{
+  long mem = hist_memory();
+
+  if (us == NULL)
+    return;
+  if (mem == 0) {
+    hist_close(us->hist);
+    us->hist = NULL;
+  } else if (us->hist)
+    hist_budget(us->hist, mem);
+  else {
+    us->hist = hist_open(mem);
+    hist_width(us->hist, us->xs);
+    hist_attach(us->hist);
+  }
+}
+
+/* What the terminal window showed, and its history, over a resize. */
+static struct wsave *us_saved;
+
 /*
  * Initialize screen and status line.
  */
@@ -370,6 +440,7 @@ void init_emul(int type, int do_init)
     x = us->curx;
     y = us->cury;
     attr = us->attr;
+    us_saved = mc_wsave(us);
     mc_wclose(us, 0);
   }
 
@@ -389,21 +460,22 @@ void init_emul(int type, int do_init)
     mc_wredraw(st, 1);
   }
 
-  /* MARK updated 02/17/95 - Customizable size for history buffer */
-  num_hist_lines = atoi(P_HISTSIZE);
-  if (num_hist_lines < 0)
-    num_hist_lines = 0;
-  if (num_hist_lines > 5000)
-    num_hist_lines = 5000;
-
-  /* Open a new main window, and define the configured history buffer size. */
-  us = mc_wopen(0, 0, COLS - 1, maxy,
-              BNONE, XA_NORMAL, tfcolor, tbcolor, 1, num_hist_lines, 0);
-
-  if (x >= 0) {
-    mc_wlocate(us, x, y);
-    mc_wsetattr(us, attr);
+  /* Open a new main window, and define the configured history buffer size.
+   * If there was one, it gets what that showed and its history, wrapped
+   * again if the width changed. */
+  us = mc_wopen(0, 0, COLS - 1, maxy, BNONE, XA_NORMAL, tfcolor, tbcolor,
+                1, us_saved ? 0 : hist_memory(), 0);
+  if (us_saved) {
+    mc_wrestore(us, us_saved);
+    us_saved = NULL;
+    hist_apply();
+  } else {
+    hist_attach(us->hist);
+    if (x >= 0)
+      mc_wlocate(us, x, y);
   }
+  if (x >= 0)
+    mc_wsetattr(us, attr);
 
   us->autocr = 0;
   us->wrap = wrapln;
@@ -415,7 +487,11 @@ void init_emul(int type, int do_init)
   /* Install and reset the terminal emulator. */
   if (do_init) {
     vt_install(do_output, kb_handler, us);
+    vt_std.capture = capture_write;
+    vt_std.answerback = P_ANSWERBACK;
+    vt_std.mapcap = P_CONVCAP[0] == 'Y';
     vt_init(type, tfcolor, tbcolor, us->wrap, addlf, addcr);
+    vt_set(-1, -1, -1, -1, local_echo, -1, -1, -1, -1);
   } else
     vt_pinit(us, -1, -1);
 
@@ -433,6 +509,23 @@ static void ret_csr(void)
   mc_wflush();
 }
 
+/* Set while screen updates are being skipped, see frame_tick(). */
+static int frame_skipping;
+static time_t frame_skipped;
+
+/*
+ * Show if screen updates are being skipped. This only changes the
+ * window; it is drawn with the next frame.
+ */
+static void skip_status(void)
+{
+  if (!st || COLS < 80)
+    return;
+  mc_wlocate(st, 76, 0);
+  mc_wputs(st, frame_skipping ? "SKP" : "   ");
+  mc_wlocate(us, us->curx, us->cury);
+}
+
 /*
  * Show baudrate, parity etc.
  */
@@ -480,6 +573,7 @@ void time_status(bool time_update_only)
 	    online / 3600, (online / 60) % 60);
 
     }
+  skip_status();
   ret_csr();
 }
 
@@ -499,6 +593,7 @@ void curs_status(void)
 static char status_message[80];
 static int  status_display_msg_until;
 static int  status_message_showing;
+static int  status_message_drawn;
 
 void status_set_display(const char *text, int duration_s)
 {
@@ -516,6 +611,7 @@ void status_set_display(const char *text, int duration_s)
   time(&t);
   status_display_msg_until = duration_s + t;
   status_message_showing = 1;
+  status_message_drawn = 0;
 }
 
 static void status_display_message(void)
@@ -527,7 +623,52 @@ static void status_display_message(void)
   ret_csr();
 }
 
+/* What field_status() shows now. */
+static char field_shown[16];
+
+/*
+ * Show how much output waits to be sent, and what holds it back if
+ * it is stuck. If nothing waits, show the receive rate and line
+ * errors instead, see stats_field(). This uses the place of the
+ * version number, like scriptname() does. Returns 1 if the status
+ * line changed.
+ */
+static int field_status(void)
+{
+  char now[16], size[24];
+  long n = txq_queued();
+  int why = txq_stalled();
+
+  now[0] = 0;
+  if (n > 0) {
+    if (n < 10000)
+      snprintf(size, sizeof(size), "%ld", n);
+    else if (n < 10000 * 1024L)
+      snprintf(size, sizeof(size), "%ldK", n / 1024);
+    else
+      snprintf(size, sizeof(size), "%ldM", n / (1024 * 1024));
+    snprintf(now, sizeof(now), "TX %.6s %s", size,
+             why == TXQ_CTS ? "CTS" : why == TXQ_XOFF ? "XOFF" :
+             why == TXQ_FULL ? "FULL" : "");
+  } else {
+    lat_field(now, sizeof(now));
+    if (now[0] == 0)
+      stats_field(now, sizeof(now));
+  }
+  if (!st || status_message_showing || strcmp(now, field_shown) == 0)
+    return 0;
+  strcpy(field_shown, now);
+  mc_wlocate(st, 39, 0);
+  if (now[0] == 0)
+    mc_wprintf(st, "Minicom %-6.6s", VERSION);
+  else
+    mc_wprintf(st, "%-14.14s", now);
+  ret_csr();
+  return 1;
+}
+
 time_t old_online = -2;
+static time_t online_start;	/* When we went online */
 
 /*
  * Update the online time.
@@ -543,8 +684,10 @@ static void update_status_time(void)
       status_message_showing = 0;
       if (st)
 	show_status();
-    } else
+    } else if (!status_message_drawn) {
       status_display_message();
+      status_message_drawn = 1;
+    }
   }
 
   if (old_online == online || online <= (old_online + 59))
@@ -577,20 +720,43 @@ static int get_device_status(int fd)
   return !tcgetattr(fd, &t);
 }
 
+/*
+ * DCD, asked from the driver at most every DCD_POLL_MS milliseconds,
+ * so that a fast stream doesn't cost an ioctl for every read.
+ */
+#define DCD_POLL_MS	250
+
+static int get_dcd(void)
+{
+  static struct timeval last;
+  static int dcd;
+  struct timeval now;
+  long ms;
+
+  gettimeofday(&now, NULL);
+  ms = (now.tv_sec - last.tv_sec) * 1000 +
+       (now.tv_usec - last.tv_usec) / 1000;
+  if (ms < 0 || ms >= DCD_POLL_MS) {
+    dcd = m_getdcd(portfd);
+    last = now;
+  }
+  return dcd;
+}
+
 /* Update the timer display. This can also be called from updown.c */
 void timer_update(void)
 {
-  static time_t t1, start;
+  static time_t t1;
   int dcd_support = P_HASDCD[0] == 'Y';
 
   /* See if we're online. */
   if ((!dcd_support && bogus_dcd)
-      || (dcd_support && m_getdcd(portfd) == 1)) {
+      || (dcd_support && get_dcd() == 1)) {
     /* We are online at the moment. */
     if (online < 0) {
       /* This was a transition from off to online */
-      time(&start);
-      t1 = start;
+      time(&online_start);
+      t1 = online_start;
       online = 0;
 #ifdef _DCDFLOW
       /* DCD has gotten high, we can turn on hw flow control */
@@ -609,7 +775,7 @@ void timer_update(void)
     if (online >= 0 && old_online >= 0) {
       /* First update the timer for call duration.. */
       time(&t1);
-      online = t1 - start;
+      online = t1 - online_start;
     }
     /* ..and THEN notify that we are now offline */
     online = -1;
@@ -618,12 +784,38 @@ void timer_update(void)
   /* Update online time */
   if (online >= 0) {
     time(&t1);
-    online = t1 - start;
+    online = t1 - online_start;
   }
 
   update_status_time();
 }
 
+/*
+ * Milliseconds until the status line needs an update: when a status
+ * message runs out, or the online time reaches the next minute.
+ * -1 if nothing is due.
+ */
+static int status_timeout(void)
+{
+  struct timeval now;
+  time_t when = 0;
+
+  if (status_message_showing)
+    when = status_display_msg_until + 1;
+  if (online >= 0 && !disable_online_time &&
+      (when == 0 || online_start + old_online + 60 < when))
+    when = online_start + old_online + 60;
+  if (when == 0)
+    return -1;
+
+  gettimeofday(&now, NULL);
+  if (when <= now.tv_sec)
+    return 0;
+  if (when - now.tv_sec > 86400)
+    return 86400 * 1000;
+  return (when - now.tv_sec) * 1000 - now.tv_usec / 1000;
+}
+
 /*
  * Show the status line 
  */
@@ -634,6 +826,7 @@ void show_status(void)
   mc_wprintf(st,
           _(" %7.7sZ for help |           |     | Minicom %-6.6s |       | "),
           esc_key(), VERSION);
+  field_shown[0] = 0;
   mode_status();
   time_status(false);
   curs_status();
@@ -679,6 +872,140 @@ static void showtemp(void)
   tempst = 1;
 }
 
+/*
+ * While receiving, the screen is drawn at most "fps" times a second so
+ * that a fast stream does not have to wait for the terminal. A frame
+ * that is due while the terminal can't take output is skipped; the
+ * next one shows the screen as it is by then.
+ */
+static int frame_pending;		/* Screen changed since the last frame */
+static struct timeval frame_last;	/* When the last frame was drawn */
+
+/* Milliseconds between frames, 0 to draw after every read. */
+static int frame_interval(void)
+{
+  int fps = atoi(P_FPS);
+
+  if (fps <= 0)
+    return 0;
+  if (fps > 1000)
+    fps = 1000;
+  return 1000 / fps;
+}
+
+/* Milliseconds until a frame may be drawn again. */
+static int frame_wait(void)
+{
+  struct timeval now;
+  long ms;
+  int interval;
+
+  if ((interval = frame_interval()) == 0)
+    return 0;
+  gettimeofday(&now, NULL);
+  ms = (now.tv_sec - frame_last.tv_sec) * 1000 +
+       (now.tv_usec - frame_last.tv_usec) / 1000;
+  if (ms < 0 || ms >= interval)
+    return 0;
+  return interval - ms;
+}
+
+/*
+ * Milliseconds until the next frame is due, -1 if there is nothing to draw.
+ */
+static int frame_timeout(void)
+{
+  if (!frame_pending)
+    return -1;
+  return frame_wait();
+}
+
+static void frame_draw(void)
+{
+  frame_pending = 0;
+  gettimeofday(&frame_last, NULL);
+  mc_wflush();
+}
+
+/*
+ * Called from the main loop: draw a frame if one is due.
+ */
+static void frame_tick(void)
+{
+  if (frame_skipping && time(NULL) > frame_skipped + 1) {
+    frame_skipping = 0;
+    skip_status();
+    frame_pending = 1;
+  }
+  if (frame_timeout() != 0)
+    return;
+  if (frame_interval() > 0 && !mc_wready()) {
+    /* Try again one frame later. */
+    gettimeofday(&frame_last, NULL);
+    frame_skipped = frame_last.tv_sec;
+    if (!frame_skipping) {
+      frame_skipping = 1;
+      skip_status();
+    }
+    return;
+  }
+  frame_draw();
+}
+
+/* Put received data on the screen, or in hex. */
+static void term_out(const char *s, int n)
+{
+  int i;
+
+  if (display_hex) {
+    for (i = 0; i < n; i++) {
+      unsigned char c = s[i];
+      unsigned char u = c >> 4;
+      c &= 0xf;
+      vt_out(u > 9 ? 'a' + (u - 10) : '0' + u);
+      vt_out(c > 9 ? 'a' + (c - 10) : '0' + c);
+      vt_out(' ');
+    }
+  } else
+    vt_out_buf(s, n);
+}
+
+/*
+ * Stop reading the port in the background, because another program
+ * or the dialer reads it now. What was read but not shown yet, in
+ * the backlog and the receive ring, goes through the emulator (and so
+ * into the capture file) first, so nothing is lost or comes late.
+ */
+void term_replay(void)
+{
+  char buf[4096], obuf[4096], *ptr, *otmp;
+  size_t ilen, olen;
+  int n, i;
+
+  backlog_stop();
+  rxring_stop();
+  while ((n = backlog_read(buf, sizeof(buf))) > 0 ||
+         (n = rxring_read(buf, sizeof(buf), NULL)) > 0) {
+    if (P_PARITY[0] == 'M' || P_PARITY[0] == 'S')
+      for (i = 0; i < n; i++)
+        buf[i] &= 0x7f;
+    if (using_iconv()) {
+      ptr = buf;
+      ilen = n;
+      while (ilen > 0) {
+        otmp = obuf;
+        olen = sizeof(obuf);
+        do_iconv(&ptr, &ilen, &otmp, &olen);
+        if (olen == sizeof(obuf))
+          break;
+        term_out(obuf, sizeof(obuf) - olen);
+      }
+    } else
+      term_out(buf, n);
+  }
+  mc_wflush();
+}
+
 /*
  * The main terminal loop:
  *	- If there are characters received send them
@@ -686,11 +1013,19 @@ static void showtemp(void)
  */
 int do_terminal(void)
 {
-  char buf[128];
+  static char *obuf;
+  static int obuf_size;
+  char *buf;
+  int buf_size;
   int buf_offset = 0;
   int c;
   int x;
-  int blen;
+  int tmout;
+  long lost;
+  time_t now;
+  static time_t port_checked;
+  int port_suspect = 0;
+  int blen, n;
   int zauto = 0;
   static const char zsig[] = "**\030B00";
   int zpos = 0;
@@ -698,7 +1033,25 @@ int do_terminal(void)
   dirflush = 0;
   WIN *error_on_open_window = NULL;
 
+  /* The iconv output buffer follows the size of the receive buffer. */
+  buf = io_rxbuf(&buf_size);
+  if (obuf_size != buf_size) {
+    free(obuf);
+    obuf_size = 0;
+    if ((obuf = malloc(buf_size)) != NULL)
+      obuf_size = buf_size;
+  }
+
 dirty_goto:
+  /* The port is ours again. What came in meanwhile is replayed first. */
+  backlog_stop();
+  if ((lost = backlog_lost()) > 0) {
+    char msg[80];
+
+    snprintf(msg, sizeof(msg), _("Backlog full, %ld bytes lost"), lost);
+    status_set_display(msg, 0);
+  }
+
   /* Show off or online time */
   update_status_time();
 
@@ -724,7 +1077,9 @@ dirty_goto:
     if (size_changed) {
       size_changed = 0;
       wrapln = us->wrap;
-      /* I got the resize code going again! Yeah! */
+      /* I got the resize code going again! Yeah! The history and what
+       * is on the screen go over to the new window. */
+      us_saved = mc_wsave(us);
       mc_wclose(us, 0);
       us = NULL;
       if (st)
@@ -740,47 +1095,97 @@ dirty_goto:
     /* Update the timer. */
     timer_update();
 
-    /* check if device is ok, if not, try to open it */
-    if (!get_device_status(portfd_connected)) {
-      /* Ok, it's gone, most probably someone unplugged the USB-serial, we
-       * need to free the FD so that a replug can get the same device
-       * filename, open it again and be back */
-      int reopen = portfd == -1;
-      close(portfd);
-      lockfile_remove();
-      portfd = -1;
-      if (open_term(reopen, reopen, 1) < 0) {
-        if (!error_on_open_window)
-          error_on_open_window = mc_tell(_("Cannot open %s!"), dial_tty);
-      } else {
-        if (error_on_open_window) {
-          mc_wclose(error_on_open_window, 1);
-          error_on_open_window = NULL;
+    /* Check if the device is ok once a second, or right away when
+     * the port reported a hangup or error; if not, try to open it. */
+    time(&now);
+    if (port_suspect || now != port_checked) {
+      port_suspect = 0;
+      port_checked = now;
+      if (!get_device_status(portfd_connected)) {
+        /* Ok, it's gone, most probably someone unplugged the USB-serial, we
+         * need to free the FD so that a replug can get the same device
+         * filename, open it again and be back */
+        int reopen = portfd == -1;
+        term_replay();
+        paste_stop();
+        txq_clear();
+        close(portfd);
+        lockfile_remove();
+        portfd = -1;
+        n = open_term(reopen, reopen, 1);
+        PROBE1(device_reopen, n < 0 ? -1 : portfd);
+        if (n < 0) {
+          if (!error_on_open_window)
+            error_on_open_window = mc_tell(_("Cannot open %s!"), dial_tty);
+        } else {
+          if (error_on_open_window) {
+            mc_wclose(error_on_open_window, 1);
+            error_on_open_window = NULL;
+          }
         }
       }
     }
 
-    /* Check for I/O or timer. */
-    x = check_io(portfd_connected, 0, 1000,
-                 buf + buf_offset, sizeof(buf) - buf_offset, &blen);
+    /* Read the port through the reader thread, if configured. */
+    rxring_start(portfd_connected);
+
+    /* Check for I/O or timer. Sleep until the next thing that is
+     * due: a capture flush, a frame, a status line update (also
+     * of the rate), the next byte of a paced send, or an attempt
+     * to open the port again. Unless "tickless" is set, we also
+     * look at the device and DCD once a second. */
+    tmout = capture_timeout();
+    n = frame_timeout();
+    if (n >= 0 && (tmout < 0 || n < tmout))
+      tmout = n;
+    n = status_timeout();
+    if (n >= 0 && (tmout < 0 || n < tmout))
+      tmout = n;
+    n = txq_timeout();
+    if (n >= 0 && (tmout < 0 || n < tmout))
+      tmout = n;
+    n = stats_timeout();
+    if (n >= 0 && (tmout < 0 || n < tmout))
+      tmout = n;
+    n = lat_timeout();
+    if (n >= 0 && (tmout < 0 || n < tmout))
+      tmout = n;
+    if ((portfd_connected < 0 || P_TICKLESS[0] != 'Y') &&
+        (tmout < 0 || tmout > 1000))
+      tmout = 1000;
+    if (backlog_pending()) {
+      blen = backlog_read(buf + buf_offset, buf_size - buf_offset - 1);
+      x = 1 | check_io(-1, 0, 0, NULL, 0, NULL);
+    } else
+      x = check_io(portfd_connected, 0, tmout,
+                   buf + buf_offset, buf_size - buf_offset, &blen);
+
+    if (blen > 0)
+      lat_rx(buf + buf_offset, blen);
+
+    /* Readable but nothing to read means a hangup or an error. */
+    if ((x & 1) == 1 && blen <= 0)
+      port_suspect = 1;
     blen += buf_offset;
     buf_offset = 0;
 
     /* Data from the modem to the screen. */
     if ((x & 1) == 1) {
-      char obuf[sizeof(buf)];
       char *ptr;
 
-      if (using_iconv()) {
+      if (using_iconv() && obuf) {
         char *otmp = obuf;
-        size_t output_len = sizeof(obuf);
+        size_t output_len = obuf_size;
         size_t input_len = blen;
 
+        INSTR_START(t);
+
         ptr = buf;
         do_iconv(&ptr, &input_len, &otmp, &output_len);
+        INSTR_END(IN_ICONV, t, blen - input_len);
 
         // something happened at all?
-        if (output_len < sizeof(obuf))
+        if (output_len < (size_t)obuf_size)
           {
             if (input_len)
               { // something remained, we need to adapt buf accordingly
@@ -788,7 +1193,7 @@ dirty_goto:
                 buf_offset = input_len;
               }
 
-            blen = sizeof(obuf) - output_len;
+            blen = obuf_size - output_len;
             ptr = obuf;
           }
 	else
@@ -797,26 +1202,39 @@ dirty_goto:
         ptr = buf;
       }
 
-      while (blen-- > 0) {
-        /* Auto zmodem detect */
-        if (zauto) {
-          if (zsig[zpos] == *ptr)
-            zpos++;
-          else
-            zpos = 0;
+      /* Data that comes in between frames scrolls in memory only. */
+      mc_wdefer(frame_wait() > 0);
+      while (blen > 0) {
+        /* Mask parity and look for the zmodem signature. A chunk
+         * ends right after a complete signature. */
+        for (n = 0; n < blen; ) {
+          if (zauto) {
+            if (zsig[zpos] == ptr[n])
+              zpos++;
+            else
+              zpos = 0;
+          }
+          if (P_PARITY[0] == 'M' || P_PARITY[0] == 'S')
+            ptr[n] &= 0x7f;
+          n++;
+          if (zauto && zsig[zpos] == 0)
+            break;
         }
-        if (P_PARITY[0] == 'M' || P_PARITY[0] == 'S')
-          *ptr &= 0x7f;
-        if (display_hex) {
-          unsigned char c = *ptr++;
-          unsigned char u = c >> 4;
-          c &= 0xf;
-          vt_out(u > 9 ? 'a' + (u - 10) : '0' + u);
-          vt_out(c > 9 ? 'a' + (c - 10) : '0' + c);
-          vt_out(' ');
-        } else
-          vt_out(*ptr++);
+        INSTR_START(t);
+        term_out(ptr, n);
+        INSTR_END(IN_EMUL, t, n);
+        ptr += n;
+        blen -= n;
         if (zauto && zsig[zpos] == 0) {
+          /* The rest is for the transfer program. It reads the
+           * port itself, so what the ring has of it is lost. */
+          PROBE(zmodem_trigger);
+          backlog_clear();
+          rxring_stop();
+          rxring_drop();
+          mc_wdefer(0);
+          capture_flush();
+          frame_draw();
           dirflush = 1;
           keyboard(KSTOP, 0);
           updown('D', zauto - 'A');
@@ -826,15 +1244,31 @@ dirty_goto:
           goto dirty_goto;
         }
       }
-      mc_wflush();
+      mc_wdefer(0);
+      frame_pending = 1;
+    }
+    capture_tick();
+    txq_run();
+    paste_more();
+    lat_tick();
+    stats_tick();
+    if (field_status())
+      frame_pending = 1;
+    if (stats_wanted) {
+      stats_wanted = 0;
+      stats_dump();
     }
+    frame_tick();
 
     /* Read from the keyboard and send to modem. */
     if ((x & 2) == 2) {
       /* See which key was pressed. */
       c = keyboard(KGETKEY, 0);
-      if (c == EOF)
+      if (c == EOF) {
+        capture_flush();
+        frame_draw();
         return EOF;
+      }
 
       if (c < 0) /* XXX - shouldn't happen */
         c += 256;
@@ -849,6 +1283,9 @@ dirty_goto:
 
         /* Show status line temporarily */
         showtemp();
+
+        /* Keep reading the port while the user is in a menu. */
+        backlog_start(portfd_connected);
         if (c == escape) /* CTRL A */
           c = keyboard(KGETKEY, 0);
 
@@ -860,8 +1297,11 @@ dirty_goto:
         if (c > 128)
           c -= 128;
         if (c > ' ') {
+          lat_forget();
           dirflush = 1;
           m_flush(0);
+          capture_flush();
+          frame_draw();
           return c;
         }
         /* CTRLA - CTRLA means send one CTRLA */
@@ -873,7 +1313,16 @@ dirty_goto:
         goto dirty_goto;
       }
 
-      /* No, just a key to be sent. */
+      /* No, just a key to be sent. A ^C also stops a paste or
+       * macro that is still going out. */
+      if (c == 3)
+        paste_stop();
+      if (c == 3 && (lost = txq_cancel()) > 0) {
+        char msg[80];
+
+        snprintf(msg, sizeof(msg), _("Send cancelled, %ld bytes dropped"), lost);
+        status_set_display(msg, 0);
+      }
       if (c >= K_F1 && c <= K_F10 && P_MACENAB[0] == 'Y') {
         s = "";
         switch(c) {
@@ -92,10 +92,9 @@ static void do_hang(int askit)
  */
 static void hangsig(int sig)
 {
+  capture_close();
   if (stdwin)
     werror(_("Killed by signal %d !\n"), sig);
-  if (capfp)
-    fclose(capfp);
 
   keyboard(KUNINSTALL, 0);
   hangup();
@@ -165,20 +164,24 @@ static void shjump(int sig)
 static ELM *mc_getline(WIN *w, int no)
 {
   int i;
+  int nhist = hist_lines(us->hist);
+  static ELM line[MAXCOLS];
   static ELM outofrange[MAXCOLS] = {{0,0,0}};
 
-  if (no < us->histlines) {
+  if (no < nhist) {
     /* Get a line from the history buffer. */
-    i = no + us->histline /*- 1*/;
-    if (i >= us->histlines)
-      i -= us->histlines;
-    if (i < 0)
-      i = us->histlines - 1;
-    return us->histbuf + (i * us->xs);
+    if (hist_get(us->hist, no, line, us->xs) < 0) {
+      for (i = 0; i < us->xs; i++) {
+        line[i].value = ' ';
+        line[i].color = us->color;
+        line[i].attr  = us->attr;
+      }
+    }
+    return line;
   }
 
   /* Get a line from the "us" window. */
-  no -= us->histlines;
+  no -= nhist;
   if (no >= w->ys) {
     if (outofrange[0].value == 0) {
       for (i = 0; i < MAXCOLS; i++) {
@@ -206,35 +209,41 @@ static void drawhist(WIN *w, int y, int r)
   w->direct = 1;
 }
 
+/*
+ * Draw line e at row y, with the places that look finds in it in
+ * reverse.
+ */
+static void drawhist_line(WIN *w, int y, ELM *e, struct hfind *look)
+{
+  ELM line[MAXCOLS];
+  char mark[MAXCOLS];
+  int x;
+
+  if (!hist_marks(look, e, w->xs, mark)) {
+    mc_wdrawelm(w, y, e);
+    return;
+  }
+  for (x = 0; x < w->xs; x++) {
+    line[x] = e[x];
+    if (mark[x])
+      line[x].attr ^= XA_REVERSE;
+  }
+  mc_wdrawelm(w, y, line);
+}
+
 /*
  * fmg 8/20/97
  * drawhist_look()
- * Redraw the window, highlight line that was found to contain
- * pattern 'look'
+ * Redraw the window, highlight every match of pattern 'look'
  * Needed by re-draw screen function after EACH find_next()
  */
-void drawhist_look(WIN *w, int y, int r, wchar_t *look, int case_matters)
+void drawhist_look(WIN *w, int y, int r, struct hfind *look)
 {
   int f;
-  ELM *tmp_e;
-  wchar_t tmp_line[MAXCOLS];
 
-  tmp_line[0]='\0';
   w->direct = 0;
-  for (f = 0; f < w->ys; f++) {
-    tmp_e = mc_getline(w, y++);
-
-    /* First we "accumulate" the line into a variable */
-    mc_wdrawelm_var(w, tmp_e, tmp_line);
-
-    /* Does it have what we want? */
-    if (wcslen(look) > 1 && wcslen(tmp_line) > 1) {
-      if (StrStr(tmp_line,look, case_matters))
-        mc_wdrawelm_inverse(w, f, tmp_e); /* 'inverse' it */
-      else
-        mc_wdrawelm(w, f, tmp_e); /* 'normal' output */
-    }
-  }
+  for (f = 0; f < w->ys; f++)
+    drawhist_line(w, f, mc_getline(w, y++), look);
 
   if (r)
     mc_wredraw(w, 1);
@@ -246,9 +255,9 @@ void drawhist_look(WIN *w, int y, int r, wchar_t *look, int case_matters)
  * Search history - main function that started the C-code blasphemy :-)
  * This function doesn't care about case/case-less status...
  */
-void searchhist(WIN *w_hist, wchar_t *str)
+void searchhist(WIN *w_hist, wchar_t *str, int regex)
 {
-  int y;
+  int x, y;
   WIN *w_new;
   const char *hline;
   size_t i;
@@ -263,15 +272,18 @@ void searchhist(WIN *w_hist, wchar_t *str)
   w_new->doscroll = 0;
   w_new->wrap = 0;
 
-  hline = _("SEARCH FOR (ESC=Exit)");
-  mc_wprintf(w_new, "%s(%d):",hline,MAX_SEARCH);
+  if (regex)
+    hline = _("SEARCH REGEX (ESC=Exit)");
+  else
+    hline = _("SEARCH FOR (ESC=Exit)");
+  mc_wprintf(w_new, "%s(%d): ",hline,MAX_SEARCH);
+  x = w_new->curx;
   mc_wredraw(w_new, 1);
   mc_wflush();
 
-  mc_wlocate(w_new, mbslen(hline)+6, 0);
   for (i = 0; str[i] != 0; i++)
     mc_wputc(w_new, str[i]);
-  mc_wlocate(w_new, mbslen(hline)+6, 0);
+  mc_wlocate(w_new, x, 0);
   mc_wgetwcs(w_new, str, MAX_SEARCH, MAX_SEARCH);
 #if 0
   if (!str[0]) { /* then unchanged... must have pressed ESC... get out */
@@ -288,87 +300,191 @@ void searchhist(WIN *w_hist, wchar_t *str)
   return;
 }
 
+/*
+ * The lines that have the pattern, in order. They are counted while
+ * no key is pressed, HITS_STEP lines at a time, so N, P and the "hit
+ * 12 of 340" on the help line do not have to look again; lines from
+ * "next" on are not counted yet.
+ */
+#define HITS_STEP	32768
+
+static struct {
+  long *line;
+  long n, max;
+  long next;
+  int done;
+} hits;
+
+static void hits_clear(void)
+{
+  hits.n = 0;
+  hits.next = 0;
+  hits.done = 0;
+}
+
+/* How many of the lines counted are before line y. */
+static long hits_before(long y)
+{
+  long lo = 0, hi = hits.n, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (hits.line[mid] < y)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Count on for another HITS_STEP lines. */
+static void hits_more(WIN *w_hist, struct hfind *look)
+{
+  long nhist = hist_lines(us->hist);
+  long all_lines = nhist + w_hist->ys;
+  long end = hits.next + HITS_STEP, y, *l;
+
+  while (hits.next < end && hits.next < all_lines) {
+    if (hits.next < nhist) {
+      y = hist_find(us->hist, look, hits.next, (end < nhist ? end : nhist) - 1);
+      if (y < 0) {
+        hits.next = end < nhist ? end : nhist;
+        continue;
+      }
+    } else if (!hist_match(look, mc_getline(w_hist, hits.next), us->xs)) {
+      hits.next++;
+      continue;
+    } else
+      y = hits.next;
+    if (hits.n == hits.max) {
+      if ((l = realloc(hits.line, (hits.max + 1024) * 2 * sizeof(long))) == NULL) {
+        /* Then N and P look for themselves. */
+        hits.done = 1;
+        return;
+      }
+      hits.line = l;
+      hits.max = (hits.max + 1024) * 2;
+    }
+    hits.line[hits.n++] = y;
+    hits.next = y + 1;
+  }
+  if (hits.next >= all_lines)
+    hits.done = 1;
+}
+
+/* Show the help line, and how far into the hits line y is. */
+static void show_hits(WIN *w_st, const char *hline, long y)
+{
+  char buf[64];
+  long i = hits_before(y);
+  int len, n;
+
+  if (i < hits.n && hits.line[i] == y)
+    snprintf(buf, sizeof(buf), _(" hit %ld of %ld%s"), i + 1, hits.n,
+             hits.done ? "" : "+");
+  else if (hits.done && hits.n == 0)
+    snprintf(buf, sizeof(buf), "%s", _(" no hits"));
+  else
+    snprintf(buf, sizeof(buf), _(" %ld%s hits"), hits.n,
+             hits.done ? "" : "+");
+  len = strlen(buf);
+  /* Where they overlap, the help line stops at a word before the count. */
+  n = strlen(hline);
+  if (len < w_st->xs - 1 && n > w_st->xs - 2 - len) {
+    n = w_st->xs - 2 - len;
+    while (n > 0 && hline[n] != ' ')
+      n--;
+  }
+  mc_wlocate(w_st, 0, 0);
+  mc_wprintf(w_st, "%.*s", n, hline);
+  mc_wclreol(w_st);
+  /* The last column stays empty, as the help line leaves it. */
+  if (len < w_st->xs - 1) {
+    mc_wlocate(w_st, w_st->xs - 1 - len, 0);
+    mc_wprintf(w_st, "%s", buf);
+  }
+  mc_wredraw(w_st, 1);
+}
+
 /*
  * fmg 8/20/97
  * Move scope to next hit of pattern in the buffer.
  * Returns line-number of next "hit_line" or -1 if none found
  * (we beep elsewhere ;-)
+ * What has been counted already is taken from the hits, the rest
+ * of the history is searched through the text it keeps of its lines,
+ * only the lines on the screen are looked at one by one.
  */
 int find_next(WIN *w, WIN *w_hist,
-              int hit_line,     /* 'current' Match line */
-              wchar_t *look,    /* pattern */
-              int case_matters) /* guess... */
+              int hit_line,		/* 'current' Match line */
+              struct hfind *look)	/* pattern */
 {
-  int next_line;
-  ELM *tmp_e;
-  wchar_t tmp_line[MAXCOLS];
-  int all_lines;
+  int nhist = hist_lines(w->hist);
+  int all_lines = nhist + w_hist->ys;
+  long i;
+  int y;
 
   if (!look)
     return(++hit_line); /* next line */
 
-  tmp_line[0] = '\0';	/* Personal phobia, I need to do this.. */
-
   hit_line++;           /* we NEED this so we don't search only same line! */
-  all_lines = w->histlines + w_hist->ys;
 
   if (hit_line >= all_lines) {	/* Make sure we've got a valid line! */
     werror(_("Search Wrapping Around to Start!"));
     hit_line = 0;
   }
 
-  for (next_line = hit_line; next_line <= all_lines; next_line++) {
-    /* we do 'something' here... :-) */
-    tmp_e = mc_getline(w_hist, next_line);
-
-    /*
-     * First we "accumulate" the line into a variable.
-     * To see 'why', see what an 'ELM' structure looks like!
-     */
-    mc_wdrawelm_var(w, tmp_e, tmp_line);
-
-    /* Does it have what we want? */
-    if (wcslen(tmp_line) > 1 && wcslen(look) > 1)
-      if (StrStr(tmp_line, look, case_matters))
-        return next_line;
-  }
+  if ((i = hits_before(hit_line)) < hits.n)
+    return hits.line[i];
+  if (hits.done)
+    return -1;
+  if (hit_line < hits.next)
+    hit_line = hits.next;
 
-  if (hit_line >= all_lines) {	/* Make sure we've got a valid line! */
-    werror(_("Search Wrapping Around to Start!"));
-    hit_line = 0;
-  }
+  if (hit_line < nhist &&
+      (y = hist_find(w->hist, look, hit_line, nhist - 1)) >= 0)
+    return y;
+  for (y = hit_line > nhist ? hit_line : nhist; y < all_lines; y++)
+    if (hist_match(look, mc_getline(w_hist, y), w->xs))
+      return y;
 
   return -1; /* nothing found! */
 }
 
 /*
- * fmg 8/22/97
- * Needed this for the case-less conparison... and Linux libc
- * doesn't seem to have a strnstr function... so we fudge.. ;-)
+ * The same, going back: the hit before hit_line.
  */
-const wchar_t *upcase(wchar_t *dest, wchar_t *src)
+int find_prev(WIN *w, WIN *w_hist, int hit_line, struct hfind *look)
 {
-  wchar_t *d = dest;
+  int nhist = hist_lines(w->hist);
+  int all_lines = nhist + w_hist->ys;
+  long i;
+  int y;
 
-  while (*src)
-    *d++ = towupper(*src++);
-  *d = '\0';
-  return dest;
-}
+  if (!look)
+    return hit_line > 0 ? hit_line - 1 : 0;
 
-/*
- * fmg 8/22/97
- * Needed this for the case-less conparison... and Linux libc
- * doesn't seem to have a strnstr function... so we fudge.. ;-)
- */
-wchar_t *StrStr(wchar_t *str1, wchar_t *str2, int case_matters)
-{
-  wchar_t tmpstr1[MAXCOLS], tmpstr2[MAXCOLS];
+  hit_line--;
+  if (hit_line < 0) {
+    werror(_("Search Wrapping Around to End!"));
+    hit_line = all_lines - 1;
+  }
 
-  if (case_matters)
-    return wcsstr(str1, str2);
-  else
-    return wcsstr(upcase(tmpstr1, str1), upcase(tmpstr2, str2));
+  /* Not counted yet, down to hits.next. */
+  if (hit_line >= hits.next && !hits.done) {
+    for (y = hit_line; y >= nhist && y >= hits.next; y--)
+      if (hist_match(look, mc_getline(w_hist, y), w->xs))
+        return y;
+    if (hits.next < nhist &&
+        (y = hist_find(w->hist, look, hit_line < nhist ? hit_line : nhist - 1,
+                       hits.next)) >= 0)
+      return y;
+    hit_line = hits.next - 1;
+  }
+  if ((i = hits_before(hit_line + 1)) > 0)
+    return hits.line[i - 1];
+
+  return -1;
 }
 
 static void drawcite(WIN *w, int y, int citey, int start, int end)
@@ -421,10 +537,11 @@ static void scrollback(void)
 {
   int y,c;
   WIN *b_us, *b_st;
-  ELM *tmp_e;
   int case_matters=0;	/* fmg: case-importance, needed for 'N' */
+  static int regex=0;	/* The last search was a regular expression */
   static wchar_t look_for[MAX_SEARCH];	/* fmg: last used search pattern */
-  wchar_t tmp_line[MAXCOLS];
+  struct hfind *look = NULL;		/* look_for, ready to search */
+  char err[128];
   int citemode = 0;
   int cite_ystart = 1000000,
       cite_yend = -1,
@@ -459,7 +576,7 @@ static void scrollback(void)
    * Hope you like it :-)
    */
   strcpy(hline0,
-         _("HISTORY: U=Up D=Down F=PgDn B=PgUp s=Srch S=CaseLess N=Next C=Cite ESC=Exit "));
+         _("HISTORY: U/D/B/F=Move s/S=Srch/NoCase r/R=Regex N/P=Nxt/Prv C=Cite ESC=Exit"));
 
   if (b_st->xs < 127)
     hline0[b_st->xs] = 0;
@@ -469,7 +586,7 @@ static void scrollback(void)
   mc_wflush();
 
   /* And do the job. */
-  y = us->histlines;
+  y = hist_lines(us->hist);
 
   /* fmg 8/20/97
    * Needed for N)extSearch, keeps track of line on which current "hit"
@@ -477,10 +594,22 @@ static void scrollback(void)
    * of history stack
    */
   hit = 0;
+  if (wcslen(look_for) > 1)
+    look = hist_findopen(look_for, !case_matters, regex, NULL, 0);
+  hits_clear();
 
   drawhist(b_us, y, 0);
 
   while (loop) {
+    /* Count the hits until a key is pressed. */
+    if (look && !citemode)
+      show_hits(b_st, hline, y);
+    while (look && !hits.done && !backlog_key(0)) {
+      hits_more(b_us, look);
+      if (!citemode)
+        show_hits(b_st, hline, y);
+      mc_wflush();
+    }
     c = wxgetch();
     switch (c) {
       /*
@@ -489,6 +618,7 @@ static void scrollback(void)
        */
       case '\\':
       case 'S':
+      case 'R':
         case_matters = 0; /* case-importance, ie. none :-) */
         /*
          * fmg 8/22/97
@@ -496,12 +626,13 @@ static void scrollback(void)
          */
       case '/':
       case 's':
-        if (!us->histlines) {
+      case 'r':
+        if (!us->hist) {
           mc_wbell();
           werror(_("History buffer Disabled!"));
           break;
         }
-        if (!us->histline) {
+        if (!hist_lines(us->hist)) {
           mc_wbell();
           werror(_("History buffer empty!"));
           break;
@@ -510,18 +641,30 @@ static void scrollback(void)
           break;
 
         /* we need this for the case-importance-toggle to work.. */
-        if (c == '/' || c == 's')
+        if (c == '/' || c == 's' || c == 'r')
           case_matters=1; /* case-importance, ie. DOES */
+        regex = (c == 'r' || c == 'R');
 
         /* open up new search window... */
-        searchhist(b_us, look_for);
+        searchhist(b_us, look_for, regex);
         /* must redraw status line... */
         mc_wlocate(b_st, 0, 0); /* move back to column 0! */
         mc_wprintf(b_st, "%s", hline); /* and show the above-defined hline */
+        mc_wclreol(b_st);
         mc_wredraw(b_st, 1); /* again... */
+        hist_findclose(look);
+        look = NULL;
+        hits_clear();
+        if (wcslen(look_for) > 1 &&
+            (look = hist_findopen(look_for, !case_matters, regex,
+                                  err, sizeof(err))) == NULL) {
+          mc_wbell();
+          werror(_("Bad pattern: %s"), err);
+          break;
+        }
         /* highlight any matches */
-        if (wcslen(look_for) > 1) {
-          hit = find_next(us, b_us, y, look_for, case_matters);
+        if (look) {
+          hit = find_next(us, b_us, y, look);
 
           if (hit == -1) {
             mc_wbell();
@@ -529,7 +672,7 @@ static void scrollback(void)
             hit = 0;
             break;
           }
-          drawhist_look(b_us, hit, 1, look_for, case_matters);
+          drawhist_look(b_us, hit, 1, look);
           y = hit;
         } else {
           mc_wbell();
@@ -545,11 +688,16 @@ static void scrollback(void)
          */
       case 'n':
       case 'N':
-        /* highlight NEXT match */
+      case 'p':
+      case 'P':
+        /* highlight NEXT (or previous) match */
         if (citemode)
           break;
-        if (wcslen(look_for) > 1) {
-          hit = find_next(us, b_us, y, look_for, case_matters);
+        if (look) {
+          if (c == 'p' || c == 'P')
+            hit = find_prev(us, b_us, y, look);
+          else
+            hit = find_next(us, b_us, y, look);
 
           if (hit == -1) {
             mc_wbell();
@@ -557,7 +705,7 @@ static void scrollback(void)
             hit = 0;
             break;
           }
-          drawhist_look(b_us, hit, 1, look_for, case_matters);
+          drawhist_look(b_us, hit, 1, look);
           y = hit;
         } else	{ /* no search pattern... */
           mc_wbell();
@@ -594,21 +742,12 @@ static void scrollback(void)
          */
         if (citemode) {
           inverse = (y+cite_y >= cite_ystart && y+cite_y <= cite_yend);
-        } else {
-          tmp_e = mc_getline(b_us, y);
-          if (wcslen(look_for) > 1) {
-            /* quick scan for pattern match */
-            mc_wdrawelm_var(b_us, tmp_e, tmp_line);
-            inverse = (wcslen(tmp_line)>1 &&
-                         StrStr(tmp_line, look_for, case_matters));
-          } else
-            inverse = 0;
-        }
-
-        if (inverse)
-          mc_wdrawelm_inverse(b_us, 0, mc_getline(b_us, y));
-        else
-          mc_wdrawelm(b_us, 0, mc_getline(b_us, y));
+          if (inverse)
+            mc_wdrawelm_inverse(b_us, 0, mc_getline(b_us, y));
+          else
+            mc_wdrawelm(b_us, 0, mc_getline(b_us, y));
+        } else
+          drawhist_line(b_us, 0, mc_getline(b_us, y), look);
         if (citemode)
           mc_wlocate(b_us, 0, cite_y);
         mc_wflush();
@@ -627,7 +766,7 @@ static void scrollback(void)
           break;
         }
 
-        if (y >= us->histlines)
+        if (y >= hist_lines(us->hist))
           break;
         y++;
         if (cite_ystart != 1000000)
@@ -642,23 +781,15 @@ static void scrollback(void)
          */
         if (citemode) {
           inverse = (y+cite_y >= cite_ystart && y+cite_y <= cite_yend);
-        } else {
-          tmp_e = mc_getline(b_us, y + b_us->ys - 1);
-          if (wcslen(look_for) > 1) {
-            /* quick scan for pattern match */
-            mc_wdrawelm_var(b_us, tmp_e, tmp_line);
-            inverse = (wcslen(tmp_line)>1 &&
-                         StrStr(tmp_line, look_for, case_matters));
-          } else
-            inverse = 0;
-        }
-
-        if (inverse)
-          mc_wdrawelm_inverse(b_us, b_us->ys - 1,
-                           mc_getline(b_us, y + b_us->ys - 1));
-        else
-          mc_wdrawelm(b_us, b_us->ys - 1,
-                   mc_getline(b_us, y + b_us->ys - 1));
+          if (inverse)
+            mc_wdrawelm_inverse(b_us, b_us->ys - 1,
+                             mc_getline(b_us, y + b_us->ys - 1));
+          else
+            mc_wdrawelm(b_us, b_us->ys - 1,
+                     mc_getline(b_us, y + b_us->ys - 1));
+        } else
+          drawhist_line(b_us, b_us->ys - 1,
+                        mc_getline(b_us, y + b_us->ys - 1), look);
         if (citemode)
           mc_wlocate(b_us, 0, cite_y);
         mc_wflush();
@@ -680,8 +811,8 @@ static void scrollback(void)
          * the lines that have the pattern we wanted... it's just nice.
          * Highlight any matches
          */
-        if (wcslen(look_for) > 1 && us->histline)
-          drawhist_look(b_us, y, 1, look_for, case_matters);
+        if (look && hist_lines(us->hist))
+          drawhist_look(b_us, y, 1, look);
         else
           drawhist(b_us, y, 1);
 
@@ -692,11 +823,11 @@ static void scrollback(void)
       case 'F':
       case ' ': /* filipg: space bar will go page-down... pager-like */
       case K_PGDN:
-        if (y >= us->histlines)
+        if (y >= hist_lines(us->hist))
           break;
         y += b_us->ys;
-        if (y > us->histlines)
-          y=us->histlines;
+        if (y > hist_lines(us->hist))
+          y = hist_lines(us->hist);
         if (cite_ystart != 1000000)
           cite_yend = y + cite_y;
 
@@ -706,8 +837,8 @@ static void scrollback(void)
          * the lines that have the pattern we wanted... it's just nice.
          * Highlight any matches
          */
-        if (wcslen(look_for) > 1 && us->histline)
-          drawhist_look(b_us, y, 1, look_for, case_matters);
+        if (look && hist_lines(us->hist))
+          drawhist_look(b_us, y, 1, look);
         else
           drawhist(b_us, y, 1);
         if (citemode)
@@ -775,13 +906,26 @@ static void scrollback(void)
   /* Cleanup. */
   if (citemode)
     do_cite(b_us, cite_ystart, cite_yend);
-  mc_wclose(b_us, y == us->histlines ? 0 : 1);
+  hist_findclose(look);
+  free(hits.line);
+  memset(&hits, 0, sizeof(hits));
+  mc_wclose(b_us, y == hist_lines(us->hist) ? 0 : 1);
   mc_wclose(b_st, 1);
   mc_wlocate(us, us->curx, us->cury);
   mc_wflush();
   mc_wredraw(us, 1);
 }
 
+#ifdef SIGUSR1
+/* Log the statistics; the main loop does it. */
+static void want_stats(int sig)
+{
+  (void)sig;
+  stats_wanted = 1;
+  signal(SIGUSR1, want_stats);
+}
+#endif
+
 #ifdef SIGWINCH
 /* The window size has changed. Re-initialize. */
 static void change_size(int sig)
@@ -1061,7 +1205,6 @@ int main(int argc, char **argv)
 
   /* Initialize global variables */
   portfd =  -1;
-  capfp = NULL;
   docap = 0;
   online = -1;
   linespd = 0;
@@ -1119,9 +1262,6 @@ int main(int argc, char **argv)
   }
 
 
-  /* MARK updated 02/17/95 default history buffer size */
-  num_hist_lines = 256;
-
   /* fmg - but we reset these to F=WHITE, B=BLACK if -b flag found */
 
   /* Before processing the options, first add options
@@ -1246,8 +1386,7 @@ int main(int argc, char **argv)
           use_status = 1;
           break;
         case 'C': /* Capturing */
-          capfp = fopen(optarg, "a");
-          if (capfp == NULL) {
+          if (capture_open(optarg) < 0) {
             werror(_("Cannot open capture file"));
             exit(1);
           }
@@ -1322,7 +1461,6 @@ int main(int argc, char **argv)
   snprintf(pparfile, sizeof(pparfile), "%s/.minirc.%s", homedir, use_port);
 
   read_parms();
-  num_hist_lines = atoi(P_HISTSIZE);
   strcpy(logfname,P_LOGFNAME);
 
   /* Set default terminal behaviour */
@@ -1413,6 +1551,9 @@ int main(int argc, char **argv)
 #ifdef SIGWINCH
   signal(SIGWINCH, change_size);
 #endif
+#ifdef SIGUSR1
+  signal(SIGUSR1, want_stats);
+#endif
 
 #ifdef DEBUG
   for(c = 1; c < _NSIG; c++) {
@@ -1563,33 +1704,33 @@ dirty_goto:
         }
         break;
       case 'l': /* Capture file */
-        if (capfp == (FILE *)0 && !docap) {
+        if (!capture_isopen() && !docap) {
           s = input(_("Capture to which file? "), capname);
           if (s == NULL || *s == 0)
             break;
-          if ((capfp = fopen(s, "a")) == (FILE *)NULL) {
+          if (capture_open(s) < 0) {
             werror(_("Cannot open capture file"));
             break;
           }
           docap = 1;
-        } else if (capfp != (FILE *)0 && !docap) {
+        } else if (capture_isopen() && !docap) {
           c = ask(_("Capture file"), c3);
           if (c == 0) {
-            fclose(capfp);
-            capfp = (FILE *)NULL;
+            capture_close();
             docap = 0;
           }
           if (c == 1)
             docap = 1;
-        } else if (capfp != (FILE *)0 && docap) {
+        } else if (capture_isopen() && docap) {
           c = ask(_("Capture file"), c2);
           if (c == 0) {
-            fclose(capfp);
-            capfp = (FILE *)NULL;
+            capture_close();
             docap = 0;
           }
-          if (c == 1)
+          if (c == 1) {
+            capture_flush();
             docap = 0;
+          }
         }
         vt_set(addlf, -1, docap, -1, -1, -1, -1, -1, addcr);
         break;
@@ -1663,6 +1804,9 @@ dirty_goto:
       case 'y': /* Paste file */
 	paste_file();
 	break;
+      case 'v': /* Statistics */
+        stats_window();
+        break;
       case EOF: /* Cannot read from stdin anymore, exit silently */
         quit = NORESET;
         break;
@@ -1687,19 +1831,25 @@ dirty_goto:
 #endif
   signal(SIGQUIT, SIG_DFL);
 
-  if (capfp != (FILE *)0)
-    fclose(capfp);
+  capture_close();
+  /* With the history in a file, keep what is on the screen there, too. */
+  if (P_HISTDIR[0])
+    mc_winclr(us);
   mc_wclose(us, 0);
   mc_wclose(st, 0);
   mc_wclose(stdwin, 1);
   keyboard(KUNINSTALL, 0);
   lockfile_remove();
+  txq_drain();
+  rxring_stop();
+  rxring_drop();
   close(portfd);
 
   if (quit != NORESET && P_CALLIN[0])
     fastsystem(P_CALLIN, NULL, NULL, NULL);
 
   close_iconv();
+  instr_dump(stderr);
 
   return 0;
 }
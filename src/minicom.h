@@ -29,8 +29,11 @@
 #include "config.h"
 #include "configsym.h"
 #include "window.h"
+#include "history.h"
 #include "keyboard.h"
 #include "vt100.h"
+#include "instr.h"
+#include "probes.h"
 #include "libport.h"
 
 #include <time.h>
@@ -80,7 +83,6 @@ EXTERN int keypadmode;	/* Mode of keypad */
 EXTERN int cursormode;	/* Mode of cursor (arrow) keys */
 
 EXTERN int docap;	/* Capture data to capture file */
-EXTERN FILE *capfp;	/* File to capture to */
 EXTERN int addlf;	/* Add LF after CR */
 EXTERN int addcr;	/* Insert CR before LF */
 EXTERN int wrapln;	/* Linewrap default */
@@ -128,7 +130,7 @@ EXTERN struct sockaddr_un portfd_sock_addr;	/* the unix socket address */
  * fmg 8/22/97
  * Search pattern can be THIS long (x characters)
  */
-#define MAX_SEARCH      30
+#define MAX_SEARCH      128
 
 /* fmg 1/11/94 colors */
 
@@ -143,21 +145,26 @@ EXTERN int st_attr;	/* Status Bar attributes. */
 /* jl 04.09.97 conversion tables */
 EXTERN unsigned char vt_outmap[256], vt_inmap[256];
 
-/* MARK updated 02/17/95 - history buffer */
-EXTERN int num_hist_lines;  /* History buffer size */
-
 /* fmg 1/11/94 colors - convert color word to # */
 
 int Jcolor(char *);
 
 EXTERN int size_changed;     /* Window size has changed */
+EXTERN int stats_wanted;     /* SIGUSR1: log the statistics */
 extern const char *Version;  /* Minicom verson */
 
 EXTERN int local_echo;      /* Local echo on/off. */
+EXTERN int vt_nl_delay;     /* Delay after CR key */
+EXTERN int vt_ch_delay;     /* Delay after each character */
 
 /* Forward declaration. */
 struct dialent;
 
+/* Error counters of the serial driver, see m_geterrs(). */
+struct lineerrs {
+  long overrun, frame, parity, brk, buf_overrun;
+};
+
 /* Global functions */
 
 /* Prototypes from file: config.c */
@@ -183,6 +190,27 @@ size_t one_mbtowc (wchar_t *pwc, const char *s, size_t n);
 size_t one_wctomb (char *s, wchar_t wchar);
 size_t mbslen (const char *s);
 
+/* Prototypes from file: backlog.c */
+void backlog_start(int fd);
+void backlog_stop(void);
+int backlog_pending(void);
+int backlog_read(char *buf, int size);
+void backlog_clear(void);
+long backlog_lost(void);
+void backlog_wait(int ms);
+int backlog_key(int ms);
+void backlog_stats(long *size, long *hiwat, long *lost);
+
+/* Prototypes from file: capture.c */
+int  capture_open(const char *name);
+void capture_close(void);
+int  capture_isopen(void);
+void capture_write(const char *s, int len);
+void capture_putc(int c);
+void capture_flush(void);
+void capture_tick(void);
+int  capture_timeout(void);
+
 /* Prototypes from file: dial.c */
 #if VC_MUSIC
 void music(void);
@@ -210,9 +238,69 @@ char *get_port(char *);
 int help(void);
 
 /* Prototypes from file: ipc.c */
+char *io_rxbuf(int *size);
 int check_io(int fd1, int fd2, int tmout, char *buf, int buf_size, int *bytes_red);
 int keyboard(int cmd, int arg);
 
+/* Prototypes from file: rxring.c */
+int rxring_start(int fd);
+void rxring_stop(void);
+void rxring_drop(void);
+int rxring_owns(int fd);
+int rxring_fd(void);
+int rxring_ready(void);
+int rxring_read(char *buf, int size, struct timeval *when);
+void rxring_stats(unsigned long *size, unsigned long *hiwat,
+                  unsigned long *full);
+
+/* Prototypes from file: stats.c */
+void stats_rx(int n);
+void stats_tx(int n);
+void stats_tick(void);
+int  stats_timeout(void);
+void stats_field(char *buf, int size);
+void stats_window(void);
+void stats_dump(void);
+void stats_reset(void);
+void stats_size(char *buf, int size, long long n);
+
+/* Prototypes from file: latency.c */
+int  lat_start(void);
+void lat_stop(void);
+int  lat_running(void);
+void lat_tick(void);
+int  lat_timeout(void);
+void lat_forget(void);
+void lat_rx(const char *buf, int len);
+void lat_field(char *buf, int size);
+void lat_summary(char *buf, int size, int brief);
+void lat_window(void);
+
+/* Prototypes from file: prbs.c */
+void prbs_window(void);
+
+/* Prototypes from file: txqueue.c */
+#define TXQ_KEYS	0	/* Lane for keys typed */
+#define TXQ_BULK	1	/* Lane for pastes, macros, modem strings */
+#define TXQ_CTS		1	/* Output held back by CTS */
+#define TXQ_XOFF	2	/* Probably by XOFF */
+#define TXQ_FULL	3	/* The driver takes nothing */
+void txq_write(const char *s, int len, int pace);
+void txq_pause(int ms);
+void txq_eol(int ms);
+int txq_lane(int lane);
+int txq_pending(void);
+long txq_queued(void);
+long txq_bulk(void);
+long txq_space(void);
+int txq_stalled(void);
+long txq_hiwat(void);
+long txq_cancel(void);
+int txq_timeout(void);
+void txq_run(void);
+void txq_drain(void);
+void txq_clear(void);
+
 /* Prototypes from file: keyserv.c */
 void handler(int dummy);
 void sendstr(char *s);
@@ -223,8 +311,11 @@ void leave(const char *s) __attribute__((noreturn));
 char *esc_key(void);
 void term_socket_connect(void);
 void term_socket_close(void);
+void term_replay(void);
 int  open_term(int doinit, int show_win_on_error, int no_msgs);
 void init_emul(int type, int do_init);
+long hist_memory(void);
+void hist_apply(void);
 void timer_update(void);
 void mode_status(void);
 void time_status(bool);
@@ -239,12 +330,10 @@ void port_init(void);
 void toggle_addlf(void);
 void toggle_local_echo(void);
 
-void drawhist_look(WIN *w, int y, int r, wchar_t *look, int case_matters);
-void searchhist(WIN *w_hist, wchar_t *str);
-int  find_next(WIN *w, WIN *w_hist, int hit_line, wchar_t *look,
-               int case_matters);
-const wchar_t *upcase(wchar_t *dest, wchar_t *src);
-wchar_t *StrStr(wchar_t *str1, wchar_t *str2, int case_matters);
+void drawhist_look(WIN *w, int y, int r, struct hfind *look);
+void searchhist(WIN *w_hist, wchar_t *str, int regex);
+int  find_next(WIN *w, WIN *w_hist, int hit_line, struct hfind *look);
+int  find_prev(WIN *w, WIN *w_hist, int hit_line, struct hfind *look);
 
 void do_iconv(char **inbuf, size_t *inbytesleft,
               char **outbuf, size_t *outbytesleft);
@@ -261,6 +350,7 @@ void m_sethwf(int fd, int on);
 void m_dtrtoggle(int fd, int sec);
 void m_break(int fd);
 int  m_getdcd(int fd);
+int  m_getcts(int fd);
 void m_setdcd(int fd, int what);
 void m_savestate(int fd);
 void m_restorestate(int fd);
@@ -268,6 +358,8 @@ void m_nohang(int fd);
 void m_hupcl(int fd, int on);
 void m_flush(int fd);
 void m_flush_script( int fd);
+int  m_outchk(int fd);
+int  m_geterrs(int fd, struct lineerrs *e);
 unsigned m_getmaxspd(void);
 void m_setparms(int fd, char *baudr, char *par, char *bits,
                 char *stopb, int hwf, int swf);
@@ -284,6 +376,8 @@ int  mc_setenv(const char *, const char *);
 void kermit(void);
 void runscript(int ask, const char *s, const char *l, const char *p);
 int  paste_file(void);
+void paste_more(void);
+void paste_stop(void);
 
 /* Prototypes from file: windiv.c */
 WIN *mc_tell(const char *, ...);
@@ -0,0 +1,318 @@
+/*
+ * prbs.c	Line test: send a pseudo-random bit sequence as fast as
+ *		the port takes it, and check what comes back.
+ *
+ *		With a loopback plug, or a device that echoes what it
+ *		gets, this qualifies a cable or an adapter at the speed
+ *		and framing the port is set up for, without other tools.
+ *		The sequence is PRBS7 (x^7 + x^6 + 1), PRBS15
+ *		(x^15 + x^14 + 1) or PRBS31 (x^31 + x^28 + 1), packed
+ *		into characters of as many data bits as the port has.
+ *		prbsseq.c makes and checks the sequence.
+ *
+ *		Output goes through the bulk lane of txqueue.c, which is
+ *		also where the flow control stalls are seen.
+ *
+ *		The test runs while its window (C-A V, T) is up; the
+ *		data does not go near the screen or the capture file.
+ *
+ *		Entry points:
+ *
+ *		prbs_window()     - show the results, start and stop
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+#include "intl.h"
+#include "prbsseq.h"
+
+#define PRBS_CHUNK	4096		/* Bytes queued at a time */
+#define PRBS_DRAW_MS	500		/* Window update */
+#define PRBS_QUIET_MS	300		/* Silence that ends a test */
+#define PRBS_TAIL_MS	3000		/* Longest wait for that silence */
+#define PRBS_ROWS	7
+#define PRBS_WIDTH	60
+
+static int pr_order = 15;		/* PRBS7, 15 or 31 */
+static int pr_on;			/* Test is running */
+static int pr_width;			/* Data bits per character */
+static struct lfsr pr_tx;
+static struct prbs_rx pr_rx;
+
+static long long pr_start;		/* When the test started, us */
+static long long pr_elapsed;		/* How long it ran, once stopped */
+static long long pr_queued;		/* Bytes given to txq_write() */
+static long long pr_sent;		/* Bytes the driver took */
+static long pr_stalls[TXQ_FULL + 1];	/* By txq_stalled() reason */
+static long long pr_stalled;		/* us that output was stuck */
+static long long pr_stallsince;
+static int pr_why;
+
+static long long prbs_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void prbs_reset(void)
+{
+  long long now = prbs_now();
+
+  pr_start = now;
+  pr_elapsed = 0;
+  pr_queued = pr_on ? txq_bulk() : 0;
+  pr_sent = 0;
+  prbs_rxzero(&pr_rx);
+  memset(pr_stalls, 0, sizeof(pr_stalls));
+  pr_stalled = 0;
+  pr_stallsince = now;
+}
+
+/* Keep the bulk lane filled. */
+static void prbs_fill(void)
+{
+  char buf[PRBS_CHUNK];
+  int i, old;
+
+  while (txq_bulk() < PRBS_CHUNK) {
+    for (i = 0; i < PRBS_CHUNK; i++)
+      buf[i] = lfsr_char(&pr_tx, pr_width);
+    old = txq_lane(TXQ_BULK);
+    txq_write(buf, PRBS_CHUNK, 0);
+    txq_lane(old);
+    pr_queued += PRBS_CHUNK;
+  }
+}
+
+/* Count the times output got stuck, and for how long. */
+static void prbs_stall(long long now)
+{
+  int why = txq_stalled();
+
+  if (why == pr_why)
+    return;
+  if (pr_why)
+    pr_stalled += now - pr_stallsince;
+  if (why) {
+    pr_stalls[why]++;
+    pr_stallsince = now;
+  }
+  pr_why = why;
+}
+
+static void prbs_start(void)
+{
+  pr_width = atoi(P_BITS);
+  if (pr_width < 5 || pr_width > 8)
+    pr_width = 8;
+  lfsr_init(&pr_tx, pr_order);
+  prbs_rxinit(&pr_rx, pr_order, pr_width);
+  pr_why = 0;
+  /* What comes in is ours now, not the backlog's. */
+  backlog_stop();
+  pr_on = 1;
+  prbs_reset();
+}
+
+/*
+ * Stop sending, and wait for what is still on its way back, so that
+ * it is counted here and not shown on the screen.
+ */
+static void prbs_stop(void)
+{
+  long long now, last, quiet, end;
+  char *buf;
+  int size, n, x;
+
+  if (!pr_on)
+    return;
+  pr_sent = pr_queued - txq_bulk();
+  txq_cancel();
+  buf = io_rxbuf(&size);
+  now = last = prbs_now();
+  quiet = now + PRBS_QUIET_MS * 1000LL;
+  end = now + PRBS_TAIL_MS * 1000LL;
+  while (portfd_connected >= 0 && now < quiet && now < end) {
+    x = check_io(portfd_connected, -1, (quiet - now) / 1000 + 1,
+                 buf, size, &n);
+    if ((x & 1) && n <= 0)
+      break;
+    now = prbs_now();
+    if ((x & 1) && n > 0) {
+      prbs_rxcheck(&pr_rx, buf, n);
+      last = now;
+      quiet = now + PRBS_QUIET_MS * 1000LL;
+    }
+  }
+  prbs_stall(last);
+  pr_elapsed = last - pr_start;
+  pr_on = 0;
+  backlog_start(portfd_connected);
+}
+
+/*
+ * Run the test until a key is pressed or the time comes. Returns the
+ * key, or -1.
+ */
+static int prbs_run(long long until)
+{
+  long long now;
+  char *buf;
+  int size, n, x, ms;
+
+  buf = io_rxbuf(&size);
+  while ((now = prbs_now()) < until) {
+    ms = (until - now + 999) / 1000;
+    if (!pr_on) {
+      if (backlog_key(ms))
+        return wxgetch();
+      return -1;
+    }
+    prbs_fill();
+    txq_run();
+    pr_sent = pr_queued - txq_bulk();
+    prbs_stall(now);
+    if ((x = txq_timeout()) >= 0 && x < ms)
+      ms = x;
+    x = check_io(portfd_connected, 0, ms, buf, size, &n);
+    if ((x & 1) && n > 0)
+      prbs_rxcheck(&pr_rx, buf, n);
+    else if (x & 1) {
+      /* The port went away. */
+      prbs_stop();
+      werror(_("Line test stopped: the port is gone"));
+    }
+    if (x & 2)
+      return wxgetch();
+  }
+  return -1;
+}
+
+/* Bytes per second over us microseconds, as text. */
+static void prbs_rate(char *buf, int size, long long bytes, long long us)
+{
+  if (us <= 0)
+    us = 1;
+  stats_size(buf, size, bytes * 1000000 / us);
+}
+
+/* Draw the window contents. */
+static void prbs_draw(WIN *w)
+{
+  char lines[PRBS_ROWS][PRBS_WIDTH], a[16];
+  long long us = pr_on ? prbs_now() - pr_start : pr_elapsed;
+  long secs = us / 1000000, cps;
+  int frame, n = 0, i;
+
+  /* Start, data, parity and stop bits. */
+  frame = 1 + (pr_on ? pr_width : atoi(P_BITS)) +
+          (P_PARITY[0] != 'N') + atoi(P_STOPB);
+  cps = atol(P_BAUDRATE) / frame;
+
+  snprintf(lines[n++], PRBS_WIDTH, _("PRBS%d at %s %s%s%s, %s %ld:%02ld:%02ld"),
+           pr_order, P_BAUDRATE, P_BITS, P_PARITY, P_STOPB,
+           pr_on ? _("running") : _("stopped"),
+           secs / 3600, (secs / 60) % 60, secs % 60);
+  prbs_rate(a, sizeof(a), pr_sent, us);
+  snprintf(lines[n++], PRBS_WIDTH, _("Sent           %lld bytes, %s/s"),
+           pr_sent, a);
+  prbs_rate(a, sizeof(a), pr_rx.rcvd, us);
+  if (cps > 0 && us > 0)
+    snprintf(lines[n++], PRBS_WIDTH, _("Received       %lld bytes, %s/s, %lld%% of the line"),
+             pr_rx.rcvd, a, pr_rx.rcvd * 1000000 / us * 100 / cps);
+  else
+    snprintf(lines[n++], PRBS_WIDTH, _("Received       %lld bytes, %s/s"),
+             pr_rx.rcvd, a);
+  snprintf(lines[n++], PRBS_WIDTH, _("Checked        %lld bytes, %lld while syncing"),
+           pr_rx.checked, pr_rx.rcvd - pr_rx.checked);
+  if (pr_rx.checked > 0)
+    snprintf(lines[n++], PRBS_WIDTH, _("Errors         %lld bytes, %lld bits, BER %.2e"),
+             pr_rx.badbytes, pr_rx.badbits,
+             (double)pr_rx.badbits / (pr_rx.checked * pr_width));
+  else
+    snprintf(lines[n++], PRBS_WIDTH, "%s", _("Errors         none checked yet"));
+  snprintf(lines[n++], PRBS_WIDTH, _("Sync           %s, %ld resyncs"),
+           pr_rx.sync ? _("locked") : pr_rx.rcvd ? _("searching") : _("nothing in"),
+           pr_rx.resyncs);
+  snprintf(lines[n++], PRBS_WIDTH, _("Stalls         CTS %ld, XOFF %ld, full %ld, %.1f s"),
+           pr_stalls[TXQ_CTS], pr_stalls[TXQ_XOFF], pr_stalls[TXQ_FULL],
+           (pr_stalled + (pr_why ? prbs_now() - pr_stallsince : 0)) / 1e6);
+
+  for (i = 0; i < PRBS_ROWS; i++) {
+    mc_wlocate(w, 1, i + 1);
+    mc_wputs(w, lines[i]);
+    mc_wclreol(w);
+  }
+}
+
+/*
+ * Show the results and run the test until a key other than these
+ * is pressed: 'S' starts or stops it, 'P' selects the next sequence,
+ * 'R' starts counting again.
+ */
+void prbs_window(void)
+{
+  WIN *w;
+  int x1, x2, c, first;
+  const char *s;
+
+  if (portfd_connected < 0) {
+    werror(_("Line test: the port is not open"));
+    return;
+  }
+  x1 = COLS / 2 - PRBS_WIDTH / 2;
+  x2 = COLS / 2 + PRBS_WIDTH / 2;
+  w = mc_wopen(x1, 5, x2, 8 + PRBS_ROWS, BDOUBLE, stdattr,
+               mfcolor, mbcolor, 0, 0, 1);
+  mc_wtitle(w, TMID, _("Line test"));
+  mc_wcursor(w, CNONE);
+
+  for (first = 1; ; first = 0) {
+    prbs_draw(w);
+    s = pr_on ? _("S stop, P sequence, R reset, other key: back")
+              : _("S start, P sequence, R reset, other key: back");
+    mc_wlocate(w, (x2 - x1) / 2 - strlen(s) / 2, PRBS_ROWS + 2);
+    mc_wputs(w, s);
+    mc_wclreol(w);
+    if (first)
+      mc_wredraw(w, 1);
+    else
+      mc_wflush();
+
+    if ((c = prbs_run(prbs_now() + PRBS_DRAW_MS * 1000LL)) < 0)
+      continue;
+    if (c == 'r' || c == 'R')
+      prbs_reset();
+    else if (c == 'p' || c == 'P') {
+      pr_order = pr_order == 7 ? 15 : pr_order == 15 ? 31 : 7;
+      if (pr_on) {
+        prbs_stop();
+        prbs_start();
+      }
+    } else if (c == 's' || c == 'S') {
+      if (pr_on)
+        prbs_stop();
+      else
+        prbs_start();
+    } else
+      break;
+  }
+  prbs_stop();
+  mc_wclose(w, 1);
+}
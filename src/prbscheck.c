@@ -0,0 +1,200 @@
+/*
+ * prbscheck.c	Check the line test's sequences over a pseudo terminal.
+ *
+ *		For PRBS7, PRBS15 and PRBS31, in characters of 8 and of
+ *		7 bits, the sequence from prbsseq.c is written to the
+ *		master side of a raw pty and checked as it comes out of
+ *		the slave side, as the line test does with a loopback
+ *		plug. Each is run three times: clean, with one bit
+ *		flipped, and with one character left out. Then
+ *
+ *		- clean, there must be no errors and no resync,
+ *		- one bit flipped, one byte and one bit must be wrong,
+ *		  the BER must be 1 in all bits checked, and no resync,
+ *		- one character left out, there must be one resync,
+ *		  after no more than two blocks of errors, and the
+ *		  receiver must be in sync at the end.
+ *
+ *		Usage: prbscheck [-s KB]
+ *
+ *		-s is how much each run sends, 256 KB by default. It
+ *		prints a line per run, and exits 1 if any went wrong.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/time.h>
+
+#include "prbsseq.h"
+
+#define CHUNK		4096		/* Bytes written at a time */
+#define TIMEOUT_MS	10000		/* Longest a run may take */
+
+#define CLEAN		0
+#define FLIP		1		/* One bit of one character */
+#define DROP		2		/* One character left out */
+
+static const char *faults[] = { "clean", "bit flip", "dropped" };
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*
+ * Open a raw pseudo terminal, return the master. The slave, where
+ * the data comes out, goes in *slave.
+ */
+static int open_pty(int *slave)
+{
+  struct termios tty;
+  int fd;
+
+  if ((fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 ||
+      grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    perror("posix_openpt");
+    exit(1);
+  }
+  if ((*slave = open(ptsname(fd), O_RDWR | O_NOCTTY)) < 0) {
+    perror(ptsname(fd));
+    exit(1);
+  }
+  tcgetattr(*slave, &tty);
+  cfmakeraw(&tty);
+  tcsetattr(*slave, TCSANOW, &tty);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  fcntl(*slave, F_SETFL, fcntl(*slave, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+/*
+ * Send len characters of the sequence through a pty with the fault
+ * in the middle, and check them. Returns 1 if the result is wrong.
+ */
+static int run(int order, int width, int fault, long len)
+{
+  struct lfsr tx;
+  struct prbs_rx rx;
+  struct pollfd pfd[2];
+  char out[CHUNK], in[CHUNK];
+  long made = 0, want = len - (fault == DROP);
+  int master, slave, n, olen = 0, opos = 0, bad = 0, sync;
+  int first = (order + width - 1) / width;
+  double t0, t1, ber = 0;
+
+  master = open_pty(&slave);
+  lfsr_init(&tx, order);
+  prbs_rxinit(&rx, order, width);
+
+  t0 = now();
+  while (rx.rcvd < want) {
+    if (opos == olen && made < len) {
+      for (olen = opos = 0; olen < CHUNK && made < len; made++) {
+        out[olen] = lfsr_char(&tx, width);
+        if (made == len / 2 && fault == DROP)
+          continue;
+        if (made == len / 2 && fault == FLIP)
+          out[olen] ^= 0x04;
+        olen++;
+      }
+    }
+    pfd[0].fd = master;
+    pfd[0].events = opos < olen ? POLLOUT : 0;
+    pfd[1].fd = slave;
+    pfd[1].events = POLLIN;
+    if (poll(pfd, 2, 1000) <= 0 || now() - t0 > TIMEOUT_MS / 1000.0) {
+      printf("PRBS%-2d %d bits %-8s: timed out, %lld of %ld bytes in\n",
+             order, width, faults[fault], rx.rcvd, want);
+      close(master);
+      close(slave);
+      return 1;
+    }
+    if ((pfd[0].revents & POLLOUT) &&
+        (n = write(master, out + opos, olen - opos)) > 0)
+      opos += n;
+    if ((pfd[1].revents & POLLIN) && (n = read(slave, in, sizeof(in))) > 0)
+      prbs_rxcheck(&rx, in, n);
+  }
+  t1 = now();
+  sync = rx.sync;
+  close(master);
+  close(slave);
+
+  if (rx.checked > 0)
+    ber = (double)rx.badbits / (rx.checked * width);
+  printf("PRBS%-2d %d bits %-8s: %lld checked, %lld bytes %lld bits wrong, "
+         "BER %.2e, %ld resyncs, %.1f MB/s", order, width, faults[fault],
+         rx.checked, rx.badbytes, rx.badbits, ber, rx.resyncs,
+         rx.rcvd / (1024.0 * 1024.0) / (t1 - t0 > 0 ? t1 - t0 : 1e-6));
+
+  switch (fault) {
+    case CLEAN:
+      bad = rx.badbytes != 0 || rx.badbits != 0 || rx.resyncs != 0 ||
+            rx.checked != rx.rcvd - first;
+      break;
+    case FLIP:
+      bad = rx.badbytes != 1 || rx.badbits != 1 || rx.resyncs != 0 ||
+            ber != 1.0 / (rx.checked * width);
+      break;
+    case DROP:
+      bad = rx.resyncs != 1 || rx.badbytes == 0 ||
+            rx.badbytes > 2 * PRBS_BLOCK;
+      break;
+  }
+  bad |= !sync;
+  printf(": %s\n", bad ? "WRONG" : "ok");
+  return bad;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-s KB]\n", prog);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  static const int orders[] = { 7, 15, 31 };
+  long len = 256L * 1024;
+  int c, i, width, fault, bad = 0;
+
+  while ((c = getopt(argc, argv, "s:")) != EOF) {
+    switch (c) {
+      case 's':
+        len = (long)(atof(optarg) * 1024);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (optind < argc || len < 4 * PRBS_BLOCK)
+    usage(argv[0]);
+
+  for (i = 0; i < 3; i++)
+    for (width = 8; width >= 7; width--)
+      for (fault = CLEAN; fault <= DROP; fault++)
+        bad += run(orders[i], width, fault, len);
+  return bad != 0;
+}
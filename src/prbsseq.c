@@ -0,0 +1,118 @@
+/*
+ * prbsseq.c	Pseudo-random bit sequences for the line test.
+ *
+ *		PRBS7 (x^7 + x^6 + 1), PRBS15 (x^15 + x^14 + 1) and
+ *		PRBS31 (x^31 + x^28 + 1), packed into characters of 5 to
+ *		8 data bits, first bit in the highest.
+ *
+ *		The receiver loads its own register from the first bits
+ *		that come in, then predicts every character after that.
+ *		A character that differs is an error, and its wrong bits
+ *		count for the bit error rate. When more than PRBS_BADMAX
+ *		of PRBS_BLOCK characters are wrong, a character was most
+ *		likely lost or doubled, and the receiver syncs again.
+ *
+ *		This module does not know about the port, so it can be
+ *		used and tested on its own.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "prbsseq.h"
+
+void lfsr_init(struct lfsr *l, int order)
+{
+  l->n = order;
+  l->tap = order == 7 ? 6 : order == 15 ? 14 : 28;
+  l->mask = (1UL << order) - 1;
+  l->s = l->mask;
+}
+
+/* The next character of the sequence, first bit in the highest. */
+int lfsr_char(struct lfsr *l, int width)
+{
+  unsigned long b;
+  int c = 0, i;
+
+  for (i = 0; i < width; i++) {
+    b = ((l->s >> (l->n - 1)) ^ (l->s >> (l->tap - 1))) & 1;
+    l->s = ((l->s << 1) | b) & l->mask;
+    c = (c << 1) | b;
+  }
+  return c;
+}
+
+/*
+ * Start looking for a sequence of this order in characters of
+ * width bits.
+ */
+void prbs_rxinit(struct prbs_rx *r, int order, int width)
+{
+  lfsr_init(&r->l, order);
+  r->width = width;
+  r->fill = r->sync = r->synced = 0;
+  r->blk = r->blkbad = 0;
+  prbs_rxzero(r);
+}
+
+/*
+ * Start counting again, but stay in sync.
+ */
+void prbs_rxzero(struct prbs_rx *r)
+{
+  r->rcvd = r->checked = 0;
+  r->badbytes = r->badbits = 0;
+  r->resyncs = 0;
+}
+
+/*
+ * Check what came in against the sequence.
+ */
+void prbs_rxcheck(struct prbs_rx *r, const char *buf, int len)
+{
+  int i, b, c, x, cmask = (1 << r->width) - 1;
+
+  for (i = 0; i < len; i++) {
+    c = buf[i] & cmask;
+    r->rcvd++;
+    if (!r->sync) {
+      for (b = r->width - 1; b >= 0; b--)
+        r->l.s = ((r->l.s << 1) | ((c >> b) & 1)) & r->l.mask;
+      r->fill += r->width;
+      /* All zeros is not part of the sequence. */
+      if (r->fill >= r->l.n && r->l.s != 0) {
+        if (r->synced)
+          r->resyncs++;
+        r->sync = r->synced = 1;
+        r->blk = r->blkbad = 0;
+      }
+      continue;
+    }
+    r->checked++;
+    if ((x = lfsr_char(&r->l, r->width) ^ c) != 0) {
+      r->badbytes++;
+      r->blkbad++;
+      for (; x; x &= x - 1)
+        r->badbits++;
+    }
+    if (++r->blk == PRBS_BLOCK) {
+      if (r->blkbad > PRBS_BADMAX) {
+        r->sync = 0;
+        r->fill = 0;
+      }
+      r->blk = r->blkbad = 0;
+    }
+  }
+}
@@ -0,0 +1,47 @@
+/*
+ * prbsseq.h	Pseudo-random bit sequences for the line test.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef __MINICOM__SRC__PRBSSEQ_H__
+#define __MINICOM__SRC__PRBSSEQ_H__
+
+#define PRBS_BLOCK	32		/* Characters judged together */
+#define PRBS_BADMAX	8		/* Wrong ones in a block lose sync */
+
+struct lfsr {
+  unsigned long s;			/* The last n bits, newest at bit 0 */
+  unsigned long mask;
+  int n, tap;
+};
+
+/* The receiving end: where it is in the sequence, and what it saw. */
+struct prbs_rx {
+  struct lfsr l;
+  int width;				/* Data bits per character */
+  int fill;				/* Bits loaded into l */
+  int sync;				/* l predicts what comes in */
+  int synced;				/* It did so before */
+  int blk, blkbad;			/* Position and errors in a block */
+  long long rcvd;			/* Bytes that came in */
+  long long checked;			/* ... and were predicted */
+  long long badbytes, badbits;
+  long resyncs;
+};
+
+void lfsr_init(struct lfsr *l, int order);
+int lfsr_char(struct lfsr *l, int width);
+void prbs_rxinit(struct prbs_rx *r, int order, int width);
+void prbs_rxzero(struct prbs_rx *r);
+void prbs_rxcheck(struct prbs_rx *r, const char *buf, int len);
+
+#endif /* ! __MINICOM__SRC__PRBSSEQ_H__ */
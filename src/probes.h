@@ -0,0 +1,55 @@
+/*
+ * probes.h	Static tracepoints (USDT) for tracing minicom while it
+ *		runs, e.g. with bpftrace:
+ *
+ *		bpftrace -e 'usdt:./minicom:minicom:serial_read
+ *		             { @bytes = hist(arg1); }'
+ *
+ *		Where <sys/sdt.h> is missing (systemtap-sdt-dev on
+ *		Debian), the probes are left out. A probe that is not
+ *		traced costs a single nop.
+ *
+ *		Probes and their arguments:
+ *
+ *		serial_read(fd, bytes)    - read from the port done
+ *		serial_write(fd, bytes)   - write to the port done
+ *		escape(kind, final, inter)
+ *		                          - ESC, CSI ('[') or DCS ('P')
+ *		                            sequence, before it is acted on
+ *		screen_flush(bytes)       - output written to the terminal
+ *		capture_flush(bytes)      - capture buffer written to disk
+ *		zmodem_trigger()          - zmodem signature seen
+ *		updown_start(pid, what)   - transfer program started,
+ *		                            what is 'U' or 'D'
+ *		updown_exit(pid, status)  - transfer program finished
+ *		device_reopen(fd)         - port opened again after it went
+ *		                            away, fd -1 if that failed
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef __MINICOM__SRC__PROBES_H__
+#define __MINICOM__SRC__PROBES_H__
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define PROBE(name)		DTRACE_PROBE(minicom, name)
+#define PROBE1(name, a)		DTRACE_PROBE1(minicom, name, a)
+#define PROBE2(name, a, b)	DTRACE_PROBE2(minicom, name, a, b)
+#define PROBE3(name, a, b, c)	DTRACE_PROBE3(minicom, name, a, b, c)
+#else
+#define PROBE(name)		do { } while (0)
+#define PROBE1(name, a)		do { } while (0)
+#define PROBE2(name, a, b)	do { } while (0)
+#define PROBE3(name, a, b, c)	do { } while (0)
+#endif
+
+#endif /* ! __MINICOM__SRC__PROBES_H__ */
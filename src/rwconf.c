@@ -167,7 +167,8 @@ struct pars mpars[] = {
 
   /* Continue here with new stuff. */
   { "Yes",		0,   "sound"  },
-  /* MARK updated 02/17/95 - History buffer size */
+  /* MARK updated 02/17/95 - History buffer size. Now "histmem",
+   * still read so that old files load. */
   { "2000",             0,   "histlines" },
 
   /* Character conversion table - jl / 04.09.97 */
@@ -198,6 +199,45 @@ struct pars mpars[] = {
 
   { "Minicom"VERSION,   0,    "answerback" },
 
+  /* Bytes read from the port in one go */
+  { "16384",		0,    "rxbufsize" },
+
+  /* Capture file buffer, and how long data may stay in it (ms) */
+  { "65536",		0,    "capbufsize" },
+  { "50",		0,    "capflushms" },
+
+  /* Screen updates per second while receiving */
+  { "30",		0,    "fps" },
+
+  /* Read the port in a thread, into a ring of this many MiB */
+  { "No",		0,    "rxthread" },
+  { "4",		0,    "rxringsize" },
+
+  /* What may come in while a menu is up */
+  { "1048576",		0,    "backlogsize" },
+
+  /* Only wake up when something is due */
+  { "No",		0,    "tickless" },
+
+  /* What to do when more than txqmax bytes wait to be sent:
+   * wait, drop or abort */
+  { "wait",		0,    "txpolicy" },
+  { "1048576",		0,    "txqmax" },
+
+  /* Show the receive rate and line errors in the status line */
+  { "Yes",		0,    "showstats" },
+
+  /* Latency test: probes per second, and what is sent */
+  { "10",		0,    "latrate" },
+  { "~",		0,    "latpayload" },
+
+  /* MiB the (packed) history buffer may use */
+  { "4",		0,    "histmem" },
+
+  /* Directory to keep the history in, per port, and its size in MiB */
+  { "",			0,    "histdir" },
+  { "1024",		0,    "histdisk" },
+
   /* That's all folks */
   { "",                 0,         NULL },
 };
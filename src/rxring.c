@@ -0,0 +1,395 @@
+/*
+ * rxring.c	Read the serial port in a thread of its own.
+ *
+ *		With "rxthread" set, a thread does nothing but read the
+ *		port into a ring buffer of "rxringsize" MiB, so that no
+ *		data is lost while the main loop waits for the terminal,
+ *		paces output or shows a menu. check_io() hands out the
+ *		data from the ring as if it came from the port.
+ *
+ *		There is one writer (the thread) and one reader (the
+ *		main loop), so the ring needs no locks: each side only
+ *		moves its own index. Every read() is kept as a chunk
+ *		with the time it came in.
+ *
+ *		Entry points:
+ *
+ *		rxring_start(fd)     - start reading fd, if configured
+ *		rxring_stop()        - stop the thread, keep unread data
+ *		rxring_drop()        - forget unread data, and log it
+ *		rxring_owns(fd)      - is fd read through the ring?
+ *		rxring_fd()          - readable when data has come in
+ *		rxring_ready()       - is there data (or EOF) to read?
+ *		rxring_read(buf, size, when)
+ *		                     - take data out of the ring
+ *		rxring_stats(...)    - how full the ring got
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "port.h"
+#include "minicom.h"
+#include "intl.h"
+
+/* Limits for the "rxringsize" parameter, in MiB. */
+#define RXRING_MIN	1
+#define RXRING_MAX	256
+
+/* One chunk for every this many bytes of ring. */
+#define RXRING_CHUNK	128
+
+struct chunk {
+  unsigned long end;		/* Ring position after the last byte */
+  struct timeval when;		/* When it was read */
+};
+
+static pthread_t rx_thread;
+static int rx_running;
+static int rx_fd = -1;
+static int rx_note[2] = { -1, -1 };	/* Thread -> main loop: data */
+static int rx_ctl[2] = { -1, -1 };	/* Main loop -> thread: stop */
+
+static char *rx_data;
+static unsigned long rx_mask;		/* Ring size - 1 */
+static struct chunk *rx_chunks;
+static unsigned long rx_cmask;		/* Number of chunks - 1 */
+
+/* Positions only ever go up; the index into the ring is pos & mask. */
+static atomic_ulong rx_head, rx_tail;
+static atomic_ulong rx_chead, rx_ctail;
+static atomic_int rx_eof;		/* The thread gave up on the port */
+
+/* High-water marks, kept by the thread. */
+static atomic_ulong rx_hiwat;
+static atomic_ulong rx_chiwat;
+static atomic_ulong rx_fullwaits;
+
+/*
+ * The reader thread.
+ */
+static void *rx_reader(void *arg)
+{
+  struct pollfd fds[2];
+  struct chunk *ch;
+  unsigned long head, tail, chead, room, n;
+  ssize_t r;
+  char c = 0;
+
+  (void)arg;
+  fds[0].fd = rx_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = rx_ctl[0];
+  fds[1].events = POLLIN;
+
+  while (1) {
+    head = atomic_load(&rx_head);
+    tail = atomic_load(&rx_tail);
+    chead = atomic_load(&rx_chead);
+    room = rx_mask + 1 - (head - tail);
+
+    if (room == 0 || chead - atomic_load(&rx_ctail) > rx_cmask) {
+      /* Full. Leave the data to the driver for a moment. */
+      atomic_fetch_add(&rx_fullwaits, 1);
+      if (poll(&fds[1], 1, 5) > 0)
+        break;
+      continue;
+    }
+
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      atomic_store(&rx_eof, 1);
+      write(rx_note[1], &c, 1);
+      break;
+    }
+    if (fds[1].revents)
+      break;
+    if (fds[0].revents == 0)
+      continue;
+
+    /* Read up to the end of the ring; the rest comes next time. */
+    n = rx_mask + 1 - (head & rx_mask);
+    if (n > room)
+      n = room;
+    r = read(rx_fd, rx_data + (head & rx_mask), n);
+    PROBE2(serial_read, rx_fd, r);
+    if (r < 0 && (errno == EINTR || errno == EAGAIN))
+      continue;
+    if (r <= 0) {
+      atomic_store(&rx_eof, 1);
+      write(rx_note[1], &c, 1);
+      break;
+    }
+
+    ch = &rx_chunks[chead & rx_cmask];
+    ch->end = head + r;
+    gettimeofday(&ch->when, NULL);
+    atomic_store(&rx_chead, chead + 1);
+    atomic_store(&rx_head, head + r);
+
+    if (head + r - tail > atomic_load(&rx_hiwat))
+      atomic_store(&rx_hiwat, head + r - tail);
+    n = chead + 1 - atomic_load(&rx_ctail);
+    if (n > atomic_load(&rx_chiwat))
+      atomic_store(&rx_chiwat, n);
+
+    /* If the main loop had read everything, it may be asleep. */
+    if (atomic_load(&rx_tail) == head)
+      write(rx_note[1], &c, 1);
+  }
+  return NULL;
+}
+
+/* Round up to a power of two. */
+static unsigned long pow2(unsigned long n)
+{
+  unsigned long p = 1;
+
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+static void rx_closepipes(void)
+{
+  if (rx_note[0] >= 0) {
+    close(rx_note[0]);
+    close(rx_note[1]);
+  }
+  if (rx_ctl[0] >= 0) {
+    close(rx_ctl[0]);
+    close(rx_ctl[1]);
+  }
+  rx_note[0] = rx_note[1] = -1;
+  rx_ctl[0] = rx_ctl[1] = -1;
+}
+
+static int rx_pipe(int *fds)
+{
+  int i;
+
+  if (pipe(fds) < 0)
+    return -1;
+  for (i = 0; i < 2; i++) {
+    fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  return 0;
+}
+
+/*
+ * Start the reader thread for fd, if the configuration asks for it.
+ * Returns 0 if fd is read through the ring.
+ */
+int rxring_start(int fd)
+{
+  unsigned long size, chunks;
+  sigset_t all, old;
+  int mb;
+
+  if (rx_running) {
+    if (fd == rx_fd)
+      return 0;
+    rxring_stop();
+  }
+  if (fd < 0 || P_RXTHREAD[0] != 'Y')
+    return -1;
+  rxring_drop();
+
+  mb = atoi(P_RXRINGSIZE);
+  if (mb < RXRING_MIN)
+    mb = RXRING_MIN;
+  if (mb > RXRING_MAX)
+    mb = RXRING_MAX;
+  size = pow2((unsigned long)mb << 20);
+  chunks = size / RXRING_CHUNK;
+
+  if (rx_data == NULL || size != rx_mask + 1) {
+    free(rx_data);
+    free(rx_chunks);
+    rx_data = malloc(size);
+    rx_chunks = malloc(chunks * sizeof(struct chunk));
+    if (rx_data == NULL || rx_chunks == NULL) {
+      free(rx_data);
+      free(rx_chunks);
+      rx_data = NULL;
+      rx_chunks = NULL;
+      return -1;
+    }
+    rx_mask = size - 1;
+    rx_cmask = chunks - 1;
+  }
+
+  if (rx_pipe(rx_note) < 0 || rx_pipe(rx_ctl) < 0) {
+    rx_closepipes();
+    return -1;
+  }
+
+  atomic_store(&rx_head, 0);
+  atomic_store(&rx_tail, 0);
+  atomic_store(&rx_chead, 0);
+  atomic_store(&rx_ctail, 0);
+  atomic_store(&rx_eof, 0);
+  atomic_store(&rx_hiwat, 0);
+  atomic_store(&rx_chiwat, 0);
+  atomic_store(&rx_fullwaits, 0);
+  rx_fd = fd;
+
+  /* Signals are for the main loop, not for the reader. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  if (pthread_create(&rx_thread, NULL, rx_reader, NULL) != 0) {
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    rx_closepipes();
+    rx_fd = -1;
+    return -1;
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  rx_running = 1;
+  return 0;
+}
+
+/*
+ * Stop the reader thread, before the port is closed or handed to
+ * another program. Data that has not been read yet can still be
+ * taken with rxring_read(), until the ring is started again.
+ */
+void rxring_stop(void)
+{
+  char c = 0;
+
+  if (!rx_running)
+    return;
+  write(rx_ctl[1], &c, 1);
+  pthread_join(rx_thread, NULL);
+  rx_closepipes();
+  rx_running = 0;
+  rx_fd = -1;
+
+  if (atomic_load(&rx_hiwat) > 0)
+    do_log(_("Receive ring high water: %lu of %lu bytes, %lu of %lu chunks, full %lu times"),
+           atomic_load(&rx_hiwat), rx_mask + 1, atomic_load(&rx_chiwat),
+           rx_cmask + 1, atomic_load(&rx_fullwaits));
+}
+
+/*
+ * Forget what the stopped ring still has; it is logged as lost.
+ */
+void rxring_drop(void)
+{
+  unsigned long n;
+
+  if (rx_running || rx_data == NULL)
+    return;
+  n = atomic_load(&rx_head) - atomic_load(&rx_tail);
+  if (n > 0)
+    do_log(_("Receive ring: %lu bytes not shown, dropped"), n);
+  atomic_store(&rx_tail, atomic_load(&rx_head));
+  atomic_store(&rx_ctail, atomic_load(&rx_chead));
+}
+
+/*
+ * Is fd read through the ring? Once the thread has met an EOF or
+ * error and the ring is empty, the port is read directly again, so
+ * that check_io() sees what the port does now.
+ */
+int rxring_owns(int fd)
+{
+  if (!rx_running || fd != rx_fd)
+    return 0;
+  return !atomic_load(&rx_eof) ||
+         atomic_load(&rx_head) != atomic_load(&rx_tail);
+}
+
+/*
+ * The descriptor to wait on instead of the port.
+ */
+int rxring_fd(void)
+{
+  return rx_note[0];
+}
+
+/*
+ * Is there anything to read? An EOF from the port counts too.
+ */
+int rxring_ready(void)
+{
+  char buf[64];
+
+  /* Take the wakeups first, so that none gets lost after the check. */
+  while (read(rx_note[0], buf, sizeof(buf)) > 0)
+    ;
+  return atomic_load(&rx_eof) ||
+         atomic_load(&rx_head) != atomic_load(&rx_tail);
+}
+
+/*
+ * Take up to size bytes out of the ring. If when is given, it is set
+ * to the time the first of them was read from the port. Returns 0 at
+ * EOF, and -1 with errno set to EAGAIN if there is nothing to read.
+ */
+int rxring_read(char *buf, int size, struct timeval *when)
+{
+  unsigned long head, tail, ctail, chead, n, off, first;
+  int eof;
+
+  eof = atomic_load(&rx_eof);
+  head = atomic_load(&rx_head);
+  tail = atomic_load(&rx_tail);
+  if (head == tail) {
+    if (eof)
+      return 0;
+    errno = EAGAIN;
+    return -1;
+  }
+
+  n = head - tail;
+  if (n > (unsigned long)size)
+    n = size;
+  off = tail & rx_mask;
+  first = rx_mask + 1 - off;
+  if (first > n)
+    first = n;
+  memcpy(buf, rx_data + off, first);
+  memcpy(buf + first, rx_data, n - first);
+  tail += n;
+
+  /* The oldest chunk holds the first byte. Retire the ones read. */
+  ctail = atomic_load(&rx_ctail);
+  chead = atomic_load(&rx_chead);
+  if (when)
+    *when = rx_chunks[ctail & rx_cmask].when;
+  while (ctail != chead && rx_chunks[ctail & rx_cmask].end <= tail)
+    ctail++;
+  atomic_store(&rx_ctail, ctail);
+  atomic_store(&rx_tail, tail);
+  return n;
+}
+
+/*
+ * How full the ring got since the thread was last started, and how
+ * often the thread found it full. The size is 0 if it never ran.
+ */
+void rxring_stats(unsigned long *size, unsigned long *hiwat,
+                  unsigned long *full)
+{
+  *size = rx_data ? rx_mask + 1 : 0;
+  *hiwat = atomic_load(&rx_hiwat);
+  *full = atomic_load(&rx_fullwaits);
+}
@@ -0,0 +1,361 @@
+/*
+ * stats.c	Count what goes over the line.
+ *
+ *		Bytes received and sent, bytes per second now and at
+ *		best, the error counters of the serial driver, how full
+ *		the buffers got and how big the history is. With
+ *		"showstats" set, the rate and the number of line errors
+ *		are shown in the status line while data moves. Everything is shown in a window
+ *		with C-A V, and written to the log file on SIGUSR1,
+ *		together with the table from instr.c if there is one.
+ *
+ *		Entry points:
+ *
+ *		stats_rx(n)       - n bytes came in from the port
+ *		stats_tx(n)       - n bytes went out to the port
+ *		stats_tick()      - called from the main loop
+ *		stats_timeout()   - ms until the status line needs an update
+ *		stats_field(buf, size)
+ *		                  - short text for the status line
+ *		stats_window()    - show everything until a key is pressed
+ *		stats_dump()      - write everything to the log file
+ *		stats_reset()     - start counting again
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+#include "intl.h"
+
+/* Lines of text in the window and the log. */
+#define STATS_LINES	10
+#define STATS_WIDTH	64
+
+struct rate {
+  long long total;		/* Bytes in all */
+  long cur;			/* Bytes in the current second */
+  long last;			/* Bytes in the second before */
+  long peak;			/* Best second */
+  time_t sec;			/* The current second */
+};
+
+static struct rate st_rx, st_tx;
+static time_t st_start;			/* When counting started */
+static struct lineerrs st_base;		/* Driver counters at the start */
+static struct lineerrs st_errs;		/* Since the start */
+static int st_errfd = -1;		/* Port st_base belongs to */
+static int st_haserrs;			/* The driver counts errors */
+static time_t st_errsec;		/* When we last asked */
+
+/* Start a new second, if it is one. */
+static void rate_roll(struct rate *r, time_t now)
+{
+  if (now == r->sec)
+    return;
+  r->last = now == r->sec + 1 ? r->cur : 0;
+  if (r->last > r->peak)
+    r->peak = r->last;
+  r->cur = 0;
+  r->sec = now;
+}
+
+static void rate_add(struct rate *r, int n)
+{
+  time_t now;
+
+  time(&now);
+  if (st_start == 0)
+    st_start = now;
+  rate_roll(r, now);
+  r->cur += n;
+  r->total += n;
+}
+
+void stats_rx(int n)
+{
+  rate_add(&st_rx, n);
+}
+
+void stats_tx(int n)
+{
+  rate_add(&st_tx, n);
+}
+
+/* Ask the driver for its error counters, at most once a second. */
+static void stats_errors(time_t now)
+{
+  struct lineerrs e;
+
+  if (portfd < 0 || now == st_errsec)
+    return;
+  st_errsec = now;
+  if (m_geterrs(portfd, &e) < 0) {
+    st_haserrs = 0;
+    return;
+  }
+  if (portfd != st_errfd || !st_haserrs) {
+    st_base = e;
+    st_errfd = portfd;
+  }
+  st_haserrs = 1;
+  st_errs.overrun = e.overrun - st_base.overrun;
+  st_errs.frame = e.frame - st_base.frame;
+  st_errs.parity = e.parity - st_base.parity;
+  st_errs.brk = e.brk - st_base.brk;
+  st_errs.buf_overrun = e.buf_overrun - st_base.buf_overrun;
+}
+
+/* Bytes lost or garbled on the line, as far as the driver knows. */
+static long stats_errcount(void)
+{
+  if (!st_haserrs)
+    return 0;
+  return st_errs.overrun + st_errs.frame + st_errs.parity +
+         st_errs.buf_overrun;
+}
+
+/*
+ * Called from the main loop.
+ */
+void stats_tick(void)
+{
+  time_t now;
+
+  time(&now);
+  rate_roll(&st_rx, now);
+  rate_roll(&st_tx, now);
+  if (P_SHOWSTATS[0] == 'Y')
+    stats_errors(now);
+}
+
+/*
+ * Milliseconds until the rate in the status line changes, -1 if
+ * nothing moves.
+ */
+int stats_timeout(void)
+{
+  struct timeval now;
+
+  if (P_SHOWSTATS[0] != 'Y' ||
+      (st_rx.cur == 0 && st_rx.last == 0 &&
+       st_tx.cur == 0 && st_tx.last == 0))
+    return -1;
+  gettimeofday(&now, NULL);
+  return 1000 - now.tv_usec / 1000;
+}
+
+/* Print a byte count in a few characters. */
+void stats_size(char *buf, int size, long long n)
+{
+  if (n < 1000)
+    snprintf(buf, size, "%lld", n);
+  else if (n < 10 * 1024)
+    snprintf(buf, size, "%.1fK", n / 1024.0);
+  else if (n < 1000 * 1024)
+    snprintf(buf, size, "%lldK", n / 1024);
+  else if (n < 10 * 1024 * 1024)
+    snprintf(buf, size, "%.1fM", n / (1024.0 * 1024));
+  else
+    snprintf(buf, size, "%lldM", n / (1024 * 1024));
+}
+
+/*
+ * The short text for the status line: the receive (or, if nothing
+ * comes in, the send) rate and the number of line errors. Empty if
+ * there is nothing to show.
+ */
+void stats_field(char *buf, int size)
+{
+  char rate[16], errs[24];
+  long err = stats_errcount();
+
+  buf[0] = 0;
+  if (P_SHOWSTATS[0] != 'Y')
+    return;
+  errs[0] = 0;
+  if (err > 0)
+    snprintf(errs, sizeof(errs), " E%ld", err);
+  if (st_rx.last > 0 || st_tx.last == 0) {
+    stats_size(rate, sizeof(rate), st_rx.last);
+    if (st_rx.last > 0)
+      snprintf(buf, size, "RX %s/s%s", rate, errs);
+    else if (err > 0)
+      snprintf(buf, size, "Errors %ld", err);
+  } else {
+    stats_size(rate, sizeof(rate), st_tx.last);
+    snprintf(buf, size, "TX %s/s%s", rate, errs);
+  }
+}
+
+/* Put everything in lines of text. Returns the number of lines. */
+static int stats_text(char lines[STATS_LINES][STATS_WIDTH])
+{
+  char now[16], peak[16], a[16], b[16], lat[STATS_WIDTH];
+  unsigned long rsize, rhiwat, rfull;
+  long bsize, bhiwat, blost, hused;
+  long long hraw, hdisk;
+  time_t t;
+  long secs;
+  int n = 0;
+
+  time(&t);
+  stats_tick();
+  stats_errors(t);
+  secs = st_start ? t - st_start : 0;
+
+  snprintf(lines[n++], STATS_WIDTH, _("Counting for   %ld:%02ld:%02ld"),
+           secs / 3600, (secs / 60) % 60, secs % 60);
+
+  stats_size(now, sizeof(now), st_rx.last);
+  stats_size(peak, sizeof(peak), st_rx.peak);
+  snprintf(lines[n++], STATS_WIDTH, _("Received       %lld bytes, %s/s, peak %s/s"),
+           st_rx.total, now, peak);
+
+  stats_size(now, sizeof(now), st_tx.last);
+  stats_size(peak, sizeof(peak), st_tx.peak);
+  snprintf(lines[n++], STATS_WIDTH, _("Sent           %lld bytes, %s/s, peak %s/s"),
+           st_tx.total, now, peak);
+
+  if (st_haserrs) {
+    snprintf(lines[n++], STATS_WIDTH, _("Overruns       %ld (driver buffer %ld)"),
+             st_errs.overrun, st_errs.buf_overrun);
+    snprintf(lines[n++], STATS_WIDTH, _("Framing        %ld, parity %ld, breaks %ld"),
+             st_errs.frame, st_errs.parity, st_errs.brk);
+  } else
+    snprintf(lines[n++], STATS_WIDTH, "%s", _("Line errors    not counted by the driver"));
+
+  rxring_stats(&rsize, &rhiwat, &rfull);
+  if (rsize > 0) {
+    stats_size(a, sizeof(a), rhiwat);
+    stats_size(b, sizeof(b), rsize);
+    snprintf(lines[n++], STATS_WIDTH, _("Receive ring   at most %s of %s, full %lu times"),
+             a, b, rfull);
+  }
+
+  backlog_stats(&bsize, &bhiwat, &blost);
+  if (bsize > 0) {
+    stats_size(a, sizeof(a), bhiwat);
+    stats_size(b, sizeof(b), bsize);
+    snprintf(lines[n++], STATS_WIDTH, _("Backlog        at most %s of %s, %ld bytes lost"),
+             a, b, blost);
+  }
+
+  stats_size(a, sizeof(a), txq_queued());
+  stats_size(b, sizeof(b), txq_hiwat());
+  snprintf(lines[n++], STATS_WIDTH, _("Output queue   %s now, at most %s"), a, b);
+
+  if (us && us->hist) {
+    hist_stats(us->hist, &hused, &hdisk, &hraw);
+    stats_size(a, sizeof(a), hdisk ? hdisk : hused);
+    stats_size(b, sizeof(b), hraw);
+    if (hdisk)
+      snprintf(lines[n++], STATS_WIDTH, _("History        %ld lines in %s on disk, %s unpacked"),
+               hist_lines(us->hist), a, b);
+    else
+      snprintf(lines[n++], STATS_WIDTH, _("History        %ld lines in %s, %s unpacked"),
+               hist_lines(us->hist), a, b);
+  }
+
+  lat_summary(lat, sizeof(lat), 1);
+  if (lat[0])
+    snprintf(lines[n++], STATS_WIDTH, _("Latency        %s"), lat);
+
+  return n;
+}
+
+/*
+ * Show everything in a window, updated every second, until a key
+ * is pressed. 'R' starts counting again, 'L' goes to the latency
+ * test, 'T' to the line test.
+ */
+void stats_window(void)
+{
+  char lines[STATS_LINES][STATS_WIDTH];
+  WIN *w;
+  int x1, x2, i, n, c, first;
+  const char *s;
+
+  x1 = COLS / 2 - 30;
+  x2 = COLS / 2 + 30;
+  w = mc_wopen(x1, 5, x2, 8 + STATS_LINES, BDOUBLE, stdattr,
+               mfcolor, mbcolor, 0, 0, 1);
+  mc_wtitle(w, TMID, _("Statistics"));
+  mc_wcursor(w, CNONE);
+
+  for (first = 1; ; first = 0) {
+    n = stats_text(lines);
+    for (i = 0; i < STATS_LINES; i++) {
+      mc_wlocate(w, 1, i + 1);
+      mc_wprintf(w, "%s", i < n ? lines[i] : "");
+      mc_wclreol(w);
+    }
+    s = _("R reset, L latency test, T line test, other key: continue");
+    mc_wlocate(w, (x2 - x1) / 2 - strlen(s) / 2, STATS_LINES + 2);
+    mc_wputs(w, s);
+    if (first)
+      mc_wredraw(w, 1);
+    else
+      mc_wflush();
+
+    if (!backlog_key(1000))
+      continue;
+    c = wxgetch();
+    if (c == 'l' || c == 'L') {
+      mc_wclose(w, 1);
+      lat_window();
+      return;
+    }
+    if (c == 't' || c == 'T') {
+      mc_wclose(w, 1);
+      prbs_window();
+      return;
+    }
+    if (c != 'r' && c != 'R')
+      break;
+    stats_reset();
+  }
+  mc_wclose(w, 1);
+}
+
+/*
+ * Write everything to the log file.
+ */
+void stats_dump(void)
+{
+  char lines[STATS_LINES][STATS_WIDTH];
+  char ilines[INSTR_LINES][INSTR_WIDTH];
+  int i, n;
+
+  n = stats_text(lines);
+  for (i = 0; i < n; i++)
+    do_log("%s", lines[i]);
+  n = instr_text(ilines);
+  for (i = 0; i < n; i++)
+    do_log("%s", ilines[i]);
+}
+
+/*
+ * Start counting again.
+ */
+void stats_reset(void)
+{
+  memset(&st_rx, 0, sizeof(st_rx));
+  memset(&st_tx, 0, sizeof(st_tx));
+  memset(&st_errs, 0, sizeof(st_errs));
+  time(&st_start);
+  st_errfd = -1;
+  st_errsec = 0;
+}
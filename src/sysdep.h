@@ -56,6 +56,11 @@
 #include <stdio.h>
 #include <setjmp.h>
 
+/* Error counters of the serial driver (TIOCGICOUNT). */
+#if defined(__linux__) && defined(TIOCGICOUNT)
+#  include <linux/serial.h>
+#endif
+
 /* Be sure we know WEXITSTATUS and WTERMSIG */
 #if !defined(_BSD43)
 #  ifndef WEXITSTATUS
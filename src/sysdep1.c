@@ -4,6 +4,7 @@
  *		m_dtrtoggle	- dropt dtr and raise it again
  *		m_break		- send BREAK signal
  *		m_getdcd	- get modem dcd status
+ *		m_getcts	- get modem cts status
  *		m_setdcd	- set modem dcd status
  *		m_savestate	- save modem state
  *		m_restorestate	- restore saved modem state
@@ -11,6 +12,8 @@
  *		m_hupcl		- set hangup on close on/off
  *		m_setparms	- set speed, parity, bits and stopbits
  *		m_readchk	- see if there is input waiting.
+ *		m_outchk	- see how much output is waiting.
+ *		m_geterrs	- get the error counters of the driver.
  *		m_wait		- wait for child to finish. Sysdep. too.
  *
  *		If it's possible, Posix termios are preferred.
@@ -194,6 +197,29 @@ int m_getdcd(int fd)
 #endif
 }
 
+/*
+ * Get the cts status
+ */
+int m_getcts(int fd)
+{
+#ifdef USE_SOCKET
+  if (portfd_is_socket)
+    return -1;
+#endif
+#if defined(TIOCMODG) && defined(TIOCM_CTS)
+  {
+    int mcs = 0;
+
+    if (ioctl(fd, TIOCMODG, &mcs) < 0)
+      return -1;
+    return mcs & TIOCM_CTS ? 1 : 0;
+  }
+#else
+  (void)fd;
+  return -1;
+#endif
+}
+
 /* Variables to save states in */
 #ifdef POSIX_TERMIOS
 static struct termios savetty;
@@ -339,6 +365,52 @@ int m_readchk(int fd)
 #endif
 }
 
+/*
+ * See how much output the driver has not sent yet.
+ * returns: number of bytes, -1=can't.
+ */
+int m_outchk(int fd)
+{
+#ifdef TIOCOUTQ
+  int i;
+
+  if (ioctl(fd, TIOCOUTQ, &i) < 0)
+    return -1;
+  return i;
+#else
+  (void)fd;
+  return -1;
+#endif
+}
+
+/*
+ * Get the error counters of the driver, counted since it was loaded.
+ * returns: 0=ok, -1=can't.
+ */
+int m_geterrs(int fd, struct lineerrs *e)
+{
+#if defined(__linux__) && defined(TIOCGICOUNT)
+  struct serial_icounter_struct ic;
+
+#ifdef USE_SOCKET
+  if (portfd_is_socket)
+    return -1;
+#endif
+  if (ioctl(fd, TIOCGICOUNT, &ic) < 0)
+    return -1;
+  e->overrun = ic.overrun;
+  e->frame = ic.frame;
+  e->parity = ic.parity;
+  e->brk = ic.brk;
+  e->buf_overrun = ic.buf_overrun;
+  return 0;
+#else
+  (void)fd;
+  (void)e;
+  return -1;
+#endif
+}
+
 /*
  * Get maximum speed.
  * Returns maximum speed in baud
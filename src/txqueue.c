@@ -0,0 +1,536 @@
+/*
+ * txqueue.c	Send data to the serial port without blocking the rest.
+ *
+ *		Everything that is typed, sent by a macro, pasted or
+ *		sent by the dialer goes through this queue. Data without
+ *		a delay goes out in one write(). With a character delay,
+ *		each byte gets a deadline, and pauses (the newline delay,
+ *		'~' in modem strings) are deadlines too. The main loop
+ *		sleeps until the next deadline with txq_timeout() and
+ *		calls txq_run() to send what is due, so a paced send
+ *		never stops the terminal from receiving.
+ *
+ *		There are two lanes. Keys typed go in TXQ_KEYS, pastes,
+ *		macros and modem strings in TXQ_BULK. Keys always go
+ *		first, and the bulk lane only gives the driver about a
+ *		tenth of a second of data at a time (by asking it with
+ *		TIOCOUTQ), so a key never waits behind a whole paste.
+ *
+ *		The port is written in non-blocking mode, so when flow
+ *		control holds the output back, the queue grows instead
+ *		of minicom hanging in write(). txq_stalled() tells why
+ *		output is stuck. Above "txqmax" bytes, "txpolicy" says
+ *		whether bulk senders wait for room, what does not fit is
+ *		dropped, or the bulk send is aborted. Nothing here waits:
+ *		a sender that waits asks txq_space() how much it may
+ *		queue and comes back from the main loop for the rest.
+ *		Keys are always queued.
+ *
+ *		Entry points:
+ *
+ *		txq_write(s, len, pace) - queue data, pace ms between bytes
+ *		txq_pause(ms)           - wait before what comes next
+ *		txq_eol(ms)             - wait after every newline
+ *		txq_lane(lane)          - select the lane to queue in
+ *		txq_pending()           - is anything left to send?
+ *		txq_queued()            - bytes left to send
+ *		txq_bulk()              - bytes left in the bulk lane
+ *		txq_space()             - bytes the bulk lane may take
+ *		txq_stalled()           - why output is stuck, 0 if it isn't
+ *		txq_hiwat()             - most bytes that were ever queued
+ *		txq_cancel()            - drop the bulk lane
+ *		txq_timeout()           - ms until the next send, -1 if none
+ *		txq_run()               - send what is due
+ *		txq_drain()             - send everything, for callers
+ *		                          without a main loop; gives up
+ *		                          if output is stuck
+ *		txq_clear()             - drop what has not been sent
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <limits.h>
+
+#include "port.h"
+#include "minicom.h"
+#include "intl.h"
+
+/* Smallest block that is allocated for queued data. */
+#define TXQ_BLOCK	1024
+
+/* How much bulk data the driver may hold, in ms of line time. */
+#define TXQ_OUTQ_MS	100
+
+/* How often to try again when the driver takes nothing. */
+#define TXQ_RETRY_MS	20
+
+/* How long txq_drain() waits for output that does not move. */
+#define TXQ_STUCK_MS	5000
+
+struct txblock {
+  struct txblock *next;
+  int pause;			/* ms to wait before the first byte */
+  int pace;			/* ms to wait after every byte */
+  int eol;			/* ms to wait after every newline */
+  int size;			/* Room in data */
+  int len;			/* Bytes in data */
+  int done;			/* Bytes already sent */
+  char data[];
+};
+
+struct txlane {
+  struct txblock *head, *tail;
+  long bytes;			/* Bytes not sent yet */
+  int eol;			/* For what is queued from now on */
+  struct timeval due;		/* Nothing is sent before this */
+};
+
+static struct txlane txq_lanes[2];
+static int txq_cur = TXQ_KEYS;
+static int txq_fd = -1;			/* Port we set non-blocking */
+static int txq_flags;			/* Its file flags before */
+static int txq_why;			/* Why output is stuck */
+static int txq_lastoutq = -1;
+static long txq_dropped;		/* Since the queue was last empty */
+static long txq_max;			/* High-water mark */
+
+static struct txblock *txq_add(struct txlane *l, int size, int pace, int eol)
+{
+  struct txblock *b;
+
+  if (size < TXQ_BLOCK)
+    size = TXQ_BLOCK;
+  if ((b = malloc(sizeof(struct txblock) + size)) == NULL)
+    return NULL;
+  b->next = NULL;
+  b->pause = 0;
+  b->pace = pace;
+  b->eol = eol;
+  b->size = size;
+  b->len = 0;
+  b->done = 0;
+  if (l->tail)
+    l->tail->next = b;
+  else
+    l->head = b;
+  l->tail = b;
+  return b;
+}
+
+static void txq_pop(struct txlane *l)
+{
+  struct txblock *b = l->head;
+
+  l->head = b->next;
+  if (l->head == NULL)
+    l->tail = NULL;
+  l->bytes -= b->len - b->done;
+  free(b);
+}
+
+/* Give the port its own file flags back. */
+static void txq_release(void)
+{
+  if (txq_fd >= 0 && txq_fd == portfd)
+    fcntl(txq_fd, F_SETFL, txq_flags);
+  txq_fd = -1;
+}
+
+/* Output does not move; find out why. */
+static void txq_stall(void)
+{
+  if (P_HASRTS[0] == 'Y' && m_getcts(portfd) == 0)
+    txq_why = TXQ_CTS;
+  else if (P_HASXON[0] == 'Y')
+    txq_why = TXQ_XOFF;
+  else
+    txq_why = TXQ_FULL;
+}
+
+/* Set the deadline of a lane to ms from now. */
+static void txq_delay(struct txlane *l, struct timeval *now, int ms)
+{
+  l->due.tv_sec = now->tv_sec + ms / 1000;
+  l->due.tv_usec = now->tv_usec + (ms % 1000) * 1000;
+  if (l->due.tv_usec >= 1000000) {
+    l->due.tv_sec++;
+    l->due.tv_usec -= 1000000;
+  }
+}
+
+/* Milliseconds until a lane may send, -1 if it is empty. */
+static int txq_wait(struct txlane *l, struct timeval *now)
+{
+  long ms;
+
+  if (l->head == NULL)
+    return -1;
+  ms = (l->due.tv_sec - now->tv_sec) * 1000 +
+       (l->due.tv_usec - now->tv_usec + 999) / 1000;
+  if (ms <= 0)
+    return 0;
+  /* The clock was set back. */
+  if (ms > 60000)
+    ms = 0;
+  return ms;
+}
+
+/*
+ * How many bytes of bulk data the driver may take now. If none, *ms
+ * is set to about the time until it can take some again.
+ */
+static int txq_room(int *ms)
+{
+  int cps, limit, outq;
+
+  /* About 10 bits per character. */
+  cps = atoi(P_BAUDRATE) / 10;
+  if (cps <= 0 || (outq = m_outchk(portfd)) < 0)
+    return INT_MAX;
+  limit = cps * TXQ_OUTQ_MS / 1000;
+  if (limit < 16)
+    limit = 16;
+  if (outq < limit) {
+    txq_lastoutq = -1;
+    return limit - outq;
+  }
+  /* Nothing went out since we last looked. */
+  if (outq == txq_lastoutq)
+    txq_stall();
+  txq_lastoutq = outq;
+  *ms = (outq - limit / 2) * 1000 / cps;
+  if (*ms < 1)
+    *ms = 1;
+  return 0;
+}
+
+/*
+ * Queue len bytes in the current lane, with pace milliseconds between
+ * them, and send what can go out right away.
+ */
+void txq_write(const char *s, int len, int pace)
+{
+  struct txlane *l = &txq_lanes[txq_cur];
+  struct txblock *b;
+  long max, n;
+  char msg[80];
+
+  if (pace < 0)
+    pace = 0;
+
+  if (!txq_pending())
+    txq_dropped = 0;
+  max = atol(P_TXQMAX);
+  if (max > 0 && txq_cur == TXQ_BULK && txq_queued() + len > max) {
+    switch (P_TXPOLICY[0]) {
+      case 'd': /* Keep what fits */
+        n = max - txq_queued();
+        if (n < 0)
+          n = 0;
+        txq_dropped += len - n;
+        snprintf(msg, sizeof(msg),
+                 _("Output queue full, %ld bytes dropped"), txq_dropped);
+        status_set_display(msg, 0);
+        len = n;
+        break;
+      case 'a': /* Give up on the bulk send */
+        txq_dropped += txq_cancel() + len;
+        snprintf(msg, sizeof(msg),
+                 _("Output queue full, send aborted (%ld bytes)"),
+                 txq_dropped);
+        status_set_display(msg, 0);
+        return;
+      default: /* The sender waits, with txq_space() */
+        break;
+    }
+  }
+
+  b = l->tail;
+  l->bytes += len;
+  if (txq_queued() > txq_max)
+    txq_max = txq_queued();
+  while (len > 0) {
+    if (b == NULL || b->pace != pace || b->eol != l->eol ||
+        b->len == b->size) {
+      if ((b = txq_add(l, len, pace, l->eol)) == NULL) {
+        /* Out of memory: send it the old way. */
+        l->bytes -= len;
+        txq_drain();
+        while (len > 0 && (n = write(portfd, s, len)) > 0) {
+          PROBE2(serial_write, portfd, n);
+          stats_tx(n);
+          s += n;
+          len -= n;
+        }
+        return;
+      }
+    }
+    n = b->size - b->len;
+    if (n > len)
+      n = len;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    s += n;
+    len -= n;
+  }
+  txq_run();
+}
+
+/*
+ * Wait ms milliseconds before sending what is queued next in the
+ * current lane.
+ */
+void txq_pause(int ms)
+{
+  struct txlane *l = &txq_lanes[txq_cur];
+  struct txblock *b = l->tail;
+
+  if (ms <= 0)
+    return;
+  if (b == NULL || b->len > 0)
+    b = txq_add(l, 0, b ? b->pace : 0, l->eol);
+  if (b)
+    b->pause += ms;
+  txq_run();
+}
+
+/*
+ * Wait ms milliseconds after every newline that is queued in the
+ * current lane from now on, 0 for not. The delay goes with the data,
+ * so lines share blocks.
+ */
+void txq_eol(int ms)
+{
+  txq_lanes[txq_cur].eol = ms < 0 ? 0 : ms;
+}
+
+/*
+ * Select the lane that txq_write() and txq_pause() queue in.
+ * Returns the one that was selected before.
+ */
+int txq_lane(int lane)
+{
+  int old = txq_cur;
+
+  txq_cur = lane;
+  return old;
+}
+
+/*
+ * Is there anything left to send?
+ */
+int txq_pending(void)
+{
+  return txq_lanes[TXQ_KEYS].head != NULL ||
+         txq_lanes[TXQ_BULK].head != NULL;
+}
+
+/*
+ * Bytes left to send.
+ */
+long txq_queued(void)
+{
+  return txq_lanes[TXQ_KEYS].bytes + txq_lanes[TXQ_BULK].bytes;
+}
+
+/*
+ * Bytes left in the bulk lane.
+ */
+long txq_bulk(void)
+{
+  return txq_lanes[TXQ_BULK].bytes;
+}
+
+/*
+ * Bytes the bulk lane may take before it is above "txqmax". A sender
+ * that has more stops there, and sends the rest from the main loop
+ * when there is room again.
+ */
+long txq_space(void)
+{
+  long max = atol(P_TXQMAX);
+
+  if (max <= 0)
+    return LONG_MAX;
+  return max > txq_queued() ? max - txq_queued() : 0;
+}
+
+/*
+ * The most bytes that were ever waiting to be sent.
+ */
+long txq_hiwat(void)
+{
+  return txq_max;
+}
+
+/*
+ * Why output is stuck: TXQ_CTS, TXQ_XOFF or TXQ_FULL (the driver
+ * takes nothing, for no reason we know). 0 if it moves.
+ */
+int txq_stalled(void)
+{
+  return txq_pending() ? txq_why : 0;
+}
+
+/*
+ * Drop what is left in the bulk lane, e.g. when the user interrupts
+ * a paste. Returns the number of bytes dropped.
+ */
+long txq_cancel(void)
+{
+  long n = txq_bulk();
+
+  while (txq_lanes[TXQ_BULK].head)
+    txq_pop(&txq_lanes[TXQ_BULK]);
+  return n;
+}
+
+/*
+ * Milliseconds until txq_run() has something to do, -1 if the
+ * queue is empty.
+ */
+int txq_timeout(void)
+{
+  struct timeval now;
+  int k, b;
+
+  gettimeofday(&now, NULL);
+  k = txq_wait(&txq_lanes[TXQ_KEYS], &now);
+  b = txq_wait(&txq_lanes[TXQ_BULK], &now);
+  if (k < 0 || (b >= 0 && b < k))
+    return b;
+  return k;
+}
+
+/*
+ * Send everything that is due, keys first.
+ */
+void txq_run(void)
+{
+  struct txlane *l;
+  struct txblock *b;
+  struct timeval now;
+  char *p;
+  int n, room, ms;
+
+  gettimeofday(&now, NULL);
+  while (1) {
+    if (txq_wait(&txq_lanes[TXQ_KEYS], &now) == 0)
+      l = &txq_lanes[TXQ_KEYS];
+    else if (txq_wait(&txq_lanes[TXQ_BULK], &now) == 0)
+      l = &txq_lanes[TXQ_BULK];
+    else
+      return;
+    b = l->head;
+    if (b->pause) {
+      txq_delay(l, &now, b->pause);
+      b->pause = 0;
+      continue;
+    }
+    if (b->done == b->len) {
+      txq_pop(l);
+      continue;
+    }
+    if (portfd != txq_fd) {
+      /* Never block in write(); what does not fit stays queued. */
+      txq_flags = fcntl(portfd, F_GETFL, 0);
+      fcntl(portfd, F_SETFL, txq_flags | O_NONBLOCK);
+      txq_fd = portfd;
+    }
+    n = b->pace ? 1 : b->len - b->done;
+    if (b->eol && (p = memchr(b->data + b->done, '\n', n)) != NULL)
+      n = p - (b->data + b->done) + 1;
+    if (l == &txq_lanes[TXQ_BULK]) {
+      /* Leave room in the driver for keys. */
+      if ((room = txq_room(&ms)) == 0) {
+        txq_delay(l, &now, ms);
+        continue;
+      }
+      if (n > room)
+        n = room;
+    }
+    n = write(portfd, b->data + b->done, n);
+    PROBE2(serial_write, portfd, n);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN) {
+      /* The driver is full: try again a little later. */
+      txq_stall();
+      txq_delay(l, &now, TXQ_RETRY_MS);
+      continue;
+    }
+    if (n < 0) {
+      /* The port is gone; the data goes with it. */
+      txq_clear();
+      return;
+    }
+    txq_why = 0;
+    stats_tx(n);
+    b->done += n;
+    l->bytes -= n;
+    ms = b->pace;
+    if (b->eol && b->data[b->done - 1] == '\n')
+      ms += b->eol;
+    if (ms)
+      txq_delay(l, &now, ms);
+  }
+}
+
+/*
+ * Send everything now. Used where nothing else would run the queue,
+ * e.g. before the port is handed to another program. While waiting,
+ * the port keeps being read into the backlog if it is active. When
+ * flow control or a dead line keeps output stuck for TXQ_STUCK_MS,
+ * what is left is dropped. Afterwards the port is in blocking mode
+ * again, as other programs expect it to be.
+ */
+void txq_drain(void)
+{
+  struct timeval since, now;
+  char msg[80];
+  int ms;
+
+  txq_run();
+  gettimeofday(&since, NULL);
+  while ((ms = txq_timeout()) >= 0) {
+    gettimeofday(&now, NULL);
+    if (!txq_stalled())
+      since = now;
+    else if ((now.tv_sec - since.tv_sec) * 1000 +
+             (now.tv_usec - since.tv_usec) / 1000 >= TXQ_STUCK_MS) {
+      snprintf(msg, sizeof(msg), _("Output stuck, %ld bytes dropped"),
+               txq_queued());
+      status_set_display(msg, 0);
+      txq_clear();
+      break;
+    }
+    backlog_wait(ms);
+    txq_run();
+  }
+  txq_release();
+}
+
+/*
+ * Drop everything that has not been sent, e.g. because the port is
+ * about to be closed. The port gets its file flags back.
+ */
+void txq_clear(void)
+{
+  txq_cancel();
+  while (txq_lanes[TXQ_KEYS].head)
+    txq_pop(&txq_lanes[TXQ_KEYS]);
+  txq_release();
+  txq_why = 0;
+}
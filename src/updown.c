@@ -37,8 +37,13 @@
 
 /*#define LOG_XFER	  debugging option to log all output of rz/sz
  */
+
+/* How much of a paste to keep queued ahead. */
+#define PASTE_AHEAD	16384
+
 static int udpid;
 static int script_running;
+static FILE *paste_fp;		/* The file paste_more() sends from */
 
 /*
  * Change to a directory.
@@ -297,6 +302,10 @@ void updown(int what, int nr)
   if (P_LOGXFER[0] == 'Y')
     do_log("%s", cmdline);   /* jl 22.06.97 */
 
+  /* The transfer program reads the port itself. */
+  txq_drain();
+  term_replay();
+
   if (P_PFULL(g) == 'N') {
     win = mc_wopen(10, 7, 70, 13, BSINGLE, stdattr, mfcolor, mbcolor, 1, 0, 1);
     snprintf(title, sizeof(title), _("%.30s %s - Press CTRL-C to quit"), P_PNAME(g),
@@ -348,6 +357,7 @@ void updown(int what, int nr)
         free(cmdline);
       exit(1);
     default: /* Parent */
+      PROBE2(updown_start, udpid, what);
       break;
   }
  
@@ -405,6 +415,7 @@ void updown(int what, int nr)
   }
 
   while (udpid != m_wait(&status));
+  PROBE2(updown_exit, udpid, status);
   if (win) {
     enab_sig(0, 0);
     signal(SIGINT, SIG_IGN);
@@ -513,6 +524,10 @@ void kermit(void)
     return;
   }
 
+  /* Kermit reads the port itself. */
+  txq_drain();
+  term_replay();
+
   /* Clear screen, set keyboard modes etc. */
   mc_wleave();
 
@@ -716,6 +731,10 @@ void runscript(int ask, const char *s, const char *l, const char *p)
   snprintf(cmdline, sizeof(cmdline), "%s %s %s %s",
            P_SCRIPTPROG, scr_name, logfname, logfname[0]==0? "": homedir);
 
+  /* The script talks to the port itself. */
+  txq_drain();
+  term_replay();
+
   switch (udpid = fork()) {
     case -1:
       werror(_("Out of memory: could not fork()"));
@@ -795,60 +814,67 @@ void runscript(int ask, const char *s, const char *l, const char *p)
 */
 int paste_file(void)
 {
-  FILE *fp;
-  char line[1024];
   char *s;
-  const int dotrans = 0;
-  const int ldelay = 1;      /* hardcoded 1 ms */
-  char buf[128] = "";
-  char *ptr;
-  int bytes_read;
-  unsigned long bdone = 0;
-  int x;
 
+  if (paste_fp) {
+    werror(_("Still pasting, ^C stops it"));
+    return -1;
+  }
   if ((s = filedir(1, 0)) == NULL)
     return 0;
-  if ((fp = fopen(s, "r")) == NULL) {
+  if ((paste_fp = fopen(s, "r")) == NULL) {
     perror(s);
     return -1;
   }
+  paste_more();
+  return 0;
+}
 
-  while (fgets(line, sizeof(line), fp)) {
-    /* Check for I/O or timer. */
-    x = check_io(portfd_connected, 0, 1000, buf, sizeof(buf), &bytes_read);
-
-    /*  Send data from the modem to the screen. */
-    if ((x & 1)) {
-      ptr = buf;
-      while (bytes_read-- > 0) {
-	if (P_PARITY[0] == 'M' || P_PARITY[0] == 'S')
-	  *ptr &= 0x7f;
-	vt_out(*ptr++);
-      }
-      mc_wflush();
-    }
+/*
+ * Queue more of the file being pasted, as much as the bulk lane has
+ * room for; the terminal loop calls this until the file is sent, so
+ * nothing waits and keys typed meanwhile go first.
+ */
+void paste_more(void)
+{
+  char line[1024];
+  char *s;
+  const int dotrans = 0;
+  const int ldelay = 1;      /* hardcoded 1 ms */
+  int lane;
 
+  if (paste_fp == NULL)
+    return;
+  lane = txq_lane(TXQ_BULK);
+  txq_eol(ldelay);
+  while (txq_bulk() < PASTE_AHEAD && txq_space() >= 2 * (long)sizeof(line)) {
+    if (fgets(line, sizeof(line), paste_fp) == NULL) {
+      paste_stop();
+      break;
+    }
     if (dotrans && (s = strrchr(line, '\n')) != NULL) {
       if (s > line && *(s - 1) == '\r')
 	s--;
       *s = 0;
-      s = line;
       for (s = line; *s; s++)
 	vt_send(*s);
       vt_send('\r');
       vt_send('\n');
-      bdone += strlen(line) + 2;
     } else {
       for (s = line; *s; s++)
 	vt_send(*s);
-      bdone += strlen(s);
-    }
-    if (ldelay) {
-#ifdef HAVE_USLEEP
-      usleep(ldelay * 1000);
-#endif
     }
   }
-  fclose(fp);
-  return 0;
+  txq_eol(0);
+  txq_lane(lane);
+}
+
+/*
+ * Stop pasting; what is queued already still goes out.
+ */
+void paste_stop(void)
+{
+  if (paste_fp)
+    fclose(paste_fp);
+  paste_fp = NULL;
 }
@@ -31,22 +31,15 @@
 #include "port.h"
 #include "minicom.h"
 #include "vt100.h"
+#include "vtparse.h"
 #include "config.h"
 
 /*
- * The global variable esc_s holds the escape sequence status:
- * 0 - normal
- * 1 - ESC
- * 2 - ESC [
- * 3 - ESC [ ?
- * 4 - ESC (
- * 5 - ESC )
- * 6 - ESC #
- * 7 - ESC P
+ * Escape sequences are taken apart by the parser in vtparse.c; the
+ * functions below are called once a sequence is complete. All state
+ * is in a struct vt, see vt100.h.
  */
-static int esc_s = 0;
-
-#define ESC 27
+struct vt vt_std = VT_INIT;
 
 /* Structure to hold escape sequences. */
 struct escseq {
@@ -128,158 +121,117 @@ static char * vt_map[] = {
   "\205\240\203\376\204\206\221\207\212\202\210\211\215\241\214\213"
   "\376\244\225\242\223\376\224\366\376\227\243\226\201\376\376\230"
 };
-static char *vt_trans[2];
-static int vt_charset;          /* Character set. */
-#endif
-
-static int vt_echo;		/* Local echo on/off. */
-int vt_nl_delay;		/* Delay after CR key */
-int vt_ch_delay;		/* Delay between characters */
-static int vt_type = ANSI;	/* Terminal type. */
-static int vt_wrap;             /* Line wrap on/off */
-static int vt_addlf;            /* Add linefeed on/off */
-static int vt_addcr;            /* Add carriagereturn on/off */
-static int vt_fg;		/* Standard foreground color. */
-static int vt_bg;		/* Standard background color. */
-static int vt_keypad;		/* Keypad mode. */
-static int vt_cursor;		/* cursor key mode. */
-static int vt_asis;		/* 8bit clean mode. */
-static int vt_line_timestamp;	/* Timestamp each line. */
-static int vt_bs = 8;		/* Code that backspace key sends. */
-static int vt_insert;           /* Insert mode */
-static int vt_crlf;		/* Return sends CR/LF */
-static int vt_om;		/* Origin mode. */
-WIN *vt_win;                    /* Output window. */
-static int vt_docap;		/* Capture on/off. */
-static void (*vt_keyb)(int, int);/* Gets called for NORMAL/APPL switch. */
-static void (*termout)(const char *, int);/* Gets called to output a string. */
-
-static int escparms[8];		/* Cumulated escape sequence. */
-static int ptr;                 /* Index into escparms array. */
-static long vt_tabs[5];		/* Tab stops for max. 32*5 = 160 columns. */
-
-static short newy1 = 0;		/* Current size of scrolling region. */
-static short newy2 = 23;
-
-/* Saved color and posistions */
-static short savex, savey, saveattr = XA_NORMAL, savecol = 112;
-
-#if TRANSLATE
-static short savecharset;
-static char *savetrans[2];
 #endif
 
 /*
  * Initialize the emulator once.
  */
-void vt_install(void (*fun1)(const char *, int), void (*fun2)(int, int),
-                WIN *win)
+void vte_install(struct vt *vt, void (*fun1)(const char *, int),
+                 void (*fun2)(int, int), WIN *win)
 {
-  termout = fun1;
-  vt_keyb = fun2;
-  vt_win = win;
+  vt->termout = fun1;
+  vt->keyb = fun2;
+  vt->win = win;
 }
 
 /* Partial init (after screen resize) */
-void vt_pinit(WIN *win, int fg, int bg)
+void vte_pinit(struct vt *vt, WIN *win, int fg, int bg)
 {
-  vt_win = win;
-  newy1 = 0;
-  newy2 = vt_win->ys - 1;
-  mc_wresetregion(vt_win);
+  vt->win = win;
+  vt->newy1 = 0;
+  vt->newy2 = vt->win->ys - 1;
+  mc_wresetregion(vt->win);
   if (fg > 0)
-    vt_fg = fg;
+    vt->fg = fg;
   if (bg > 0)
-    vt_bg = bg;
-  mc_wsetfgcol(vt_win, vt_fg);
-  mc_wsetbgcol(vt_win, vt_bg);
+    vt->bg = bg;
+  mc_wsetfgcol(vt->win, vt->fg);
+  mc_wsetbgcol(vt->win, vt->bg);
 }
 
 /* Set characteristics of emulator. */
-void vt_init(int type, int fg, int bg, int wrap, int add_lf, int add_cr)
+void vte_init(struct vt *vt, int type, int fg, int bg, int wrap,
+              int add_lf, int add_cr)
 {
-  vt_type = type;
-  if (vt_type == ANSI) {
-	vt_fg = WHITE;
-	vt_bg = BLACK;
+  vt->type = type;
+  if (vt->type == ANSI) {
+	vt->fg = WHITE;
+	vt->bg = BLACK;
   } else {
-	vt_fg = fg;
-	vt_bg = bg;
+	vt->fg = fg;
+	vt->bg = bg;
   }
   if (wrap >= 0)
-    vt_win->wrap = vt_wrap = wrap;
-  vt_addlf = add_lf;
-  vt_addcr = add_cr;
-  vt_insert = 0;
-  vt_crlf = 0;
-  vt_om = 0;
+    vt->win->wrap = vt->wrap = wrap;
+  vt->addlf = add_lf;
+  vt->addcr = add_cr;
+  vt->insert = 0;
+  vt->crlf = 0;
+  vt->om = 0;
 
-  newy1 = 0;
-  newy2 = vt_win->ys - 1;
-  mc_wresetregion(vt_win);
-  vt_keypad = NORMAL;
-  vt_cursor = NORMAL;
-  vt_echo = local_echo;
-  vt_tabs[0] = 0x01010100;
-  vt_tabs[1] =
-  vt_tabs[2] =
-  vt_tabs[3] =
-  vt_tabs[4] = 0x01010101;
+  vt->newy1 = 0;
+  vt->newy2 = vt->win->ys - 1;
+  mc_wresetregion(vt->win);
+  vt->keypad = NORMAL;
+  vt->cursor = NORMAL;
+  vt->tabs[0] = 0x01010100;
+  vt->tabs[1] =
+  vt->tabs[2] =
+  vt->tabs[3] =
+  vt->tabs[4] = 0x01010101;
 #if TRANSLATE
-  vt_charset = 0;
-  vt_trans[0] = savetrans[0] = vt_map[0];
-  vt_trans[1] = savetrans[1] = vt_map[1];
+  vt->charset = 0;
+  vt->trans[0] = vt->savetrans[0] = vt_map[0];
+  vt->trans[1] = vt->savetrans[1] = vt_map[1];
 #endif
-  ptr = 0;
-  memset(escparms, 0, sizeof(escparms));
-  esc_s = 0;
+  vtp_init(&vt->parser);
 
-  if (vt_keyb)
-    (*vt_keyb)(vt_keypad, vt_cursor);
-  mc_wsetfgcol(vt_win, vt_fg);
-  mc_wsetbgcol(vt_win, vt_bg);
+  if (vt->keyb)
+    (*vt->keyb)(vt->keypad, vt->cursor);
+  mc_wsetfgcol(vt->win, vt->fg);
+  mc_wsetbgcol(vt->win, vt->bg);
 }
 
 /* Change some things on the fly. */
-void vt_set(int addlf, int wrap, int docap, int bscode,
-            int echo, int cursor, int asis, int timestamp,
-            int addcr)
+void vte_set(struct vt *vt, int addlf, int wrap, int docap, int bscode,
+             int echo, int cursor, int asis, int timestamp,
+             int addcr)
 {
   if (addlf >= 0)
-    vt_addlf = addlf;
+    vt->addlf = addlf;
   if (wrap >= 0)
-    vt_win->wrap = vt_wrap = wrap;
+    vt->win->wrap = vt->wrap = wrap;
   if (docap >= 0)
-    vt_docap = docap;
+    vt->docap = docap;
   if (bscode >= 0)
-    vt_bs = bscode;
+    vt->bs = bscode;
   if (echo >= 0)
-    vt_echo = echo;
+    vt->echo = echo;
   if (cursor >= 0)
-    vt_cursor = cursor;
+    vt->cursor = cursor;
   if (asis >=0)
-    vt_asis = asis;
+    vt->asis = asis;
   if (timestamp >= 0)
-    vt_line_timestamp = timestamp;
+    vt->timestamp = timestamp;
   if (addcr >= 0)
-    vt_addcr = addcr;
+    vt->addcr = addcr;
 }
 
 /* Output a string to the modem. */
-static void v_termout(const char *s, int len)
+static void v_termout(struct vt *vt, const char *s, int len)
 {
   const char *p;
 
-  if (vt_echo) {
+  if (vt->echo) {
     for (p = s; *p; p++) {
-      vt_out(*p);
-      if (!vt_addlf && *p == '\r')
-        vt_out('\n');
+      vte_out(vt, *p);
+      if (!vt->addlf && *p == '\r')
+        vte_out(vt, '\n');
     }
     mc_wflush();
   }
 
-  (*termout)(s, len);
+  (*vt->termout)(s, len);
 }
 
 /*
@@ -287,103 +239,88 @@ static void v_termout(const char *s, int len)
  */
 
 /*
- * ESC was seen the last time. Process the next character.
+ * ESC and a final character were seen.
  */
-static void state1(int c)
+static void esc_final(struct vt *vt, int c)
 {
   short x, y, f;
 
   switch(c) {
-    case '[': /* ESC [ */
-      esc_s = 2;
-      return;
-    case '(': /* ESC ( */
-      esc_s = 4;
-      return;
-    case ')': /* ESC ) */
-      esc_s = 5;
-      return;
-    case '#': /* ESC # */
-      esc_s = 6;
-      return;
-    case 'P': /* ESC P (DCS, Device Control String) */
-      esc_s = 7;
-      return;
     case 'D': /* Cursor down */
     case 'M': /* Cursor up */
-      x = vt_win->curx;
+      x = vt->win->curx;
       if (c == 'D') { /* Down. */
-        y = vt_win->cury + 1;
-        if (y == newy2 + 1)
-          mc_wscroll(vt_win, S_UP);
-        else if (vt_win->cury < vt_win->ys)
-          mc_wlocate(vt_win, x, y);
+        y = vt->win->cury + 1;
+        if (y == vt->newy2 + 1)
+          mc_wscroll(vt->win, S_UP);
+        else if (vt->win->cury < vt->win->ys)
+          mc_wlocate(vt->win, x, y);
       }
       if (c == 'M')  { /* Up. */
-        y = vt_win->cury - 1;
-        if (y == newy1 - 1)
-          mc_wscroll(vt_win, S_DOWN);
+        y = vt->win->cury - 1;
+        if (y == vt->newy1 - 1)
+          mc_wscroll(vt->win, S_DOWN);
         else if (y >= 0)
-          mc_wlocate(vt_win, x, y);
+          mc_wlocate(vt->win, x, y);
       }
       break;
     case 'E': /* CR + NL */
-      mc_wputs(vt_win, "\r\n");
+      mc_wputs(vt->win, "\r\n");
       break;
     case '7': /* Save attributes and cursor position */
     case 's':
-      savex = vt_win->curx;
-      savey = vt_win->cury;
-      saveattr = vt_win->attr;
-      savecol = vt_win->color;
+      vt->savex = vt->win->curx;
+      vt->savey = vt->win->cury;
+      vt->saveattr = vt->win->attr;
+      vt->savecol = vt->win->color;
 #if TRANSLATE
-      savecharset = vt_charset;
-      savetrans[0] = vt_trans[0];
-      savetrans[1] = vt_trans[1];
+      vt->savecharset = vt->charset;
+      vt->savetrans[0] = vt->trans[0];
+      vt->savetrans[1] = vt->trans[1];
 #endif
       break;
     case '8': /* Restore them */
     case 'u':
 #if TRANSLATE
-      vt_charset = savecharset;
-      vt_trans[0] = savetrans[0];
-      vt_trans[1] = savetrans[1];
+      vt->charset = vt->savecharset;
+      vt->trans[0] = vt->savetrans[0];
+      vt->trans[1] = vt->savetrans[1];
 #endif
-      vt_win->color = savecol; /* HACK should use mc_wsetfgcol etc */
-      mc_wsetattr(vt_win, saveattr);
-      mc_wlocate(vt_win, savex, savey);
+      vt->win->color = vt->savecol; /* HACK should use mc_wsetfgcol etc */
+      mc_wsetattr(vt->win, vt->saveattr);
+      mc_wlocate(vt->win, vt->savex, vt->savey);
       break;
     case '=': /* Keypad into applications mode */
-      vt_keypad = APPL;
-      if (vt_keyb)
-        (*vt_keyb)(vt_keypad, vt_cursor);
+      vt->keypad = APPL;
+      if (vt->keyb)
+        (*vt->keyb)(vt->keypad, vt->cursor);
       break;
     case '>': /* Keypad into numeric mode */
-      vt_keypad = NORMAL;
-      if (vt_keyb)
-        (*vt_keyb)(vt_keypad, vt_cursor);
+      vt->keypad = NORMAL;
+      if (vt->keyb)
+        (*vt->keyb)(vt->keypad, vt->cursor);
       break;
     case 'Z': /* Report terminal type */
-      if (vt_type == VT100)
-        v_termout("\033[?1;0c", 0);
+      if (vt->type == VT100)
+        v_termout(vt, "\033[?1;0c", 0);
       else
-        v_termout("\033[?c", 0);
+        v_termout(vt, "\033[?c", 0);
       break;
     case 'c': /* Reset to initial state */
       f = XA_NORMAL;
-      mc_wsetattr(vt_win, f);
-      vt_win->wrap = (vt_type != VT100);
-      if (vt_wrap != -1)
-        vt_win->wrap = vt_wrap;
-      vt_crlf = vt_insert = 0;
-      vt_init(vt_type, vt_fg, vt_bg, vt_win->wrap, 0, 0);
-      mc_wlocate(vt_win, 0, 0);
+      mc_wsetattr(vt->win, f);
+      vt->win->wrap = (vt->type != VT100);
+      if (vt->wrap != -1)
+        vt->win->wrap = vt->wrap;
+      vt->crlf = vt->insert = 0;
+      vte_init(vt, vt->type, vt->fg, vt->bg, vt->win->wrap, 0, 0);
+      mc_wlocate(vt->win, 0, 0);
       break;
     case 'H': /* Set tab in current position */
-      x = vt_win->curx;
+      x = vt->win->curx;
       if (x > 159)
         x = 159;
-      vt_tabs[x / 32] |= 1 << (x % 32);
+      vt->tabs[x / 32] |= 1 << (x % 32);
       break;
     case 'N': /* G2 character set for next character only*/
     case 'O': /* G3 "				"    */
@@ -392,51 +329,33 @@ static void state1(int c)
       /* ALL IGNORED */
       break;
   }
-  esc_s = 0;
 }
 
 /* ESC [ ... [hl] seen. */
-static void ansi_mode(int on_off)
+static void ansi_mode(struct vt *vt, int on_off)
 {
   int i;
 
-  for (i = 0; i <= ptr; i++) {
-    switch (escparms[i]) {
+  for (i = 0; i < vt->parser.nparams; i++) {
+    switch (vt->parser.params[i]) {
       case 4: /* Insert mode  */
-        vt_insert = on_off;
+        vt->insert = on_off;
         break;
       case 20: /* Return key mode */
-        vt_crlf = on_off;
+        vt->crlf = on_off;
         break;
     }
   }
 }
 
 /*
- * ESC [ ... was seen the last time. Process next character.
+ * ESC [ ... and a final character were seen.
  */
-static void state2(int c)
+static void csi_final(struct vt *vt, int c)
 {
   short x, y, attr, f;
   char temp[32];
-
-  /* See if a number follows */
-  if (c >= '0' && c <= '9') {
-    escparms[ptr] = 10*escparms[ptr] + c - '0';
-    return;
-  }
-  /* Separation between numbers ? */
-  if (c == ';') {
-    if (ptr < 15)
-      ptr++;
-    return;
-  }
-  /* ESC [ ? sequence */
-  if (escparms[0] == 0 && ptr == 0 && c == '?')
-    {
-      esc_s = 3;
-      return;
-    }
+  int *escparms = vt->parser.params;
 
   /* Process functions with zero, one, two or more arguments */
   switch (c) {
@@ -446,120 +365,120 @@ static void state2(int c)
     case 'D': /* Cursor motion */
       if ((f = escparms[0]) == 0)
         f = 1;
-      x = vt_win->curx;
-      y = vt_win->cury;
+      x = vt->win->curx;
+      y = vt->win->cury;
       x += f * ((c == 'C') - (c == 'D'));
       if (x < 0)
         x = 0;
-      if (x >= vt_win->xs)
-        x = vt_win->xs - 1;
+      if (x >= vt->win->xs)
+        x = vt->win->xs - 1;
       if (c == 'B') { /* Down. */
         y += f;
-        if (y >= vt_win->ys)
-          y = vt_win->ys - 1;
-        if (y >= newy2 + 1)
-          y = newy2;
+        if (y >= vt->win->ys)
+          y = vt->win->ys - 1;
+        if (y >= vt->newy2 + 1)
+          y = vt->newy2;
       }
       if (c == 'A') { /* Up. */
         y -= f;
         if (y < 0)
           y = 0;
-        if (y <= newy1 - 1)
-          y = newy1;
+        if (y <= vt->newy1 - 1)
+          y = vt->newy1;
       }
-      mc_wlocate(vt_win, x, y);
+      mc_wlocate(vt->win, x, y);
       break;
     case 'X': /* Character erasing (ECH) */
       if ((f = escparms[0]) == 0)
         f = 1;
-      mc_wclrch(vt_win, f);
+      mc_wclrch(vt->win, f);
       break;
     case 'K': /* Line erasing */
       switch (escparms[0]) {
         case 0:
-          mc_wclreol(vt_win);
+          mc_wclreol(vt->win);
           break;
         case 1:
-          mc_wclrbol(vt_win);
+          mc_wclrbol(vt->win);
           break;
         case 2:
-          mc_wclrel(vt_win);
+          mc_wclrel(vt->win);
           break;
       }
       break;
     case 'J': /* Screen erasing */
-      x = vt_win->color;
-      y = vt_win->attr;
-      if (vt_type == ANSI) {
-        mc_wsetattr(vt_win, XA_NORMAL);
-        mc_wsetfgcol(vt_win, WHITE);
-        mc_wsetbgcol(vt_win, BLACK);
+      x = vt->win->color;
+      y = vt->win->attr;
+      if (vt->type == ANSI) {
+        mc_wsetattr(vt->win, XA_NORMAL);
+        mc_wsetfgcol(vt->win, WHITE);
+        mc_wsetbgcol(vt->win, BLACK);
       }
       switch (escparms[0]) {
         case 0:
-          mc_wclreos(vt_win);
+          mc_wclreos(vt->win);
           break;
         case 1:
-          mc_wclrbos(vt_win);
+          mc_wclrbos(vt->win);
           break;
         case 2:
-          mc_winclr(vt_win);
+          mc_winclr(vt->win);
           break;
       }
-      if (vt_type == ANSI) {
-        vt_win->color = x;
-        vt_win->attr = y;
+      if (vt->type == ANSI) {
+        vt->win->color = x;
+        vt->win->attr = y;
       }
       break;
     case 'n': /* Requests / Reports */
       switch(escparms[0]) {
         case 5: /* Status */
-          v_termout("\033[0n", 0);
+          v_termout(vt, "\033[0n", 0);
           break;
         case 6:	/* Cursor Position */
-          sprintf(temp, "\033[%d;%dR", vt_win->cury + 1, vt_win->curx + 1);
-          v_termout(temp, 0);
+          sprintf(temp, "\033[%d;%dR", vt->win->cury + 1, vt->win->curx + 1);
+          v_termout(vt, temp, 0);
           break;
       }
       break;
     case 'c': /* Identify Terminal Type */
-      if (vt_type == VT100) {
-        v_termout("\033[?1;2c", 0);
+      if (vt->type == VT100) {
+        v_termout(vt, "\033[?1;2c", 0);
         break;
       }
-      v_termout("\033[?c", 0);
+      v_termout(vt, "\033[?c", 0);
       break;
     case 'x': /* Request terminal parameters. */
       /* Always answers 19200-8N1 no options. */
       sprintf(temp, "\033[%c;1;1;120;120;1;0x", escparms[0] == 1 ? '3' : '2');
-      v_termout(temp, 0);
+      v_termout(vt, temp, 0);
       break;
     case 's': /* Save attributes and cursor position */
-      savex = vt_win->curx;
-      savey = vt_win->cury;
-      saveattr = vt_win->attr;
-      savecol = vt_win->color;
+      vt->savex = vt->win->curx;
+      vt->savey = vt->win->cury;
+      vt->saveattr = vt->win->attr;
+      vt->savecol = vt->win->color;
 #if TRANSLATE
-      savecharset = vt_charset;
-      savetrans[0] = vt_trans[0];
-      savetrans[1] = vt_trans[1];
+      vt->savecharset = vt->charset;
+      vt->savetrans[0] = vt->trans[0];
+      vt->savetrans[1] = vt->trans[1];
 #endif
       break;
     case 'u': /* Restore them */
 #if TRANSLATE
-      vt_charset = savecharset;
-      vt_trans[0] = savetrans[0];
-      vt_trans[1] = savetrans[1];
+      vt->charset = vt->savecharset;
+      vt->trans[0] = vt->savetrans[0];
+      vt->trans[1] = vt->savetrans[1];
 #endif
-      vt_win->color = savecol; /* HACK should use mc_wsetfgcol etc */
-      mc_wsetattr(vt_win, saveattr);
-      mc_wlocate(vt_win, savex, savey);
+      vt->win->color = vt->savecol; /* HACK should use mc_wsetfgcol etc */
+      mc_wsetattr(vt->win, vt->saveattr);
+      mc_wlocate(vt->win, vt->savex, vt->savey);
       break;
     case 'h':
-      ansi_mode(1);
+      ansi_mode(vt, 1);
       break;
     case 'l':
-      ansi_mode(0);
+      ansi_mode(vt, 0);
       break;
     case 'H':
     case 'f': /* Set cursor position */
@@ -567,33 +486,33 @@ static void state2(int c)
         y = 1;
       if ((x = escparms[1]) == 0)
         x = 1;
-      if (vt_om)
-        y += newy1;
-      mc_wlocate(vt_win, x - 1, y - 1);
+      if (vt->om)
+        y += vt->newy1;
+      mc_wlocate(vt->win, x - 1, y - 1);
       break;
     case 'g': /* Clear tab stop(s) */
       if (escparms[0] == 0) {
-        x = vt_win->curx;
+        x = vt->win->curx;
         if (x > 159)
           x = 159;
-        vt_tabs[x / 32] &= ~(1 << x % 32);
+        vt->tabs[x / 32] &= ~(1 << x % 32);
       }
       if (escparms[0] == 3)
         for(x = 0; x < 5; x++)
-          vt_tabs[x] = 0;
+          vt->tabs[x] = 0;
       break;
     case 'm': /* Set attributes */
-      attr = mc_wgetattr((vt_win));
-      for (f = 0; f <= ptr; f++) {
+      attr = mc_wgetattr((vt->win));
+      for (f = 0; f < vt->parser.nparams; f++) {
         if (escparms[f] >= 30 && escparms[f] <= 37)
-          mc_wsetfgcol(vt_win, escparms[f] - 30);
+          mc_wsetfgcol(vt->win, escparms[f] - 30);
         if (escparms[f] >= 40 && escparms[f] <= 47)
-          mc_wsetbgcol(vt_win, escparms[f] - 40);
+          mc_wsetbgcol(vt->win, escparms[f] - 40);
         switch (escparms[f]) {
           case 0:
             attr = XA_NORMAL;
-            mc_wsetfgcol(vt_win, vt_fg);
-            mc_wsetbgcol(vt_win, vt_bg);
+            mc_wsetfgcol(vt->win, vt->fg);
+            mc_wsetbgcol(vt->win, vt->bg);
             break;
           case 1:
             attr |= XA_BOLD;
@@ -620,59 +539,59 @@ static void state2(int c)
             attr &= ~XA_REVERSE;
             break;
           case 39: /* Default fg color */
-            mc_wsetfgcol(vt_win, vt_fg);
+            mc_wsetfgcol(vt->win, vt->fg);
             break;
           case 49: /* Default bg color */
-            mc_wsetbgcol(vt_win, vt_bg);
+            mc_wsetbgcol(vt->win, vt->bg);
             break;
         }
       }
-      mc_wsetattr(vt_win, attr);
+      mc_wsetattr(vt->win, attr);
       break;
     case 'L': /* Insert lines */
       if ((x = escparms[0]) == 0)
         x = 1;
       for (f = 0; f < x; f++)
-        mc_winsline(vt_win);
+        mc_winsline(vt->win);
       break;
     case 'M': /* Delete lines */
       if ((x = escparms[0]) == 0)
         x = 1;
       for (f = 0; f < x; f++)
-        mc_wdelline(vt_win);
+        mc_wdelline(vt->win);
       break;
     case 'P': /* Delete Characters */
       if ((x = escparms[0]) == 0)
         x = 1;
       for (f = 0; f < x; f++)
-        mc_wdelchar(vt_win);
+        mc_wdelchar(vt->win);
       break;
     case '@': /* Insert Characters */
       if ((x = escparms[0]) == 0)
         x = 1;
       for (f = 0; f < x; f++)
-        mc_winschar(vt_win);
+        mc_winschar(vt->win);
       break;
     case 'r': /* Set scroll region */
-      if ((newy1 = escparms[0]) == 0)
-        newy1 = 1;
-      if ((newy2 = escparms[1]) == 0)
-        newy2 = vt_win->ys;
-      newy1-- ; newy2--;
-      if (newy1 < 0)
-        newy1 = 0;
-      if (newy2 < 0)
-        newy2 = 0;
-      if (newy1 >= vt_win->ys)
-        newy1 = vt_win->ys - 1;
-      if (newy2 >= vt_win->ys)
-        newy2 = vt_win->ys - 1;
-      if (newy1 >= newy2) {
-        newy1 = 0;
-        newy2 = vt_win->ys - 1;
+      if ((vt->newy1 = escparms[0]) == 0)
+        vt->newy1 = 1;
+      if ((vt->newy2 = escparms[1]) == 0)
+        vt->newy2 = vt->win->ys;
+      vt->newy1-- ; vt->newy2--;
+      if (vt->newy1 < 0)
+        vt->newy1 = 0;
+      if (vt->newy2 < 0)
+        vt->newy2 = 0;
+      if (vt->newy1 >= vt->win->ys)
+        vt->newy1 = vt->win->ys - 1;
+      if (vt->newy2 >= vt->win->ys)
+        vt->newy2 = vt->win->ys - 1;
+      if (vt->newy1 >= vt->newy2) {
+        vt->newy1 = 0;
+        vt->newy2 = vt->win->ys - 1;
       }
-      mc_wsetregion(vt_win, newy1, newy2);
-      mc_wlocate(vt_win, 0, newy1);
+      mc_wsetregion(vt->win, vt->newy1, vt->newy2);
+      mc_wlocate(vt->win, 0, vt->newy1);
       break;
     case 'i': /* Printing */
     case 'y': /* Self test modes */
@@ -680,34 +599,29 @@ static void state2(int c)
       /* IGNORED */
       break;
   }
-  /* Ok, our escape sequence is all done */
-  esc_s = 0;
-  ptr = 0;
-  memset(escparms, 0, sizeof(escparms));
-  return;
 }
 
 /* ESC [? ... [hl] seen. */
-static void dec_mode(int on_off)
+static void dec_mode(struct vt *vt, int on_off)
 {
   int i;
 
-  for (i = 0; i <= ptr; i++) {
-    switch (escparms[i]) {
+  for (i = 0; i < vt->parser.nparams; i++) {
+    switch (vt->parser.params[i]) {
       case 1: /* Cursor keys in cursor/appl mode */
-        vt_cursor = on_off ? APPL : NORMAL;
-        if (vt_keyb)
-          (*vt_keyb)(vt_keypad, vt_cursor);
+        vt->cursor = on_off ? APPL : NORMAL;
+        if (vt->keyb)
+          (*vt->keyb)(vt->keypad, vt->cursor);
         break;
       case 6: /* Origin mode. */
-        vt_om = on_off;
-        mc_wlocate(vt_win, 0, newy1);
+        vt->om = on_off;
+        mc_wlocate(vt->win, 0, vt->newy1);
         break;
       case 7: /* Auto wrap */
-        vt_win->wrap = on_off;
+        vt->win->wrap = on_off;
         break;
       case 25: /* Cursor on/off */
-        mc_wcursor(vt_win, on_off ? CNORMAL : CNONE);
+        mc_wcursor(vt->win, on_off ? CNORMAL : CNONE);
         break;
       case 67: /* Backspace key sends. (FIXME: vt420) */
         /* setbackspace(on_off ? 8 : 127); */
@@ -720,21 +634,16 @@ static void dec_mode(int on_off)
 }
 
 /*
- * ESC [ ? ... seen.
+ * ESC [ ? ... and a final character were seen.
  */
-static void state3(int c)
+static void dec_final(struct vt *vt, int c)
 {
-  /* See if a number follows */
-  if (c >= '0' && c <= '9') {
-    escparms[ptr] = 10*escparms[ptr] + c - '0';
-    return;
-  }
   switch (c) {
     case 'h':
-      dec_mode(1);
+      dec_mode(vt, 1);
       break;
     case 'l':
-      dec_mode(0);
+      dec_mode(vt, 0);
       break;
     case 'i': /* Printing */
     case 'n': /* Request printer status */
@@ -742,64 +651,36 @@ static void state3(int c)
       /* IGNORED */
       break;
   }
-  esc_s = 0;
-  ptr = 0;
-  memset(escparms, 0, sizeof(escparms));
-  return;
 }
 
 /*
- * ESC ( Seen.
+ * ESC ( or ESC ) and a final character were seen.
  */
-static void state4(int c)
+static void esc_charset(struct vt *vt, int g, int c)
 {
   /* Switch Character Sets. */
 #if !TRANSLATE
   /* IGNORED */
+  (void)g;
   (void)c;
 #else
   switch (c) {
     case 'A':
     case 'B':
-      vt_trans[0] = vt_map[0];
+      vt->trans[g] = vt_map[0];
       break;
     case '0':
     case 'O':
-      vt_trans[0] = vt_map[1];
-      break;
-  }
-#endif
-  esc_s = 0;
-}
-
-/*
- * ESC ) Seen.
- */
-static void state5(int c)
-{
-  /* Switch Character Sets. */
-#if !TRANSLATE
-  /* IGNORED */
-  (void)c;
-#else
-  switch (c) {
-    case 'A':
-    case 'B':
-      vt_trans[1] = vt_map[0];
-      break;
-    case 'O':
-    case '0':
-      vt_trans[1] = vt_map[1];
+      vt->trans[g] = vt_map[1];
       break;
   }
 #endif
-  esc_s = 0;
 }
 
 /*
- * ESC # Seen.
+ * ESC # and a final character were seen.
  */
-static void state6(int c)
+static void esc_hash(struct vt *vt, int c)
 {
   int x, y;
 
@@ -807,168 +688,118 @@ static void state6(int c)
   switch (c) {
     case '8':
       /* Selftest: fill screen with E's */
-      vt_win->doscroll = 0;
-      vt_win->direct = 0;
-      mc_wlocate(vt_win, 0, 0);
-      for (y = 0; y < vt_win->ys; y++) {
-        mc_wlocate(vt_win, 0, y);
-        for (x = 0; x < vt_win->xs; x++)
-          mc_wputc(vt_win, 'E');
+      vt->win->doscroll = 0;
+      vt->win->direct = 0;
+      mc_wlocate(vt->win, 0, 0);
+      for (y = 0; y < vt->win->ys; y++) {
+        mc_wlocate(vt->win, 0, y);
+        for (x = 0; x < vt->win->xs; x++)
+          mc_wputc(vt->win, 'E');
       }
-      mc_wlocate(vt_win, 0, 0);
-      vt_win->doscroll = 1;
-      mc_wredraw(vt_win, 1);
+      mc_wlocate(vt->win, 0, 0);
+      vt->win->doscroll = 1;
+      mc_wredraw(vt->win, 1);
       break;
     default:
       /* IGNORED */
       break;
   }
-  esc_s = 0;
 }
 
 /*
- * ESC P Seen.
+ * ESC P ... ESC \ was seen.
  */
-static void state7(int c)
+static void dcs_string(struct vt *vt)
 {
   /*
    * Device dependant control strings. The Minix virtual console package
    * uses these sequences. We can only turn cursor on or off, because
    * that's the only one supported in termcap. The rest is ignored.
+   * The parser sees the first letter as the final character.
    */
-  static char buf[17];
-  static int pos = 0;
-  static int state = 0;
+  char buf[VTP_MAXSTR + 2];
 
-  if (c == ESC) {
-    state = 1;
+  if (vt->parser.ninter || vt->parser.nparams > 1 || vt->parser.params[0])
     return;
+  snprintf(buf, sizeof(buf), "%c%s", vt->parser.final, vt->parser.str);
+  if (!strcmp(buf, "cursor.on"))
+    mc_wcursor(vt->win, CNORMAL);
+  if (!strcmp(buf, "cursor.off"))
+    mc_wcursor(vt->win, CNONE);
+  if (!strcmp(buf, "linewrap.on")) {
+    vt->wrap = -1;
+    vt->win->wrap = 1;
   }
-  if (state == 1) {
-    buf[pos] = 0;
-    pos = 0;
-    state = 0;
-    esc_s = 0;
-    if (c != '\\')
-      return;
-    /* Process string here! */
-    if (!strcmp(buf, "cursor.on"))
-      mc_wcursor(vt_win, CNORMAL);
-    if (!strcmp(buf, "cursor.off"))
-      mc_wcursor(vt_win, CNONE);
-    if (!strcmp(buf, "linewrap.on")) {
-      vt_wrap = -1;
-      vt_win->wrap = 1;
-    }
-    if (!strcmp(buf, "linewrap.off")) {
-      vt_wrap = -1;
-      vt_win->wrap = 0;
-    }
-    return;
+  if (!strcmp(buf, "linewrap.off")) {
+    vt->wrap = -1;
+    vt->win->wrap = 0;
   }
-  if (pos > 15)
-    return;
-  buf[pos++] = c;
 }
 
-static void output_s(const char *s)
+/* Send characters to the capture file. */
+static void capture(struct vt *vt, const char *s, int len)
 {
-  mc_wputs(vt_win, s);
-  if (vt_docap == 1)
-    fputs(s, capfp);
+  if (vt->capture)
+    (*vt->capture)(s, len);
 }
 
-static void output_c(const char c)
+static void capture_c(struct vt *vt, int c)
 {
-  mc_wputc(vt_win, c);
-  if (vt_docap == 1)
-    fputc(c, capfp);
+  char ch = c;
+
+  capture(vt, &ch, 1);
 }
 
-void vt_out(int ch)
+static void output_s(struct vt *vt, const char *s)
 {
-  static unsigned char last_ch;
-  int f;
-  unsigned char c;
-  int go_on = 0;
-  wchar_t wc;
-
-  if (!ch)
-    return;
-
-  if (last_ch == '\n'
-      && vt_line_timestamp != TIMESTAMP_LINE_OFF)
-    {
-      struct timeval tmstmp_now;
-      static time_t tmstmp_last;
-      char s[36];
-      struct tm tmstmp_tm;
-
-      gettimeofday(&tmstmp_now, NULL);
-      if ((   vt_line_timestamp == TIMESTAMP_LINE_PER_SECOND
-           && tmstmp_now.tv_sec != tmstmp_last)
-          || vt_line_timestamp == TIMESTAMP_LINE_SIMPLE
-          || vt_line_timestamp == TIMESTAMP_LINE_EXTENDED)
-        {
-          if (   localtime_r(&tmstmp_now.tv_sec, &tmstmp_tm)
-              && strftime(s, sizeof(s), "[%F %T", &tmstmp_tm))
-            {
-              output_s(s);
-              switch (vt_line_timestamp)
-                {
-                case TIMESTAMP_LINE_SIMPLE:
-                  output_s("] ");
-                  break;
-                case TIMESTAMP_LINE_EXTENDED:
-                  snprintf(s, sizeof(s), ".%03ld] ", tmstmp_now.tv_usec / 1000);
-                  output_s(s);
-                  break;
-                case TIMESTAMP_LINE_PER_SECOND:
-                  output_s("\r\n");
-                  break;
-                };
-            }
-          tmstmp_last = tmstmp_now.tv_sec;
-        }
-    }
+  mc_wputs(vt->win, s);
+  if (vt->docap == 1)
+    capture(vt, s, strlen(s));
+}
 
-  c = (unsigned char)ch;
-  last_ch = c;
+static void output_c(struct vt *vt, const char c)
+{
+  mc_wputc(vt->win, c);
+  if (vt->docap == 1)
+    capture_c(vt, c);
+}
 
-  if (vt_docap == 2) /* Literal. */
-    fputc(c, capfp);
+/*
+ * Execute a control character.
+ * Returns 0 if it is not one we know about.
+ */
+static int vt_control(struct vt *vt, unsigned char c)
+{
+  int f;
 
-  /* Process <31 chars first, even in an escape sequence. */
   switch (c) {
     case 5: /* AnswerBack for vt100's */
-      if (vt_type != VT100) {
-        go_on = 1;
-        break;
-      }
-      v_termout(P_ANSWERBACK, 0);
+      if (vt->type != VT100 || vt->answerback == NULL)
+        return 0;
+      v_termout(vt, vt->answerback, 0);
       break;
     case '\r': /* Carriage return */
-      mc_wputc(vt_win, c);
-      if (vt_addlf)
-        output_c('\n');
+      mc_wputc(vt->win, c);
+      if (vt->addlf)
+        output_c(vt, '\n');
       break;
     case '\t': /* Non - destructive TAB */
       /* Find next tab stop. */
-      for (f = vt_win->curx + 1; f < 160; f++)
-        if (vt_tabs[f / 32] & (1 << f % 32))
+      for (f = vt->win->curx + 1; f < 160; f++)
+        if (vt->tabs[f / 32] & (1 << f % 32))
           break;
-      if (f >= vt_win->xs)
-        f = vt_win->xs - 1;
-      mc_wlocate(vt_win, f, vt_win->cury);
-      if (vt_docap == 1)
-        fputc(c, capfp);
+      if (f >= vt->win->xs)
+        f = vt->win->xs - 1;
+      mc_wlocate(vt->win, f, vt->win->cury);
+      if (vt->docap == 1)
+        capture_c(vt, c);
       break;
     case 013: /* Old Minix: CTRL-K = up */
-      mc_wlocate(vt_win, vt_win->curx, vt_win->cury - 1);
+      mc_wlocate(vt->win, vt->win->curx, vt->win->cury - 1);
       break;
     case '\f': /* Form feed: clear screen. */
-      mc_winclr(vt_win);
-      mc_wlocate(vt_win, 0, 0);
+      mc_winclr(vt->win);
+      mc_wlocate(vt->win, 0, 0);
       break;
 #if !TRANSLATE
     case 14:
@@ -976,48 +807,95 @@ void vt_out(int ch)
       break;
 #else
     case 14:
-      vt_charset = 1;
+      vt->charset = 1;
       break;
     case 15:
-      vt_charset = 0;
+      vt->charset = 0;
       break;
 #endif
-    case 24:
-    case 26:  /* Cancel escape sequence. */
-      esc_s = 0;
-      break;
-    case ESC: /* Begin escape sequence */
-      esc_s = 1;
-      break;
-    case 128+ESC: /* Begin ESC [ sequence. */
-      esc_s = 2;
-      break;
     case '\n':
-      if(vt_addcr)
-        mc_wputc(vt_win, '\r');
-      output_c(c);
-	  break;
+      if(vt->addcr)
+        mc_wputc(vt->win, '\r');
+      output_c(vt, c);
+      break;
     case '\b':
     case 7: /* Bell */
-      output_c(c);
+      output_c(vt, c);
       break;
     default:
-      go_on = 1;
-      break;
+      return 0;
   }
-  if (!go_on)
+  return 1;
+}
+
+void vte_out(struct vt *vt, int ch)
+{
+  unsigned char c;
+  wchar_t wc;
+  int a;
+
+  if (!ch)
     return;
 
-  /* Now see which state we are in. */
-  switch (esc_s) {
-    case 0: /* Normal character */
-      if (vt_docap == 1)
-        fputc(P_CONVCAP[0] == 'Y' ? vt_inmap[c] : c, capfp);
+  if (vt->last_ch == '\n'
+      && vt->timestamp != TIMESTAMP_LINE_OFF)
+    {
+      struct timeval tmstmp_now;
+      char s[36];
+      struct tm tmstmp_tm;
+
+      gettimeofday(&tmstmp_now, NULL);
+      if ((   vt->timestamp == TIMESTAMP_LINE_PER_SECOND
+           && tmstmp_now.tv_sec != vt->last_stamp)
+          || vt->timestamp == TIMESTAMP_LINE_SIMPLE
+          || vt->timestamp == TIMESTAMP_LINE_EXTENDED)
+        {
+          if (   localtime_r(&tmstmp_now.tv_sec, &tmstmp_tm)
+              && strftime(s, sizeof(s), "[%F %T", &tmstmp_tm))
+            {
+              output_s(vt, s);
+              switch (vt->timestamp)
+                {
+                case TIMESTAMP_LINE_SIMPLE:
+                  output_s(vt, "] ");
+                  break;
+                case TIMESTAMP_LINE_EXTENDED:
+                  snprintf(s, sizeof(s), ".%03ld] ", tmstmp_now.tv_usec / 1000);
+                  output_s(vt, s);
+                  break;
+                case TIMESTAMP_LINE_PER_SECOND:
+                  output_s(vt, "\r\n");
+                  break;
+                };
+            }
+          vt->last_stamp = tmstmp_now.tv_sec;
+        }
+    }
+
+  c = (unsigned char)ch;
+  vt->last_ch = c;
+
+  if (vt->docap == 2) /* Literal. */
+    capture_c(vt, c);
+
+  a = vtp_feed(&vt->parser, c);
+  if (a == VTP_ESC || a == VTP_CSI || a == VTP_DCS)
+    PROBE3(escape, a == VTP_ESC ? 'E' : a == VTP_CSI ? '[' : 'P',
+           vt->parser.final, vt->parser.ninter ? vt->parser.inter[0] : 0);
+  switch (a) {
+    case VTP_EXECUTE:
+      /* Unknown control characters are shown, unless in a sequence. */
+      if (vt_control(vt, c) || !vtp_ground(&vt->parser))
+        return;
+      /*FALLTHRU*/
+    case VTP_PRINT: /* Normal character */
+      if (vt->docap == 1)
+        capture_c(vt, vt->mapcap ? vt_inmap[c] : c);
       if (!using_iconv()) {
         c = vt_inmap[c];    /* conversion 04.09.97 / jl */
 #if TRANSLATE
-        if (vt_type == VT100 && vt_trans[vt_charset] && vt_asis == 0)
-          c = vt_trans[vt_charset][c];
+        if (vt->type == VT100 && vt->trans[vt->charset] && vt->asis == 0)
+          c = vt->trans[vt->charset][c];
 #endif
       }
       /* FIXME: This is wrong, but making it right would require
@@ -1027,45 +905,92 @@ void vt_out(int ch)
        * of getting it right anyway. */
       if (!using_iconv()) {
         one_mbtowc (&wc, (char *)&c, 1); /* returns 1 */
-        if (vt_insert)
-          mc_winschar2(vt_win, wc, 1);
+        if (vt->insert)
+          mc_winschar2(vt->win, wc, 1);
         else
-          mc_wputc(vt_win, wc);
+          mc_wputc(vt->win, wc);
       } else {
-        mc_wputc(vt_win, c);
+        mc_wputc(vt->win, c);
       }
       break;
-    case 1: /* ESC seen */
-      state1(c);
-      break;
-    case 2: /* ESC [ ... seen */
-      state2(c);
-      break;
-    case 3:
-      state3(c);
+    case VTP_ESC:
+      if (vt->parser.ninter == 0)
+        esc_final(vt, vt->parser.final);
+      else if (vt->parser.ninter == 1 && vt->parser.inter[0] == '(')
+        esc_charset(vt, 0, vt->parser.final);
+      else if (vt->parser.ninter == 1 && vt->parser.inter[0] == ')')
+        esc_charset(vt, 1, vt->parser.final);
+      else if (vt->parser.ninter == 1 && vt->parser.inter[0] == '#')
+        esc_hash(vt, vt->parser.final);
       break;
-    case 4:
-      state4(c);
+    case VTP_CSI:
+      if (vt->parser.ninter == 0)
+        csi_final(vt, vt->parser.final);
+      else if (vt->parser.ninter == 1 && vt->parser.inter[0] == '?')
+        dec_final(vt, vt->parser.final);
       break;
-    case 5:
-      state5(c);
-      break;
-    case 6:
-      state6(c);
-      break;
-    case 7:
-      state7(c);
+    case VTP_DCS:
+      dcs_string(vt);
       break;
   }
+}
 
-  /* Flush output to capture file so that all output is visible there
-   * immediately. Causes a write syscall for every call though. */
-  if (capfp)
-    fflush(capfp);
+/*
+ * Output a buffer of characters to the screen.
+ * Runs of printable ASCII in the normal state are put on the screen
+ * in one go; everything else goes through vte_out() one by one.
+ */
+void vte_out_buf(struct vt *vt, const char *s, size_t len)
+{
+  char run[256];
+  size_t n, i;
+  unsigned char c;
+
+  while (len > 0) {
+    /* Line timestamps and insert mode need the slow path. */
+    if (!vtp_ground(&vt->parser) || vt->insert ||
+        (vt->last_ch == '\n' && vt->timestamp != TIMESTAMP_LINE_OFF)) {
+      vte_out(vt, (unsigned char)*s++);
+      len--;
+      continue;
+    }
+
+    for (n = 0; n < len && n < sizeof(run); n++) {
+      c = s[n];
+      if (c < 32 || c > 126)
+        break;
+      if (!using_iconv()) {
+        c = vt_inmap[c];
+#if TRANSLATE
+        if (vt->type == VT100 && vt->trans[vt->charset] && vt->asis == 0)
+          c = vt->trans[vt->charset][c];
+#endif
+        if (c < 32 || c > 126)
+          break;
+      }
+      run[n] = c;
+    }
+    if (n == 0) {
+      vte_out(vt, (unsigned char)*s++);
+      len--;
+      continue;
+    }
+
+    if (vt->docap == 2 || (vt->docap == 1 && !vt->mapcap))
+      capture(vt, s, n);
+    else if (vt->docap == 1)
+      for (i = 0; i < n; i++)
+        capture_c(vt, vt_inmap[(unsigned char)s[i]]);
+    mc_wputsn(vt->win, run, n);
+
+    vt->last_ch = s[n - 1];
+    s += n;
+    len -= n;
+  }
 }
 
 /* Translate keycode to escape sequence. */
-void vt_send(int c)
+void vte_send(struct vt *vt, int c)
 {
   char s[3];
   int f;
@@ -1075,18 +1000,16 @@ void vt_send(int c)
   if (c < 256) {
     /* Translate backspace key? */
     if (c == K_ERA)
-      c = vt_bs;
+      c = vt->bs;
     s[0] = vt_outmap[c];  /* conversion 04.09.97 / jl */
     s[1] = 0;
     /* CR/LF mode? */
-    if (c == '\r' && vt_crlf) {
+    if (c == '\r' && vt->crlf) {
       s[1] = '\n';
       s[2] = 0;
       len = 2;
     }
-    v_termout(s, len);
-    if (vt_nl_delay > 0 && c == '\r')
-      usleep(1000 * vt_nl_delay);
+    v_termout(vt, s, len);
     return;
   }
 
@@ -1098,12 +1021,12 @@ void vt_send(int c)
     return;
 
   /* Now send appropriate escape code. */
-  v_termout("\033", 0);
-  if (vt_type == VT100) {
-    if (vt_cursor == NORMAL)
-      v_termout(vt_keys[f].vt100_st, 0);
+  v_termout(vt, "\033", 0);
+  if (vt->type == VT100) {
+    if (vt->cursor == NORMAL)
+      v_termout(vt, vt_keys[f].vt100_st, 0);
     else
-      v_termout(vt_keys[f].vt100_app, 0);
+      v_termout(vt, vt_keys[f].vt100_app, 0);
   } else
-    v_termout(vt_keys[f].ansi, 0);
+    v_termout(vt, vt_keys[f].ansi, 0);
 }
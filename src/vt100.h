@@ -18,6 +18,8 @@
 #ifndef __MINICOM__SRC__VT100_H__
 #define __MINICOM__SRC__VT100_H__
 #include <stdio.h>
+#include <time.h>
+#include "vtparse.h"
 
 /* Keypad and cursor key modes. */
 #define NORMAL	1
@@ -27,15 +29,80 @@
 #define VT100	1
 #define ANSI	3
 
-extern int vt_nl_delay;		/* Delay after CR key */
-extern int vt_ch_delay;		/* Delay after each character */
+/*
+ * One emulator. It draws in its own window, so there can be more
+ * than one. The emulator, the parser and the window code are built
+ * as libvt.a; a program using it provides setcbreak(), getrowcols(),
+ * wxgetch() and using_iconv() (see vthost.c).
+ */
+struct vt {
+  WIN *win;			/* Output window. */
+  struct vtparse parser;	/* Escape sequence parser. */
+  int type;			/* Terminal type. */
+  int echo;			/* Local echo on/off. */
+  int wrap;			/* Line wrap on/off */
+  int addlf;			/* Add linefeed on/off */
+  int addcr;			/* Add carriagereturn on/off */
+  int fg;			/* Standard foreground color. */
+  int bg;			/* Standard background color. */
+  int keypad;			/* Keypad mode. */
+  int cursor;			/* cursor key mode. */
+  int asis;			/* 8bit clean mode. */
+  int timestamp;		/* Timestamp each line. */
+  int bs;			/* Code that backspace key sends. */
+  int insert;			/* Insert mode */
+  int crlf;			/* Return sends CR/LF */
+  int om;			/* Origin mode. */
+  int docap;			/* Capture on/off. */
+  int mapcap;			/* Capture with vt_inmap applied. */
+  unsigned char last_ch;	/* Last character passed to vte_out(). */
+  time_t last_stamp;		/* Second of the last line timestamp. */
+  long tabs[5];			/* Tab stops for max. 32*5 = 160 columns. */
+  short newy1, newy2;		/* Current size of scrolling region. */
+  short savex, savey, saveattr, savecol; /* Saved color and position */
+#if TRANSLATE
+  int charset;			/* Character set. */
+  char *trans[2];
+  short savecharset;
+  char *savetrans[2];
+#endif
+
+  /* Set by the program. */
+  void (*termout)(const char *, int);	/* Sends a string to the remote */
+  void (*keyb)(int, int);	/* Gets called for NORMAL/APPL switch. */
+  void (*capture)(const char *, int);	/* Writes to the capture file */
+  const char *answerback;	/* Sent on ENQ in VT100 mode */
+};
+
+/* What a struct vt starts as. */
+#define VT_INIT { .type = ANSI, .bs = 8, .newy2 = 23, \
+		  .saveattr = XA_NORMAL, .savecol = 112 }
 
 /* Prototypes from vt100.c */
-void vt_install(void(*)(const char *, int), void (*)(int, int), WIN *);
-void vt_init(int, int, int, int, int, int);
-void vt_pinit(WIN *, int, int);
-void vt_set(int, int, int, int, int, int, int, int, int);
-void vt_out(int);
-void vt_send(int ch);
+void vte_install(struct vt *, void(*)(const char *, int), void (*)(int, int), WIN *);
+void vte_init(struct vt *, int, int, int, int, int, int);
+void vte_pinit(struct vt *, WIN *, int, int);
+void vte_set(struct vt *, int, int, int, int, int, int, int, int, int);
+void vte_out(struct vt *, int);
+void vte_out_buf(struct vt *, const char *, size_t);
+void vte_send(struct vt *, int ch);
+
+/* Prototypes from vthost.c (vtbench and vtfuzz only) */
+int vthost_init(int cols, int rows);
+struct vt *vthost_new(int x1, int y1, int x2, int y2, int type);
+void vthost_free(struct vt *vt);
+
+/* The emulator in minicom's terminal window. */
+extern struct vt vt_std;
+
+#define vt_install(out, kb, win)	vte_install(&vt_std, out, kb, win)
+#define vt_init(type, fg, bg, wrap, lf, cr) \
+	vte_init(&vt_std, type, fg, bg, wrap, lf, cr)
+#define vt_pinit(win, fg, bg)		vte_pinit(&vt_std, win, fg, bg)
+#define vt_set(lf, wrap, cap, bs, echo, cursor, asis, ts, cr) \
+	vte_set(&vt_std, lf, wrap, cap, bs, echo, cursor, asis, ts, cr)
+#define vt_out(c)			vte_out(&vt_std, c)
+#define vt_out_buf(s, len)		vte_out_buf(&vt_std, s, len)
+#define vt_send(c)			vte_send(&vt_std, c)
 
 #endif /* ! __MINICOM__SRC__VT100_H__ */
@@ -0,0 +1,257 @@
+/*
+ * vtbench.c	Benchmark for the emulator alone.
+ *
+ *		Feeds generated data to emulators from libvt, without
+ *		minicom, a serial port or a terminal, and reports how
+ *		many MB a second they get through: plain text, escape
+ *		sequences, scrolling and insert mode. The screen is
+ *		brought up to date every 64 KB, as minicom does a few
+ *		times a second, but written to /dev/null.
+ *
+ *		Usage: vtbench [-s MB] [-n emulators]
+ *
+ *		With -n, that many emulators run side by side, each in
+ *		its own part of the screen, and take turns. Configured
+ *		with --enable-instrument, the time per stage follows.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+
+#define COLS_	80
+#define ROWS_	24
+#define CHUNK	4096		/* Bytes fed at a time */
+#define FRAME	65536		/* Bytes between screen updates */
+#define MAXVT	8
+
+struct workload {
+  const char *name;
+  void (*gen)(char *buf, long len);
+};
+
+static unsigned long seed;
+
+/* Same numbers every time. */
+static unsigned long rnd(void)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) & 0x7fff;
+}
+
+static const char *words[] = {
+  "usb", "device", "new", "high-speed", "using", "address", "eth0",
+  "link", "up", "full", "duplex", "mounted", "filesystem", "with",
+  "error", "timeout", "retrying", "ok", "done", "init", "probe", "of",
+};
+#define NWORDS	(int)(sizeof(words) / sizeof(words[0]))
+
+/* Copy s to buf at *pos, as far as it fits. */
+static void put(char *buf, long len, long *pos, const char *s, int n)
+{
+  if (n > len - *pos)
+    n = len - *pos;
+  memcpy(buf + *pos, s, n);
+  *pos += n;
+}
+
+/* A screen full of text, written from the top again and again. */
+static void gen_text(char *buf, long len)
+{
+  char line[128];
+  long pos = 0;
+  int n, y = 0;
+
+  while (pos < len) {
+    n = 0;
+    if (y++ % ROWS_ == 0)
+      n = sprintf(line, "\033[H");
+    while (n < 70)
+      n += sprintf(line + n, "%s ", words[rnd() % NWORDS]);
+    n += sprintf(line + n, "\r\n");
+    put(buf, len, &pos, line, n);
+  }
+}
+
+/* Cursor motion, colours, erasing: what full screen programs send. */
+static void gen_escape(char *buf, long len)
+{
+  char out[128];
+  long pos = 0;
+  int n;
+
+  while (pos < len) {
+    switch (rnd() % 6) {
+      case 0:
+        n = sprintf(out, "\033[%lu;%luH", rnd() % ROWS_ + 1,
+                    rnd() % COLS_ + 1);
+        break;
+      case 1:
+        n = sprintf(out, "\033[%lu;%lum", rnd() % 8 + 30, rnd() % 8 + 40);
+        break;
+      case 2:
+        n = sprintf(out, "\033[1;7m%s\033[0m", words[rnd() % NWORDS]);
+        break;
+      case 3:
+        n = sprintf(out, "\033[K");
+        break;
+      case 4:
+        n = sprintf(out, "\033[%luC\033[%luA", rnd() % 10, rnd() % 5);
+        break;
+      default:
+        n = sprintf(out, "%s", words[rnd() % NWORDS]);
+        break;
+    }
+    put(buf, len, &pos, out, n);
+  }
+}
+
+/* Lines at the bottom of the screen, and in a scrolling region. */
+static void gen_scroll(char *buf, long len)
+{
+  char line[128];
+  long pos = 0;
+  int n, i = 0;
+
+  while (pos < len) {
+    n = 0;
+    if (i % 200 == 0)
+      n = sprintf(line, "\033[r\033[%d;1H", ROWS_);
+    else if (i % 200 == 100)
+      n = sprintf(line, "\033[5;15r\033[15;1H");
+    i++;
+    n += sprintf(line + n, "%s %s %s\r\n", words[rnd() % NWORDS],
+                 words[rnd() % NWORDS], words[rnd() % NWORDS]);
+    put(buf, len, &pos, line, n);
+  }
+}
+
+/* Insert mode, so every character moves the rest of the line. */
+static void gen_insert(char *buf, long len)
+{
+  char out[128];
+  long pos = 0;
+  int n;
+
+  put(buf, len, &pos, "\033[4h", 4);
+  while (pos < len) {
+    n = sprintf(out, "\033[%lu;%luH%s", rnd() % ROWS_ + 1,
+                rnd() % 40 + 1, words[rnd() % NWORDS]);
+    put(buf, len, &pos, out, n);
+  }
+}
+
+static struct workload workloads[] = {
+  { "text",   gen_text },
+  { "escape", gen_escape },
+  { "scroll", gen_scroll },
+  { "insert", gen_insert },
+};
+#define NWORKLOADS	(int)(sizeof(workloads) / sizeof(workloads[0]))
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-s MB] [-n emulators]\n", prog);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  struct vt *vt[MAXVT];
+  long len = 16L * 1024 * 1024, pos, frame;
+  int c, i, j, n, nvt = 1, width;
+  double t0, t1;
+  char *data;
+  FILE *out;
+
+  while ((c = getopt(argc, argv, "s:n:")) != EOF) {
+    switch (c) {
+      case 's':
+        len = (long)(atof(optarg) * 1024 * 1024);
+        break;
+      case 'n':
+        nvt = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (optind < argc || len <= 0 || nvt < 1 || nvt > MAXVT)
+    usage(argv[0]);
+
+  /* The screen goes to /dev/null, the results to the real stdout. */
+  if ((out = fdopen(dup(1), "w")) == NULL ||
+      vthost_init(COLS_, ROWS_) < 0) {
+    fprintf(stderr, "%s: cannot set up the screen\n", argv[0]);
+    return 1;
+  }
+  width = COLS_ / nvt;
+  for (i = 0; i < nvt; i++)
+    if ((vt[i] = vthost_new(i * width, 0, (i + 1) * width - 1, ROWS_ - 1,
+                            VT100)) == NULL) {
+      fprintf(stderr, "%s: out of memory\n", argv[0]);
+      return 1;
+    }
+  if ((data = malloc(len)) == NULL) {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    return 1;
+  }
+
+  fprintf(out, "%-8s %6s %8s %8s   (%d emulator%s)\n", "workload", "MB",
+          "seconds", "MB/s", nvt, nvt > 1 ? "s" : "");
+  for (j = 0; j < NWORKLOADS; j++) {
+    seed = 1;
+    workloads[j].gen(data, len);
+    for (i = 0; i < nvt; i++)
+      vte_init(vt[i], VT100, WHITE, BLACK, 1, 0, 0);
+
+    t0 = now();
+    frame = 0;
+    for (pos = 0, i = 0; pos < len; pos += n, i = (i + 1) % nvt) {
+      INSTR_START(t);
+
+      n = len - pos > CHUNK ? CHUNK : len - pos;
+      vte_out_buf(vt[i], data + pos, n);
+      INSTR_END(IN_EMUL, t, n);
+      if ((frame += n) >= FRAME) {
+        mc_wflush();
+        frame = 0;
+      }
+    }
+    mc_wflush();
+    t1 = now();
+
+    fprintf(out, "%-8s %6.1f %8.3f %8.1f\n", workloads[j].name,
+            len / (1024.0 * 1024.0), t1 - t0,
+            len / (1024.0 * 1024.0) / (t1 - t0 > 0 ? t1 - t0 : 1e-6));
+    fflush(out);
+  }
+  instr_dump(out);
+
+  for (i = 0; i < nvt; i++)
+    vthost_free(vt[i]);
+  win_end();
+  free(data);
+  return 0;
+}
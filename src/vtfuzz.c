@@ -0,0 +1,175 @@
+/*
+ * vtfuzz.c	Fuzz target for the emulator.
+ *
+ *		Two emulators from libvt get the same input, one byte at
+ *		a time through vte_out() and one in pieces through
+ *		vte_out_buf(), which takes a faster path for plain text.
+ *		Afterwards both screens must be the same, or it aborts.
+ *		Crashes and memory errors are found on the way.
+ *
+ *		Usage: vtfuzz [file...]
+ *
+ *		Without files, standard input is used. Built with
+ *		CFLAGS="-fsanitize=fuzzer -DLIBFUZZER" this is a libFuzzer
+ *		target instead; the files in vtcorpus/ are a start for it.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+
+#define COLS_	80
+#define ROWS_	24
+
+static struct vt *one, *buf;
+static FILE *report;
+
+static int setup(void)
+{
+  if (one)
+    return 0;
+  if (vthost_init(COLS_, ROWS_) < 0 ||
+      (one = vthost_new(0, 0, COLS_ / 2 - 1, ROWS_ - 1, VT100)) == NULL ||
+      (buf = vthost_new(COLS_ / 2, 0, COLS_ - 1, ROWS_ - 1, VT100)) == NULL)
+    return -1;
+  return 0;
+}
+
+/* Both screens must look the same, cursor included. */
+static void compare(void)
+{
+  ELM *a, *b;
+  int x, y;
+
+  if (one->win->curx != buf->win->curx || one->win->cury != buf->win->cury
+      || one->win->attr != buf->win->attr
+      || one->win->color != buf->win->color) {
+    fprintf(report, "vtfuzz: cursor %d,%d attr %d color %d "
+            "but %d,%d attr %d color %d\n",
+            one->win->curx, one->win->cury, one->win->attr, one->win->color,
+            buf->win->curx, buf->win->cury, buf->win->attr, buf->win->color);
+    fflush(report);
+    abort();
+  }
+  for (y = 0; y < ROWS_; y++)
+    for (x = 0; x < COLS_ / 2; x++) {
+      a = mc_wgetelm(one->win, x, y);
+      b = mc_wgetelm(buf->win, x, y);
+      if (a->value != b->value || a->attr != b->attr || a->color != b->color) {
+        fprintf(report, "vtfuzz: cell %d,%d is %lx/%d/%d but %lx/%d/%d\n",
+                x, y, (unsigned long)a->value, a->attr, a->color,
+                (unsigned long)b->value, b->attr, b->color);
+        fflush(report);
+        abort();
+      }
+    }
+}
+
+/*
+ * Run one input. The sizes of the pieces for vte_out_buf() come
+ * from the input itself, so the fuzzer gets to choose them too.
+ */
+static void run(const unsigned char *data, size_t len)
+{
+  size_t i, n;
+
+  vte_init(one, VT100, WHITE, BLACK, 1, 0, 0);
+  vte_init(buf, VT100, WHITE, BLACK, 1, 0, 0);
+  mc_winclr(one->win);
+  mc_winclr(buf->win);
+
+  for (i = 0; i < len; i++)
+    vte_out(one, data[i]);
+  for (i = 0; i < len; i += n) {
+    n = data[i] % 64 + 1;
+    if (n > len - i)
+      n = len - i;
+    vte_out_buf(buf, (const char *)data + i, n);
+  }
+  compare();
+}
+
+#ifdef LIBFUZZER
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t len)
+{
+  if (report == NULL)
+    report = stderr;
+  if (setup() < 0)
+    abort();
+  run(data, len);
+  return 0;
+}
+#else
+/* Read all of a file, or of standard input. */
+static unsigned char *slurp(FILE *fp, size_t *len)
+{
+  unsigned char *data = NULL, *p;
+  size_t size = 0, n;
+
+  *len = 0;
+  do {
+    if (*len == size) {
+      size = size ? size * 2 : 4096;
+      if ((p = realloc(data, size)) == NULL) {
+        free(data);
+        return NULL;
+      }
+      data = p;
+    }
+    n = fread(data + *len, 1, size - *len, fp);
+    *len += n;
+  } while (n > 0);
+  return data;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned char *data;
+  size_t len;
+  FILE *fp;
+  int i;
+
+  /* The screen goes to /dev/null, the results to the real stdout. */
+  if ((report = fdopen(dup(1), "w")) == NULL || setup() < 0) {
+    fprintf(stderr, "%s: cannot set up the screen\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 1; i < argc || i == 1; i++) {
+    if (argc == 1)
+      fp = stdin;
+    else if ((fp = fopen(argv[i], "rb")) == NULL) {
+      fprintf(stderr, "%s: %s: %s\n", argv[0], argv[i], strerror(errno));
+      return 1;
+    }
+    if ((data = slurp(fp, &len)) == NULL) {
+      fprintf(stderr, "%s: out of memory\n", argv[0]);
+      return 1;
+    }
+    if (fp != stdin)
+      fclose(fp);
+    run(data, len);
+    fprintf(report, "%s: ok (%lu bytes)\n", argc == 1 ? "-" : argv[i],
+            (unsigned long)len);
+    free(data);
+  }
+
+  vthost_free(one);
+  vthost_free(buf);
+  win_end();
+  return 0;
+}
+#endif
@@ -0,0 +1,113 @@
+/*
+ * vthost.c	What libvt needs from the program using it, for the
+ *		programs that run the emulator without a terminal:
+ *		vtbench and vtfuzz.
+ *
+ *		The window code still writes the screen to standard
+ *		output, so vthost_init() sends that to /dev/null. The
+ *		terminal type is fixed to vt100 so that results do not
+ *		depend on where they were made.
+ *
+ *		Entry points:
+ *
+ *		vthost_init(cols, rows) - a screen of that size
+ *		vthost_new(x1, y1, x2, y2, type)
+ *		                        - an emulator in a new window
+ *		vthost_free(vt)         - close it again
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "minicom.h"
+
+static int host_rows, host_cols;
+
+/* What the emulator sends back to the remote side is dropped. */
+static void host_out(const char *s, int len)
+{
+  (void)s;
+  (void)len;
+}
+
+/* Functions the window code and the emulator expect the program to have. */
+int setcbreak(int mode)
+{
+  (void)mode;
+  return 0;
+}
+
+void getrowcols(int *rows, int *cols)
+{
+  *rows = host_rows;
+  *cols = host_cols;
+}
+
+int wxgetch(void)
+{
+  return EOF;
+}
+
+int using_iconv(void)
+{
+  return 0;
+}
+
+/*
+ * Set up a screen of cols x rows. Returns -1 if that fails.
+ */
+int vthost_init(int cols, int rows)
+{
+  int fd;
+
+  host_rows = rows;
+  host_cols = cols;
+  setenv("TERM", "vt100", 1);
+  fflush(stdout);
+  if ((fd = open("/dev/null", O_WRONLY)) < 0)
+    return -1;
+  dup2(fd, 1);
+  close(fd);
+  return win_init(WHITE, BLACK, XA_NORMAL);
+}
+
+/*
+ * A new emulator of the given type (VT100 or ANSI) in a window
+ * at x1, y1 - x2, y2. Returns NULL if there is not enough memory.
+ */
+struct vt *vthost_new(int x1, int y1, int x2, int y2, int type)
+{
+  static const struct vt init = VT_INIT;
+  struct vt *vt;
+  WIN *w;
+
+  if ((vt = malloc(sizeof(struct vt))) == NULL)
+    return NULL;
+  if ((w = mc_wopen(x1, y1, x2, y2, BNONE, XA_NORMAL, WHITE, BLACK,
+                    1, 0, 1)) == NULL) {
+    free(vt);
+    return NULL;
+  }
+  *vt = init;
+  vte_install(vt, host_out, NULL, w);
+  vte_init(vt, type, WHITE, BLACK, 1, 0, 0);
+  return vt;
+}
+
+void vthost_free(struct vt *vt)
+{
+  mc_wclose(vt->win, 0);
+  free(vt);
+}
@@ -0,0 +1,246 @@
+/*
+ * vtparse.c	Table driven parser for DEC/ANSI escape sequences.
+ *
+ *		The parser follows the state diagram of the DEC VT500
+ *		series: every byte is classified by one lookup in a
+ *		state x byte table that gives the action and the next
+ *		state. Complete ESC, CSI, DCS and OSC sequences are
+ *		reported to the caller once, with their parameters
+ *		collected in the vtparse struct.
+ *
+ *		This module does not know about the screen, so it can be
+ *		used and tested on its own.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "vtparse.h"
+
+/* Actions, kept in the upper nibble of a table entry. */
+#define A_NONE		VTP_NONE
+#define A_PRINT		VTP_PRINT
+#define A_EXECUTE	VTP_EXECUTE
+#define A_CLEAR		VTP_A_CLEAR	/* Start of CSI or DCS */
+#define A_COLLECT	4	/* Intermediate or private marker */
+#define A_PARAM		5	/* Digit or ';' */
+#define A_ESC		6	/* ESC sequence complete */
+#define A_CSI		7	/* CSI sequence complete */
+#define A_HOOK		8	/* DCS header complete, data follows */
+#define A_PUT		9	/* DCS data or OSC string byte */
+#define A_OSC		10	/* Start of OSC */
+#define A_STREND	11	/* DCS or OSC complete */
+
+#define T(act, next)	((unsigned char)(((act) << 4) | (next)))
+
+unsigned char vtp_table[VTP_NSTATES][256];
+static int vtp_table_done;
+
+static void set(int state, int lo, int hi, int act, int next)
+{
+  int c;
+
+  for (c = lo; c <= hi; c++)
+    vtp_table[state][c] = T(act, next);
+}
+
+/*
+ * Fill in the transition table.
+ */
+static void vtp_maketable(void)
+{
+  int s;
+
+  for (s = 0; s < VTP_NSTATES; s++) {
+    /* By default a byte is ignored and the state does not change. */
+    set(s, 0x00, 0xff, A_NONE, s);
+
+    /* Control characters are executed, even within a sequence. */
+    if (s <= VTP_CSI_IGNORE) {
+      set(s, 0x00, 0x17, A_EXECUTE, s);
+      set(s, 0x19, 0x19, A_EXECUTE, s);
+      set(s, 0x1c, 0x1f, A_EXECUTE, s);
+    }
+    /* Anything unexpected in the 8th bit set range ends a sequence. */
+    if (s != VTP_GROUND && s < VTP_DCS_PASS)
+      set(s, 0x80, 0xff, A_NONE, VTP_GROUND);
+
+    /* CAN and SUB cancel, ESC and CSI start a new sequence. */
+    set(s, 0x18, 0x18, A_NONE, VTP_GROUND);
+    set(s, 0x1a, 0x1a, A_NONE, VTP_GROUND);
+    set(s, 0x1b, 0x1b, A_NONE, VTP_ESCAPE);
+    if (s != VTP_DCS_PASS && s != VTP_OSC_STRING)
+      set(s, 0x9b, 0x9b, A_CLEAR, VTP_CSI_ENTRY);
+  }
+
+  /* Everything printable is printed, including DEL and 8 bit data. */
+  set(VTP_GROUND, 0x20, 0xff, A_PRINT, VTP_GROUND);
+  set(VTP_GROUND, 0x9b, 0x9b, A_CLEAR, VTP_CSI_ENTRY);
+
+  set(VTP_ESCAPE, 0x20, 0x2f, A_COLLECT, VTP_ESC_INTER);
+  set(VTP_ESCAPE, 0x30, 0x7e, A_ESC, VTP_GROUND);
+  set(VTP_ESCAPE, 'P', 'P', A_CLEAR, VTP_DCS_ENTRY);
+  set(VTP_ESCAPE, '[', '[', A_CLEAR, VTP_CSI_ENTRY);
+  set(VTP_ESCAPE, ']', ']', A_OSC, VTP_OSC_STRING);
+  set(VTP_ESCAPE, 'X', 'X', A_NONE, VTP_SOS_STRING);
+  set(VTP_ESCAPE, '^', '_', A_NONE, VTP_SOS_STRING);
+
+  set(VTP_ESC_INTER, 0x20, 0x2f, A_COLLECT, VTP_ESC_INTER);
+  set(VTP_ESC_INTER, 0x30, 0x7e, A_ESC, VTP_GROUND);
+
+  set(VTP_CSI_ENTRY, 0x20, 0x2f, A_COLLECT, VTP_CSI_INTER);
+  set(VTP_CSI_ENTRY, 0x30, 0x39, A_PARAM, VTP_CSI_PARAM);
+  set(VTP_CSI_ENTRY, 0x3a, 0x3a, A_NONE, VTP_CSI_IGNORE);
+  set(VTP_CSI_ENTRY, 0x3b, 0x3b, A_PARAM, VTP_CSI_PARAM);
+  set(VTP_CSI_ENTRY, 0x3c, 0x3f, A_COLLECT, VTP_CSI_PARAM);
+  set(VTP_CSI_ENTRY, 0x40, 0x7e, A_CSI, VTP_GROUND);
+
+  set(VTP_CSI_PARAM, 0x20, 0x2f, A_COLLECT, VTP_CSI_INTER);
+  set(VTP_CSI_PARAM, 0x30, 0x39, A_PARAM, VTP_CSI_PARAM);
+  set(VTP_CSI_PARAM, 0x3a, 0x3a, A_NONE, VTP_CSI_IGNORE);
+  set(VTP_CSI_PARAM, 0x3b, 0x3b, A_PARAM, VTP_CSI_PARAM);
+  set(VTP_CSI_PARAM, 0x3c, 0x3f, A_NONE, VTP_CSI_IGNORE);
+  set(VTP_CSI_PARAM, 0x40, 0x7e, A_CSI, VTP_GROUND);
+
+  set(VTP_CSI_INTER, 0x20, 0x2f, A_COLLECT, VTP_CSI_INTER);
+  set(VTP_CSI_INTER, 0x30, 0x3f, A_NONE, VTP_CSI_IGNORE);
+  set(VTP_CSI_INTER, 0x40, 0x7e, A_CSI, VTP_GROUND);
+
+  set(VTP_CSI_IGNORE, 0x40, 0x7e, A_NONE, VTP_GROUND);
+
+  set(VTP_DCS_ENTRY, 0x20, 0x2f, A_COLLECT, VTP_DCS_INTER);
+  set(VTP_DCS_ENTRY, 0x30, 0x39, A_PARAM, VTP_DCS_PARAM);
+  set(VTP_DCS_ENTRY, 0x3a, 0x3a, A_NONE, VTP_DCS_IGNORE);
+  set(VTP_DCS_ENTRY, 0x3b, 0x3b, A_PARAM, VTP_DCS_PARAM);
+  set(VTP_DCS_ENTRY, 0x3c, 0x3f, A_COLLECT, VTP_DCS_PARAM);
+  set(VTP_DCS_ENTRY, 0x40, 0x7e, A_HOOK, VTP_DCS_PASS);
+
+  set(VTP_DCS_PARAM, 0x20, 0x2f, A_COLLECT, VTP_DCS_INTER);
+  set(VTP_DCS_PARAM, 0x30, 0x39, A_PARAM, VTP_DCS_PARAM);
+  set(VTP_DCS_PARAM, 0x3a, 0x3a, A_NONE, VTP_DCS_IGNORE);
+  set(VTP_DCS_PARAM, 0x3b, 0x3b, A_PARAM, VTP_DCS_PARAM);
+  set(VTP_DCS_PARAM, 0x3c, 0x3f, A_NONE, VTP_DCS_IGNORE);
+  set(VTP_DCS_PARAM, 0x40, 0x7e, A_HOOK, VTP_DCS_PASS);
+
+  set(VTP_DCS_INTER, 0x20, 0x2f, A_COLLECT, VTP_DCS_INTER);
+  set(VTP_DCS_INTER, 0x30, 0x3f, A_NONE, VTP_DCS_IGNORE);
+  set(VTP_DCS_INTER, 0x40, 0x7e, A_HOOK, VTP_DCS_PASS);
+
+  /* Strings end with ESC (the start of ST), OSC also with BEL. */
+  set(VTP_DCS_PASS, 0x00, 0x17, A_PUT, VTP_DCS_PASS);
+  set(VTP_DCS_PASS, 0x19, 0x19, A_PUT, VTP_DCS_PASS);
+  set(VTP_DCS_PASS, 0x1c, 0x7e, A_PUT, VTP_DCS_PASS);
+  set(VTP_DCS_PASS, 0x80, 0xff, A_PUT, VTP_DCS_PASS);
+  set(VTP_DCS_PASS, 0x1b, 0x1b, A_STREND, VTP_ESCAPE);
+
+  set(VTP_OSC_STRING, 0x20, 0xff, A_PUT, VTP_OSC_STRING);
+  set(VTP_OSC_STRING, 0x7f, 0x7f, A_NONE, VTP_OSC_STRING);
+  set(VTP_OSC_STRING, 0x07, 0x07, A_STREND, VTP_GROUND);
+  set(VTP_OSC_STRING, 0x1b, 0x1b, A_STREND, VTP_ESCAPE);
+
+  vtp_table_done = 1;
+}
+
+/*
+ * Reset a parser to the ground state.
+ */
+void vtp_init(struct vtparse *p)
+{
+  if (!vtp_table_done)
+    vtp_maketable();
+
+  p->state = VTP_GROUND;
+  p->params[0] = 0;
+  p->nparams = 0;
+  p->inter[0] = 0;
+  p->ninter = 0;
+  p->final = 0;
+  p->str[0] = 0;
+  p->nstr = 0;
+}
+
+/*
+ * Make the collected parameters ready for the caller.
+ */
+static void vtp_finish(struct vtparse *p, int c)
+{
+  if (p->nparams == 0)
+    p->params[p->nparams++] = 0;
+  else if (p->nparams > VTP_MAXPARAMS)
+    p->nparams = VTP_MAXPARAMS;
+  if (p->nparams < 2)
+    p->params[1] = 0;
+  p->inter[p->ninter < VTP_MAXINTER ? p->ninter : VTP_MAXINTER] = 0;
+  p->final = c;
+}
+
+/*
+ * Do the action of table entry t for character c.
+ */
+int vtp_action(struct vtparse *p, int c, int t)
+{
+  int old = p->state;
+
+  p->state = t & 0x0f;
+
+  switch (t >> 4) {
+    case A_CLEAR:
+      p->nparams = 0;
+      p->ninter = 0;
+      break;
+    case A_COLLECT:
+      /* An ESC sequence does not clear, so do it on the first one. */
+      if (old == VTP_ESCAPE)
+        p->ninter = 0;
+      if (p->ninter < VTP_MAXINTER)
+        p->inter[p->ninter] = c;
+      if (p->ninter <= VTP_MAXINTER)
+        p->ninter++;
+      break;
+    case A_PARAM:
+      /* The slot after the last one swallows surplus parameters. */
+      if (p->nparams == 0)
+        p->params[p->nparams++] = 0;
+      if (c == ';') {
+        if (p->nparams <= VTP_MAXPARAMS)
+          p->nparams++;
+        p->params[p->nparams - 1] = 0;
+      } else if (p->params[p->nparams - 1] < 10000)
+        p->params[p->nparams - 1] = 10 * p->params[p->nparams - 1] + c - '0';
+      break;
+    case A_ESC:
+      if (old == VTP_ESCAPE)
+        p->ninter = 0;
+      vtp_finish(p, c);
+      return VTP_ESC;
+    case A_CSI:
+      vtp_finish(p, c);
+      return VTP_CSI;
+    case A_HOOK:
+      vtp_finish(p, c);
+      p->nstr = 0;
+      break;
+    case A_PUT:
+      if (p->nstr < VTP_MAXSTR)
+        p->str[p->nstr++] = c;
+      break;
+    case A_OSC:
+      p->nstr = 0;
+      break;
+    case A_STREND:
+      p->str[p->nstr] = 0;
+      return old == VTP_OSC_STRING ? VTP_OSC : VTP_DCS;
+  }
+  return VTP_NONE;
+}
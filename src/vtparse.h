@@ -0,0 +1,92 @@
+/*
+ * vtparse.h	Table driven parser for DEC/ANSI escape sequences.
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef __MINICOM__SRC__VTPARSE_H__
+#define __MINICOM__SRC__VTPARSE_H__
+
+#define VTP_MAXPARAMS	16	/* Numeric parameters kept per sequence */
+#define VTP_MAXINTER	2	/* Intermediate/private characters kept */
+#define VTP_MAXSTR	64	/* Bytes of a DCS/OSC string kept */
+
+/*
+ * What vtp_feed() found. Everything but VTP_PRINT and VTP_EXECUTE
+ * is reported once, when the whole sequence has been seen.
+ */
+#define VTP_NONE	0	/* Nothing to do (yet). */
+#define VTP_PRINT	1	/* Print the character. */
+#define VTP_EXECUTE	2	/* Execute the control character. */
+#define VTP_ESC		3	/* ESC [inter] final */
+#define VTP_CSI		4	/* CSI [private] params [inter] final */
+#define VTP_DCS		5	/* DCS [private] params [inter] final string */
+#define VTP_OSC		6	/* OSC string */
+
+/* Parser states. */
+#define VTP_GROUND	0
+#define VTP_ESCAPE	1
+#define VTP_ESC_INTER	2
+#define VTP_CSI_ENTRY	3
+#define VTP_CSI_PARAM	4
+#define VTP_CSI_INTER	5
+#define VTP_CSI_IGNORE	6
+#define VTP_DCS_ENTRY	7
+#define VTP_DCS_PARAM	8
+#define VTP_DCS_INTER	9
+#define VTP_DCS_PASS	10
+#define VTP_DCS_IGNORE	11
+#define VTP_OSC_STRING	12
+#define VTP_SOS_STRING	13	/* SOS, PM and APC: swallowed. */
+#define VTP_NSTATES	14
+
+struct vtparse {
+  int state;
+  int params[VTP_MAXPARAMS + 1];/* Numeric parameters, 0 if omitted */
+  int nparams;			/* How many, at least 1 for CSI and DCS */
+				/* (params[1] is 0 if there is just one) */
+  char inter[VTP_MAXINTER + 1];	/* Private marker and intermediates */
+  int ninter;			/* How many were seen (may exceed max) */
+  int final;			/* Final character of ESC/CSI/DCS */
+  char str[VTP_MAXSTR + 1];	/* DCS data or OSC string, 0 terminated */
+  int nstr;
+};
+
+/* Is the parser outside of any escape sequence? */
+#define vtp_ground(p)	((p)->state == VTP_GROUND)
+
+/*
+ * A table entry holds the action in the upper and the next state in
+ * the lower four bits. Actions below VTP_A_CLEAR are the return value
+ * of vtp_feed() as is; the others are done by vtp_action().
+ */
+#define VTP_A_CLEAR	3
+
+extern unsigned char vtp_table[VTP_NSTATES][256];
+
+void vtp_init(struct vtparse *p);
+int vtp_action(struct vtparse *p, int c, int t);
+
+/*
+ * Feed one byte to the parser and return what to do with it.
+ */
+static inline int vtp_feed(struct vtparse *p, int c)
+{
+  int t = vtp_table[p->state][c & 0xff];
+
+  if (t < (VTP_A_CLEAR << 4)) {
+    p->state = t & 0x0f;
+    return t >> 4;
+  }
+  return vtp_action(p, c & 0xff, t);
+}
+
+#endif /* ! __MINICOM__SRC__VTPARSE_H__ */
@@ -0,0 +1,281 @@
+/*
+ * vtpbench.c	Check and benchmark for the escape sequence parser.
+ *
+ *		Uses vtparse alone, without an emulator or a screen.
+ *		First known sequences are fed one at a time, and what
+ *		the parser reports is compared with what it should be.
+ *		Then random bytes, mostly ESC, CSI and parameters, are
+ *		fed to a parser with guard words around it, which must
+ *		never change. If any of that fails, it says so and
+ *		exits 1.
+ *
+ *		Last, the recorded streams in the files (or standard
+ *		input) are fed again and again, to make up -s MB, and it
+ *		reports how many MB a second and ns a byte the parser
+ *		gets through.
+ *
+ *		Usage: vtpbench [-s MB] [file...]
+ *
+ *		This file is part of the minicom communications package.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "port.h"
+#include "vtparse.h"
+
+#define GUARD		0x5a5a5a5a
+#define NGUARD		16
+#define RANDOM		(4L * 1024 * 1024)	/* Random bytes to feed */
+
+struct check {
+  const char *in;
+  int kind;		/* First ESC/CSI/DCS/OSC reported, or VTP_NONE */
+  int final;
+  int nparams;
+  int p0, p1;		/* params[0] and params[1] */
+  const char *inter;
+  const char *str;	/* DCS data or OSC string, NULL: do not check */
+};
+
+static struct check checks[] = {
+  { "\033[1;2H",	VTP_CSI, 'H', 2, 1, 2, "", NULL },
+  { "\033[H",		VTP_CSI, 'H', 1, 0, 0, "", NULL },
+  { "\033[;5H",		VTP_CSI, 'H', 2, 0, 5, "", NULL },
+  { "\033[?25l",	VTP_CSI, 'l', 1, 25, 0, "?", NULL },
+  { "\2331;2H",		VTP_CSI, 'H', 2, 1, 2, "", NULL },
+  { "\033[1\n2H",	VTP_CSI, 'H', 1, 12, 0, "", NULL },
+  { "\033[99999999m",	VTP_CSI, 'm', 1, 99999, 0, "", NULL },
+  { "\033[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17;18;19;20m",
+			VTP_CSI, 'm', 16, 1, 2, "", NULL },
+  { "\033[ !\"#p",	VTP_CSI, 'p', 1, 0, 0, " !", NULL },
+  { "\033(B",		VTP_ESC, 'B', 1, 0, 0, "(", NULL },
+  { "\0337",		VTP_ESC, '7', 1, 0, 0, "", NULL },
+  { "\033]0;title\007",	VTP_OSC, 0, 0, 0, 0, NULL, "0;title" },
+  { "\033]2;x\033\\",	VTP_OSC, 0, 0, 0, 0, NULL, "2;x" },
+  { "\033P1$rtext\033\\", VTP_DCS, 'r', 1, 1, 0, "$", "text" },
+  { "\033]0;0123456789012345678901234567890123456789"
+    "0123456789012345678901234567890123456789\007",
+			VTP_OSC, 0, 0, 0, 0, NULL,
+    "0;01234567890123456789012345678901234567890123456789012345678901" },
+  { "\033[1\030A",	VTP_NONE, 0, 0, 0, 0, NULL, NULL },
+  { "\033[1\032A",	VTP_NONE, 0, 0, 0, 0, NULL, NULL },
+  { "\033[1:2m",	VTP_NONE, 0, 0, 0, 0, NULL, NULL },
+  { "\033X sos \033\\",	VTP_ESC, '\\', 1, 0, 0, "", NULL },
+};
+#define NCHECKS	(int)(sizeof(checks) / sizeof(checks[0]))
+
+static const char *kinds[] = {
+  "none", "print", "execute", "ESC", "CSI", "DCS", "OSC",
+};
+
+static unsigned long seed;
+
+/* Same numbers every time. */
+static unsigned long rnd(void)
+{
+  seed = seed * 1103515245UL + 12345UL;
+  return (seed >> 16) & 0x7fff;
+}
+
+static int fail(const struct check *c, const char *what, int got, int want)
+{
+  int i;
+
+  printf("vtpbench: \"");
+  for (i = 0; c->in[i]; i++)
+    if ((unsigned char)c->in[i] < ' ' || (unsigned char)c->in[i] >= 0x7f)
+      printf("\\%03o", (unsigned char)c->in[i]);
+    else
+      putchar(c->in[i]);
+  printf("\": %s is %d, not %d\n", what, got, want);
+  return 1;
+}
+
+/* Feed the known sequences, and see if they come out right. */
+static int known(void)
+{
+  struct vtparse p;
+  const struct check *c;
+  const char *s;
+  int i, r, kind, bad = 0;
+
+  for (i = 0; i < NCHECKS; i++) {
+    c = &checks[i];
+    vtp_init(&p);
+    kind = VTP_NONE;
+    for (s = c->in; *s; s++) {
+      r = vtp_feed(&p, (unsigned char)*s);
+      if (r >= VTP_ESC) {
+        kind = r;
+        break;
+      }
+    }
+    if (kind != c->kind) {
+      bad += fail(c, kinds[kind], kind, c->kind);
+      continue;
+    }
+    if (kind == VTP_NONE)
+      continue;
+    if (kind != VTP_OSC) {
+      if (p.final != c->final)
+        bad += fail(c, "final", p.final, c->final);
+      if (p.nparams != c->nparams)
+        bad += fail(c, "nparams", p.nparams, c->nparams);
+      if (p.params[0] != c->p0)
+        bad += fail(c, "params[0]", p.params[0], c->p0);
+      if (p.params[1] != c->p1)
+        bad += fail(c, "params[1]", p.params[1], c->p1);
+      if (strcmp(p.inter, c->inter))
+        bad += fail(c, "inter length", (int)strlen(p.inter),
+                    (int)strlen(c->inter));
+    }
+    if (c->str && strcmp(p.str, c->str))
+      bad += fail(c, "string length", (int)strlen(p.str),
+                  (int)strlen(c->str));
+  }
+  return bad;
+}
+
+/*
+ * Random input, made of what makes the parser collect: ESC, CSI,
+ * digits, ';', intermediates and string bytes. Whatever comes,
+ * it must stay within its struct.
+ */
+static int overrun(void)
+{
+  static const char pick[] = "\033\033[[]P;;;;0123456789 !?$\007\\mH";
+  struct {
+    int before[NGUARD];
+    struct vtparse p;
+    int after[NGUARD];
+  } g;
+  long n;
+  int i, c, r;
+
+  for (i = 0; i < NGUARD; i++)
+    g.before[i] = g.after[i] = GUARD;
+  vtp_init(&g.p);
+  seed = 1;
+  for (n = 0; n < RANDOM; n++) {
+    c = rnd() % 8 ? pick[rnd() % (sizeof(pick) - 1)] : (int)(rnd() & 0xff);
+    r = vtp_feed(&g.p, c);
+    if (g.p.state < 0 || g.p.state >= VTP_NSTATES ||
+        g.p.nstr < 0 || g.p.nstr > VTP_MAXSTR ||
+        (r == VTP_CSI && (g.p.nparams < 1 || g.p.nparams > VTP_MAXPARAMS))) {
+      printf("vtpbench: byte %ld: state %d, %d params, string %d\n",
+             n, g.p.state, g.p.nparams, g.p.nstr);
+      return 1;
+    }
+  }
+  for (i = 0; i < NGUARD; i++)
+    if (g.before[i] != GUARD || g.after[i] != GUARD) {
+      printf("vtpbench: the parser wrote outside its struct\n");
+      return 1;
+    }
+  return 0;
+}
+
+/* Add what is in fp to *buf. */
+static int readall(FILE *fp, char **buf, long *len, long *size)
+{
+  size_t n;
+
+  do {
+    if (*len == *size) {
+      *size = *size ? 2 * *size : 65536;
+      if ((*buf = realloc(*buf, *size)) == NULL)
+        return -1;
+    }
+    n = fread(*buf + *len, 1, *size - *len, fp);
+    *len += n;
+  } while (n > 0);
+  return ferror(fp) ? -1 : 0;
+}
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-s MB] [file...]\n", prog);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  struct vtparse p;
+  long total = 64L * 1024 * 1024, len = 0, size = 0, done, seq = 0, i;
+  char *rec = NULL;
+  FILE *fp;
+  int c, bad;
+  double t0, t1;
+
+  while ((c = getopt(argc, argv, "s:")) != EOF) {
+    switch (c) {
+      case 's':
+        total = (long)(atof(optarg) * 1024 * 1024);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (total <= 0)
+    usage(argv[0]);
+
+  bad = known();
+  bad += overrun();
+  printf("%d known sequences, %ld random bytes: %s\n", NCHECKS, RANDOM,
+         bad ? "FAILED" : "ok");
+  if (bad)
+    return 1;
+
+  if (optind == argc && readall(stdin, &rec, &len, &size) < 0) {
+    perror("stdin");
+    return 1;
+  }
+  for (; optind < argc; optind++) {
+    if ((fp = fopen(argv[optind], "rb")) == NULL ||
+        readall(fp, &rec, &len, &size) < 0) {
+      perror(argv[optind]);
+      return 1;
+    }
+    fclose(fp);
+  }
+  if (len == 0) {
+    fprintf(stderr, "%s: nothing to parse\n", argv[0]);
+    return 1;
+  }
+
+  vtp_init(&p);
+  t0 = now();
+  for (done = 0; done < total; done += len)
+    for (i = 0; i < len; i++)
+      if (vtp_feed(&p, (unsigned char)rec[i]) >= VTP_ESC)
+        seq++;
+  t1 = now();
+  if (t1 - t0 <= 0)
+    t1 = t0 + 1e-6;
+
+  printf("%ld bytes recorded, %.1f MB parsed, %ld sequences\n", len,
+         done / (1024.0 * 1024.0), seq);
+  printf("%.3f seconds, %.1f MB/s, %.2f ns a byte\n", t1 - t0,
+         done / (1024.0 * 1024.0) / (t1 - t0), (t1 - t0) * 1e9 / done);
+  free(rec);
+  return 0;
+}
@@ -25,6 +25,7 @@
 #include <limits.h>
 #include <stdarg.h>
 #include <wchar.h>
+#include <poll.h>
 
 #include "port.h"
 #include "minicom.h"
@@ -89,7 +90,22 @@ static char S_LR;
 static char _bufstart[BUFFERSIZE];
 static char *_bufpos = _bufstart;
 static char *_buffend;
-static ELM *gmap;
+static ELM *gmap;		/* What the screen should look like */
+static ELM *fmap;		/* What the terminal shows right now */
+
+/*
+ * The columns of every line that changed since the screen was last
+ * brought up to date. x1 > x2 means the line is clean.
+ */
+struct damage {
+  int x1, x2;
+};
+static struct damage *damage;
+
+/* A cell in fmap we know nothing about never matches gmap. */
+#define NOCELL		((wchar_t)-1)
+#define SAMECELL(a, b)	((a)->value == (b)->value && (a)->attr == (b)->attr \
+			 && (a)->color == (b)->color)
 
 static char curattr = -1;
 static char curcolor = -1;
@@ -99,8 +115,12 @@ static int _intern = 0;
 static int _curstype = CNORMAL;
 static int _has_am = 0;
 static int _mv_standout = 0;
+static int _cmcost = 0;		/* Bytes a cursor motion takes */
 static ELM oldc;
 static int sflag = 0;
+static int wantx = -1;		/* Where the cursor goes after an update */
+static int wanty = -1;
+static int _defer = 0;		/* Leave scrolling to the next update */
 
 /*
  * Smooth is only defined for slow machines running Minicom.
@@ -149,14 +169,62 @@ int debug(char *s, ...)
 }
 #endif
 
+/* ===== Multibyte characters ===== */
+
+/* mbtowc (), except that mbtowc (.. , "", ..) == 1, errors are treated as
+ * (wchar_t)*s */
+size_t one_mbtowc(wchar_t *pwc, const char *s, size_t n)
+{
+  int len;
+
+  len = mbtowc(pwc, s, n);
+  if (len == -1)
+    *pwc = *s;
+  if (len <= 0)
+    len = 1;
+  return len;
+}
+
+/* wctomb (), except that mbtowc (.. , 0) == 1, errors are treated as
+ * *s = (char)wchar */
+size_t
+one_wctomb(char *s, wchar_t wchar)
+{
+  int len;
+
+  len = wctomb(s, wchar);
+  if (len == -1)
+    s[0] = (char)wchar;
+  if (len <= 0)
+    len = 1;
+  return len;
+}
+
+/* Number of characters in S */
+size_t
+mbslen(const char *s)
+{
+  size_t len;
+
+  len = 0;
+  while (*s != 0) {
+    wchar_t wc;
+
+    s += one_mbtowc(&wc, s, MB_LEN_MAX);
+    len++;
+  }
+  return len;
+}
+
 /* ===== Low level routines ===== */
 
 /*
- * Flush the screen buffer
+ * Write the output buffer to the terminal.
  */
-void mc_wflush(void)
+static void outflush(void)
 {
   int todo, done;
+  INSTR_START(t);
 
   todo = _bufpos - _bufstart;
   _bufpos = _bufstart;
@@ -170,6 +238,8 @@ void mc_wflush(void)
     if (done < 0 && errno != EINTR)
       break;
   }
+  INSTR_END(IN_TERM, t, _bufpos - _bufstart);
+  PROBE1(screen_flush, _bufpos - _bufstart);
   _bufpos = _bufstart;
 }
 
@@ -180,14 +250,24 @@ static int outchar(int c)
 {
   *_bufpos++ = c;
   if (_bufpos >= _buffend)
-    mc_wflush();
+    outflush();
 #if defined(SMOOTH)
   if (curwin == us && (c == '\n' || c == '\r'))
-    mc_wflush();
+    outflush();
 #endif
   return 0;
 }
 
+/*
+ * Count the bytes of a string instead of sending them.
+ */
+static int countchar(int c)
+{
+  (void)c;
+  _cmcost++;
+  return 0;
+}
+
 /*
  * Output a raw string to the screen.
  */
@@ -270,9 +350,9 @@ static void _setattr(char attr, char color)
 }
 
 /*
- * Goto (x, y) in stdwin
+ * Move the terminal's cursor to (x, y) in stdwin
  */
-static void _gotoxy(int x, int y)
+static void _moveto(int x, int y)
 {
   int oldattr = -1;
 
@@ -322,6 +402,7 @@ static void _gotoxy(int x, int y)
   }
 #endif
 
+  INSTR_START(t);
   if (!_mv_standout && curattr != XA_NORMAL) {
     oldattr = curattr;
     _setattr(XA_NORMAL, curcolor);
@@ -343,17 +424,52 @@ static void _gotoxy(int x, int y)
   cury = y;
   if (oldattr != -1)
     _setattr(oldattr, curcolor);
+  INSTR_END(IN_MOVE, t, 0);
+}
+
+/*
+ * Set the position of the cursor in stdwin. It is moved there
+ * when the screen is updated.
+ */
+static void _gotoxy(int x, int y)
+{
+  wantx = x;
+  wanty = y;
+}
+
+/*
+ * Mark columns x1 to x2 of line y as changed.
+ */
+static void _damage(int x1, int x2, int y)
+{
+  if (x1 < damage[y].x1)
+    damage[y].x1 = x1;
+  if (x2 > damage[y].x2)
+    damage[y].x2 = x2;
+}
+
+/*
+ * Forget what the terminal shows in n cells starting at e.
+ */
+static void _unknown(ELM *e, int n)
+{
+  while (n-- > 0)
+    (e++)->value = NOCELL;
 }
 
 /*
  * Write a character in stdwin at x, y with attr & color
- * 'doit' can be  -1: only write to screen, not to memory
+ * 'doit' can be  -1: only redraw on screen, memory is unchanged
  *                 0: only write to memory, not to screen
  *                 1: write to both screen and memory
+ *                 2: write to memory, the screen already shows it
+ * Writing to the screen only marks the cell as changed; the
+ * terminal is brought up to date by mc_wflush().
  */
 static void _write(wchar_t c, int doit, int x, int y, char attr, char color)
 {
   ELM *e;
+  INSTR_START(t);
 
   /* If the terminal has automatic margins, we can't write to the
    * last line, last character. After scrolling, this "invisible"
@@ -372,34 +488,177 @@ static void _write(wchar_t c, int doit, int x, int y, char attr, char color)
   if (x < COLS && y < LINES)
 #endif
   {
-    if (doit != 0) {
-      static int x0 = -1, y0 = -1, c0 = 0;
-      static char attr0, color0;
-      if (x!=x0+1 || y!=y0 || attr!=attr0 || color!=color0 || !(c0&128)) {
-        _gotoxy(x, y);
-        _setattr(attr, color);
-      }
-      x0 = x; y0 = y; attr0 = attr; color0 = color; c0 = c;
-      if (using_iconv() || (attr & XA_ALTCHARSET) != 0)
-        outchar((char)c);
-      else {
-        char buf[MB_LEN_MAX];
-        size_t i, len;
-
-        len = one_wctomb(buf, c);
-        for (i = 0; i < (size_t)len; i++)
-        outchar(buf[i]);
-      }
-
-      curx++;
-    }
+    e = &gmap[x + y * COLS];
     if (doit >= 0) {
-      e = &gmap[x + y * COLS];
       e->value = c;
       e->attr = attr;
       e->color = color;
     }
+    if (doit == 2)
+      fmap[x + y * COLS] = *e;
+    else if (doit != 0) {
+      if (doit < 0)
+        fmap[x + y * COLS].value = NOCELL;
+      _damage(x, x, y);
+    }
   }
+  INSTR_END(IN_CELL, t, 1);
+}
+
+/*
+ * Send one cell to the terminal.
+ */
+static void _putelm(ELM *e)
+{
+  if ((unsigned)e->value < 128 || using_iconv() ||
+      (e->attr & XA_ALTCHARSET) != 0)
+    outchar((char)e->value);
+  else {
+    char buf[MB_LEN_MAX];
+    size_t i, len;
+
+    len = one_wctomb(buf, e->value);
+    for (i = 0; i < (size_t)len; i++)
+      outchar(buf[i]);
+  }
+  curx++;
+}
+
+/*
+ * Bring line y of the terminal up to date with gmap. Only cells
+ * that differ from what the terminal shows are sent.
+ */
+static void _drawline(int y)
+{
+  ELM *g = gmap + y * COLS;
+  ELM *f = fmap + y * COLS;
+  int x, x1, x2, i, n, end, ce;
+
+  x1 = damage[y].x1;
+  x2 = damage[y].x2;
+  damage[y].x1 = COLS;
+  damage[y].x2 = -1;
+
+  /* The lower right corner is never drawn, see _write(). */
+  end = COLS - 1;
+  if (_has_am && y >= LINES - 1)
+    end = COLS - 2;
+  if (x2 > end)
+    x2 = end;
+
+  while (x1 <= x2 && SAMECELL(g + x1, f + x1))
+    x1++;
+  while (x2 >= x1 && SAMECELL(g + x2, f + x2))
+    x2--;
+  if (x1 > x2)
+    return;
+
+  /* If the line ends in plain blanks, clearing it may be cheaper. */
+  ce = COLS;
+  if (CE != NULL && g[end].value == ' ' && g[end].attr == XA_NORMAL) {
+    for (ce = end; ce > 0; ce--)
+      if (!SAMECELL(g + ce - 1, g + end))
+        break;
+    for (n = 0, i = (ce > x1 ? ce : x1); i <= x2; i++)
+      if (!SAMECELL(g + i, f + i))
+        n++;
+    if (ce > x2 || n < 4)
+      ce = COLS;
+    else
+      x2 = ce - 1;
+  }
+
+  for (x = x1; x <= x2; x++) {
+    if (SAMECELL(g + x, f + x))
+      continue;
+    if (x != curx || y != cury) {
+      /* Rewriting a few unchanged cells is shorter than moving. */
+      n = x - curx;
+      if (y == cury && curx >= 0 && n > 0 && n <= _cmcost) {
+        for (i = curx; i < x; i++)
+          if (g[i].attr != curattr || g[i].color != curcolor ||
+              (unsigned)g[i].value >= 128 || g[i].value < ' ')
+            break;
+        if (i < x)
+          n = 0;
+      } else
+        n = 0;
+      if (n)
+        for (i = x - n; i < x; i++) {
+          _putelm(g + i);
+          f[i] = g[i];
+        }
+      else
+        _moveto(x, y);
+    }
+    /* Send changed cells as long as the attributes stay the same. */
+    _setattr(g[x].attr, g[x].color);
+    do {
+      _putelm(g + x);
+      f[x] = g[x];
+      x++;
+    } while (x <= x2 && g[x].attr == g[x - 1].attr &&
+             g[x].color == g[x - 1].color && !SAMECELL(g + x, f + x));
+    x--;
+  }
+
+  if (ce < COLS) {
+    _moveto(ce, y);
+    _setattr(g[ce].attr, g[ce].color);
+    outstr(CE);
+    for (x = ce; x < COLS; x++)
+      f[x] = g[ce];
+  }
+}
+
+/*
+ * Send all changes to the terminal. This has to be done before
+ * anything that depends on what the terminal shows, like scrolling.
+ */
+static void _draw(void)
+{
+  int y;
+
+  for (y = 0; y <= LINES; y++)
+    if (damage[y].x1 <= damage[y].x2)
+      _drawline(y);
+}
+
+/*
+ * Update the screen and put the cursor where it belongs.
+ */
+void mc_wflush(void)
+{
+  INSTR_START(t);
+
+  _draw();
+  if (wantx >= 0)
+    _moveto(wantx, wanty);
+  outflush();
+  INSTR_END(IN_FLUSH, t, 0);
+}
+
+/*
+ * Can the terminal take output without making us wait?
+ */
+int mc_wready(void)
+{
+  struct pollfd fds;
+
+  fds.fd = 1;
+  fds.events = POLLOUT;
+  return poll(&fds, 1, 0) > 0 && (fds.revents & POLLOUT);
+}
+
+/*
+ * While 'on' is set, scrolling a screen-wide window only changes the
+ * memory image. The next update draws the difference, which is less
+ * than sending every scroll when lines come in faster than they can
+ * be seen.
+ */
+void mc_wdefer(int on)
+{
+  _defer = on;
 }
 
 /*
@@ -468,10 +727,11 @@ void mc_wresize(WIN *win, int lines, int cols)
 #endif
 
 /*
- * Create a new window.
+ * Create a new window. With histmem, lines that scroll off the top
+ * are kept in a history of up to that many bytes.
  */
 WIN *mc_wopen(int x1, int y1, int x2, int y2, int border, int attr,
-           int fg, int bg, int direct, int histlines, int doclr)
+           int fg, int bg, int direct, long histmem, int doclr)
 {
   WIN *w;
   ELM *e;
@@ -524,8 +784,8 @@ WIN *mc_wopen(int x1, int y1, int x2, int y2, int border, int attr,
   w->curx = 0;
   w->cury = 0;
 
-  w->o_curx = curx;
-  w->o_cury = cury;
+  w->o_curx = wantx;
+  w->o_cury = wanty;
   w->o_attr = curattr;
   w->o_color = curcolor;
   w->o_cursor = _curstype;
@@ -553,27 +813,15 @@ WIN *mc_wopen(int x1, int y1, int x2, int y2, int border, int attr,
   }
 
   /* Do we want history? */
-  w->histline = w->histlines = 0;
-  w->histbuf = NULL;
-  if (histlines) {
-    /* Reserve some memory. */
-    bytes = w->xs * histlines * sizeof(ELM);
-    if ((w->histbuf = malloc(bytes)) == NULL) {
-      free(w->map);
-      free(w);
-      return NULL;
-    }
-    w->histlines = histlines;
-
-    /* Clear the history buf. */
-    e = w->histbuf;
-    for (y = 0; y < w->xs * histlines; y++) {
-      e->value = ' ';
-      e->attr = attr;
-      e->color = color;
-      e++;
-    }
+  w->hist = NULL;
+  if (histmem && (w->hist = hist_open(histmem)) == NULL) {
+    free(w->map);
+    free(w);
+    return NULL;
   }
+  hist_width(w->hist, w->xs);
+  /* Without it, lines that wrapped are not joined again. */
+  w->wrapped = calloc(w->ys, 1);
 
   /* And draw the window */
   if (border) {
@@ -638,7 +886,7 @@ void mc_wclose(WIN *win, int replace)
       ELM *g;
       g = gmap + (y * stdwin->xs);
       for (x = 0 ; x < win->x1; x++) {
-        _write(g->value, 1, x, y, g->attr, g->color);
+        _write(g->value, -1, x, y, g->attr, g->color);
         g++;
       }
       /* to here */
@@ -651,12 +899,163 @@ void mc_wclose(WIN *win, int replace)
     _setattr(win->o_attr, win->o_color);
   }
   free(win->map);
-  if (win->histbuf)
-    free(win->histbuf);
+  free(win->wrapped);
+  hist_close(win->hist);
   free(win);	/* 1.1.98 dickey@clark.net  */
   mc_wflush();
 }
 
+/*
+ * What a window showed, where its cursor was and its history, kept by
+ * mc_wsave() over closing it, for mc_wrestore() on the window that
+ * takes its place.
+ */
+struct wsave {
+  int xs, ys;
+  int curx, cury;
+  ELM *map;
+  char *wrapped;
+  struct hist *hist;
+};
+
+/*
+ * Keep what w shows and take its history, before it is closed. NULL
+ * if there is no memory; the history then stays with the window.
+ */
+struct wsave *mc_wsave(WIN *w)
+{
+  struct wsave *s;
+  int y;
+
+  if ((s = malloc(sizeof(struct wsave))) == NULL)
+    return NULL;
+  s->map = malloc(w->xs * w->ys * sizeof(ELM));
+  s->wrapped = calloc(w->ys, 1);
+  if (s->map == NULL || s->wrapped == NULL) {
+    free(s->map);
+    free(s->wrapped);
+    free(s);
+    return NULL;
+  }
+  for (y = 0; y < w->ys; y++)
+    memcpy(s->map + y * w->xs, gmap + (w->y1 + y) * COLS + w->x1,
+           w->xs * sizeof(ELM));
+  if (w->wrapped)
+    memcpy(s->wrapped, w->wrapped, w->ys);
+  s->xs = w->xs;
+  s->ys = w->ys;
+  s->curx = w->curx;
+  s->cury = w->cury;
+  s->hist = w->hist;
+  w->hist = NULL;
+  return s;
+}
+
+/* The cells of row y of s before the blanks that end it. */
+static int save_used(struct wsave *s, int y)
+{
+  ELM *e = s->map + y * s->xs, *last = e + s->xs - 1;
+  int n;
+
+  for (n = s->xs; n > 0; n--)
+    if (e[n - 1].value != ' ' || e[n - 1].attr != last->attr ||
+        e[n - 1].color != last->color)
+      break;
+  return n;
+}
+
+/*
+ * Show in w what s kept, and give w the history; w may have another
+ * size. A run of rows that wrapped into each other is wrapped again at
+ * the new width. What does not fit goes to the history, as if it had
+ * scrolled off the top. s is freed.
+ */
+void mc_wrestore(WIN *w, struct wsave *s)
+{
+  ELM *rows, *e, blank;
+  char *wrapped;
+  int start, end, last, len, cur, n, i, x, y;
+  int nrows, max, top, cx = 0, cy = 0;
+
+  hist_close(w->hist);
+  w->hist = s->hist;
+  hist_width(w->hist, w->xs);
+
+  max = s->ys * (s->xs / w->xs + 2);
+  rows = malloc(max * w->xs * sizeof(ELM));
+  wrapped = calloc(max, 1);
+  if (rows == NULL || wrapped == NULL)
+    max = 0;
+
+  /* Rows below the cursor that are empty are left out. */
+  for (last = s->ys - 1; last > s->cury; last--) {
+    e = s->map + last * s->xs;
+    for (x = 0; x < s->xs && e[x].value == ' '; x++)
+      ;
+    if (x < s->xs)
+      break;
+  }
+
+  nrows = 0;
+  for (start = 0; max > 0 && start <= last; start = end + 1) {
+    for (end = start; end < last && s->wrapped[end]; end++)
+      ;
+    len = (end - start) * s->xs + save_used(s, end);
+    cur = s->cury >= start && s->cury <= end ?
+          (s->cury - start) * s->xs + s->curx : -1;
+    if (w->xs == s->xs)
+      n = end - start + 1;
+    else {
+      n = len > 0 ? (len + w->xs - 1) / w->xs : 1;
+      if (cur >= 0 && cur / w->xs >= n)
+        n = cur / w->xs + 1;
+    }
+    blank = s->map[end * s->xs + s->xs - 1];
+    blank.value = ' ';
+    for (i = 0; i < n * w->xs; i++)
+      rows[nrows * w->xs + i] = i < len ? s->map[start * s->xs + i] : blank;
+    for (i = 0; i < n - 1; i++)
+      wrapped[nrows + i] = 1;
+    if (cur >= 0 && w->xs == s->xs) {
+      cy = nrows + s->cury - start;
+      cx = s->curx;
+    } else if (cur >= 0) {
+      cy = nrows + cur / w->xs;
+      cx = cur % w->xs;
+    }
+    nrows += n;
+  }
+
+  /* Keep the cursor on the screen. */
+  top = nrows > w->ys ? nrows - w->ys : 0;
+  if (cy < top)
+    top = cy;
+  for (y = 0; y < top; y++)
+    if (w->hist)
+      hist_add(w->hist, rows + y * w->xs, w->xs, wrapped[y]);
+
+  blank.value = ' ';
+  blank.attr = w->attr;
+  blank.color = w->color;
+  for (y = 0; y < w->ys; y++) {
+    for (x = 0; x < w->xs; x++) {
+      e = top + y < nrows ? rows + (top + y) * w->xs + x : &blank;
+      _write(e->value, w->direct, w->x1 + x, w->y1 + y, e->attr, e->color);
+    }
+    if (w->wrapped)
+      w->wrapped[y] = top + y < nrows ? wrapped[top + y] : 0;
+  }
+  mc_wlocate(w, cx, cy - top);
+
+  free(rows);
+  free(wrapped);
+  free(s->map);
+  free(s->wrapped);
+  free(s);
+  if (w->direct)
+    mc_wflush();
+}
+
 static int oldx, oldy;
 static int ocursor;
 
@@ -665,12 +1064,13 @@ static int ocursor;
  */
 void mc_wleave(void)
 {
-  oldx = curx;
-  oldy = cury;
+  oldx = wantx;
+  oldy = wanty;
   ocursor = _curstype;
 
   setcbreak(0); /* Normal */
-  _gotoxy(0, LINES - 1);
+  _draw();
+  _moveto(0, LINES - 1);
   _setattr(XA_NORMAL, COLATTR(WHITE, BLACK));
   _cursor(CNORMAL);
   if (CL != NULL)
@@ -685,7 +1085,11 @@ void mc_wleave(void)
     outstr(KE);
   if (RS != NULL)
     outstr(RS);
-  mc_wflush();
+  outflush();
+
+  /* Someone else owns the screen until mc_wreturn(). */
+  _unknown(fmap, (LINES + 1) * COLS);
+  wantx = wanty = -1;
 }
 
 void mc_wreturn(void)
@@ -699,6 +1103,8 @@ void mc_wreturn(void)
 
   curattr = -1;
   curcolor = -1;
+  curx = -1;
+  cury = -1;
 
   setcbreak(1); /* Cbreak, no echo */
 
@@ -759,18 +1165,19 @@ void mc_wredraw(WIN *w, int newdirect)
     e += addcnt;
   }
   _gotoxy(w->x1 + w->curx, w->y1 + w->cury);
+  mc_wflush();
   _cursor(w->cursor);
   mc_wflush();
   w->direct = newdirect;
 }
 
 /*
- * Clear to end of line, low level.
+ * Clear to end of line, low level. When the screen is updated
+ * this becomes a "clear to end of line" if that is shorter.
  */
-static int _wclreol(WIN *w)
+static void _wclreol(WIN *w)
 {
   int x;
-  int doit = 1;
   int y;
 
 #ifdef SMOOTH
@@ -778,16 +1185,26 @@ static int _wclreol(WIN *w)
 #endif
   y = w->cury + w->y1;
 
-  if (w->direct && (w->x2 == COLS - 1) && CE) {
-    _gotoxy(w->curx + w->x1, y);
-    _setattr(w->attr, w->color);
-    outstr(CE);
-    doit = 0;
-  }
-  for (x = w->curx + w->x1; x <= w->x2; x++) {
-    _write(' ', (w->direct && doit) ? 1 : 0, x, y, w->attr, w->color);
-  }
-  return doit;
+  for (x = w->curx + w->x1; x <= w->x2; x++)
+    _write(' ', w->direct, x, y, w->attr, w->color);
+  if (w->wrapped)
+    w->wrapped[w->cury] = 0;
+}
+
+/*
+ * Move n screen cells, the areas may overlap.
+ */
+static void _memmove(ELM *dst, ELM *src, int n)
+{
+#ifdef _SYSV
+  memcpy((char *)dst, (char *)src, n * sizeof(ELM));
+#else
+#  ifdef _BSD43
+  bcopy((char *)src, (char *)dst, n * sizeof(ELM));
+#  else
+  memmove((char *)dst, (char *)src, n * sizeof(ELM));
+#  endif
+#endif
 }
 
 /*
@@ -796,30 +1213,40 @@ static int _wclreol(WIN *w)
 void mc_wscroll(WIN *win, int dir)
 {
   ELM *e, *f;
-  char *src, *dst;
+  int src, dst;
   int x, y;
   int doit = 1;
   int ocurx, fs = 0, len;
-  int phys_scr = 0;
+  int phys_scr = 0, deferred = 0;
 
 #ifdef SMOOTH
   curwin = win;
 #endif
 
+  /*
+   * When deferring, only the memory image is scrolled; the terminal
+   * catches up with the next update.
+   */
+  if (_defer && win->direct && win->xs == COLS) {
+    doit = 0;
+    phys_scr = 1;
+    deferred = 1;
+  }
   /*
    * If the window *is* the physical screen, we can scroll very simple.
    * This improves performance on slow screens (eg ATARI ST) dramatically.
    */
-  if (win->direct && SF != NULL &&
+  else if (win->direct && SF != NULL && win->xs == COLS &&
       (dir == S_UP || SR != NULL) && (LINES == win->sy2 - win->sy1 + 1)) {
     doit = 0;
     phys_scr = 1;
+    _draw();
     _setattr(win->attr, win->color);
     if (dir == S_UP) {
-      _gotoxy(0, LINES - 1);
+      _moveto(0, LINES - 1);
       outstr(SF);
     } else {
-      _gotoxy(0, 0);
+      _moveto(0, 0);
       outstr(SR);
     }
   }
@@ -832,6 +1259,7 @@ void mc_wscroll(WIN *win, int dir)
        || (Dl != NULL && Al != NULL))) {
     doit = 0;
     phys_scr = 1;
+    _draw();
     _setattr(win->attr, win->color);
     if (CS != NULL && SF != NULL && SR != NULL) { /* Scrolling Region */
       /* If the scroll region we want to initialize already is as
@@ -845,27 +1273,27 @@ void mc_wscroll(WIN *win, int dir)
         cury = 0;
       }
       if (dir == S_UP) {
-        _gotoxy(0, win->sy2);
+        _moveto(0, win->sy2);
         outstr(SF);
       } else {
-        _gotoxy(0, win->sy1);
+        _moveto(0, win->sy1);
         outstr(SR);
       }
       if (!fs) {
         outstr(tgoto(CS, LINES - 1, 0));
         cury = 0;
       }
-      _gotoxy(0, win->sy2);
+      _moveto(0, win->sy2);
     } else { /* Use insert/delete line */
       if (dir == S_UP) {
-        _gotoxy(0, win->sy1);
+        _moveto(0, win->sy1);
         outstr(Dl);
-        _gotoxy(0, win->sy2);
+        _moveto(0, win->sy2);
         outstr(Al);
       } else {
-        _gotoxy(0, win->sy2);
+        _moveto(0, win->sy2);
         outstr(Dl);
-        _gotoxy(0, win->sy1);
+        _moveto(0, win->sy1);
         outstr(Al);
       }
     }
@@ -873,10 +1301,11 @@ void mc_wscroll(WIN *win, int dir)
 
   /* If a terminal has automatic margins, we can't write
    * to the lower right. After scrolling we have to restore
-   * the non-visible character that is now visible.
+   * the non-visible character that is now visible. Only when the
+   * terminal itself scrolled, else this would overwrite the line.
    */
   if (sflag && win->sy2 == (LINES - 1) && win->sy1 != win->sy2) {
-    if (dir == S_UP) {
+    if (dir == S_UP && phys_scr && !deferred) {
       _write(oldc.value, 1, COLS - 1, LINES - 2,
              oldc.attr, oldc.color);
     }
@@ -885,52 +1314,48 @@ void mc_wscroll(WIN *win, int dir)
 
   ocurx = win->curx;
 
-  /* If this window has a history buf, see if we want to use it. */
-  if (win->histbuf && dir == S_UP &&
-      win->sy2 == win->y2 && win->sy1 == win->y1) {
-
-    /* Calculate screen buffer */
-    e = gmap + win->y1 * COLS + win->x1;
-
-    /* Calculate history buffer */
-    f = win->histbuf + (win->xs * win->histline);
-
-    /* Copy line from screen to history buffer */
-    memcpy((char *)f, (char *)e, win->xs * sizeof(ELM));
+  /* If this window has history, the top line goes there. */
+  if (win->hist && dir == S_UP &&
+      win->sy2 == win->y2 && win->sy1 == win->y1)
+    hist_add(win->hist, gmap + win->y1 * COLS + win->x1, win->xs,
+             win->wrapped && win->wrapped[0]);
 
-    /* Postion the next line in the history buffer */
-    win->histline++;
-    if (win->histline >= win->histlines)
-      win->histline = 0;
+  /* Whether a row wrapped goes with it. */
+  if (win->wrapped) {
+    y = win->sy1 - win->y1;
+    len = win->sy2 - win->sy1;
+    if (dir == S_UP) {
+      memmove(win->wrapped + y, win->wrapped + y + 1, len);
+      win->wrapped[y + len] = 0;
+    } else {
+      memmove(win->wrapped + y + 1, win->wrapped + y, len);
+      win->wrapped[y] = 0;
+    }
   }
 
   /* If the window is screen-wide and has no border, there
    * is a much simpler & FASTER way of scrolling the memory image !!
+   * Unless deferred, the terminal has scrolled as well, so do the
+   * same to what we know it shows.
    */
   if (phys_scr) {
-    len = (win->sy2 - win->sy1) * win->xs * sizeof(ELM);
+    len = (win->sy2 - win->sy1) * COLS;
     if (dir == S_UP)  {
-      dst = (char *)&gmap[0];				/* First line */
-      src = (char *)&gmap[win->xs];			/* Second line */
+      dst = win->sy1 * COLS;				/* First line */
+      src = dst + COLS;					/* Second line */
       win->cury = win->sy2 - win->y1;
     } else {
-      src = (char *)&gmap[0];				/* First line */
-      dst = (char *)&gmap[win->xs];			/* Second line */
+      src = win->sy1 * COLS;				/* First line */
+      dst = src + COLS;					/* Second line */
       win->cury = win->sy1 - win->y1;
     }
-    /* memmove copies len bytes from src to dst, even if the
-     * objects overlap.
-     */
     fflush(stdout);
-#ifdef _SYSV
-    memcpy((char *)dst, (char *)src, len);
-#else
-#  ifdef _BSD43
-    bcopy((char *)src, (char *)dst, len);
-#  else
-    memmove((char *)dst, (char *)src, len);
-#  endif
-#endif
+    _memmove(gmap + dst, gmap + src, len);
+    if (deferred) {
+      for (y = win->sy1; y <= win->sy2; y++)
+        _damage(0, COLS - 1, y);
+    } else
+      _memmove(fmap + dst, fmap + src, len);
   } else {
     /* Now scroll the memory image. */
     if (dir == S_UP) {
@@ -962,15 +1387,39 @@ void mc_wscroll(WIN *win, int dir)
 
   win->curx = ocurx;
 
-  if (!doit)
-    for (x = win->x1; x <= win->x2; x++)
-      _write(' ', 0, x, win->y1 + win->cury, win->attr, win->color);
+  if (!doit) {
+    /* The terminal has scrolled in an empty line. */
+    y = win->y1 + win->cury;
+    e = gmap + y * COLS;
+    f = fmap + y * COLS;
+    if (win->xs != COLS && !deferred)
+      _unknown(f, COLS);
+    for (x = win->x1; x <= win->x2; x++) {
+      e[x].value = ' ';
+      e[x].attr = win->attr;
+      e[x].color = win->color;
+      if (!deferred)
+        f[x] = e[x];
+    }
+    if (_has_am && y >= LINES - 1 && !deferred)
+      f[COLS - 1].value = NOCELL;
+  }
   if (!_intern && win->direct)
     _gotoxy(win->x1 + win->curx, win->y1 + win->cury);
   if (dirflush && !_intern && win->direct)
     mc_wflush();
 }
 
+/*
+ * The character at x, y in a window, NULL if that is outside it.
+ */
+ELM *mc_wgetelm(WIN *win, int x, int y)
+{
+  if (x < 0 || y < 0 || x >= win->xs || y >= win->ys)
+    return NULL;
+  return gmap + (win->y1 + y) * COLS + win->x1 + x;
+}
+
 /*
  * Locate the cursor in a window.
  */
@@ -1031,8 +1480,11 @@ void mc_wputc(WIN *win, wchar_t c)
     default:
       /* See if we need to scroll/move. (vt100 behaviour!) */
       if (c == '\n' || (win->curx >= win->xs && win->wrap)) {
-        if (c != '\n')
+        if (c != '\n') {
+          if (win->wrapped)
+            win->wrapped[win->cury] = 1;
           win->curx = 0;
+        }
         win->cury++;
         mv++;
         if (win->cury == win->sy2 - win->y1 + 1) {
@@ -1052,7 +1504,6 @@ void mc_wputc(WIN *win, wchar_t c)
                win->cury + win->y1, win->attr, win->color);
         if (++win->curx >= win->xs && !win->wrap) {
           win->curx--;
-          curx = 0; /* Force to move */
           mv++;
         }
       }
@@ -1065,6 +1516,67 @@ void mc_wputc(WIN *win, wchar_t c)
     mc_wflush();
 }
 
+/*
+ * Print a run of printable ASCII characters in a window.
+ * This does the same as calling mc_wputc() for every character, but
+ * updates the screen map a line segment at a time. Wrapping and
+ * scrolling are left to mc_wputc().
+ */
+void mc_wputsn(WIN *win, const char *s, int len)
+{
+  int n, i, x, y, last;
+  ELM *e;
+
+#ifdef SMOOTH
+  curwin = win;
+#endif
+
+  while (len > 0) {
+    /* Room left on this line; the last column is handled by
+     * mc_wputc() if we do not wrap, as it keeps the cursor there. */
+    n = win->xs - win->curx - (win->wrap ? 0 : 1);
+    y = win->cury + win->y1;
+#ifdef ST_LINE
+    if (n <= 0 || y > LINES) {
+#else
+    if (n <= 0 || y >= LINES) {
+#endif
+      mc_wputc(win, (unsigned char)*s++);
+      len--;
+      continue;
+    }
+    if (n > len)
+      n = len;
+    x = win->curx + win->x1;
+    if (x + n > COLS)
+      n = COLS - x;
+
+    /* The lower right corner is special with automatic margins. */
+    last = n;
+    if (_has_am && y >= LINES - 1 && x + n >= COLS)
+      last = n - 1;
+
+    e = &gmap[x + y * COLS];
+    for (i = 0; i < last; i++, e++) {
+      e->value = (unsigned char)s[i];
+      e->attr = win->attr;
+      e->color = win->color;
+    }
+    if (win->direct && last > 0)
+      _damage(x, x + last - 1, y);
+    if (last < n)
+      _write((unsigned char)s[last], win->direct, x + last, y,
+             win->attr, win->color);
+
+    win->curx += n;
+    s += n;
+    len -= n;
+  }
+
+  if (win->direct && dirflush && !_intern)
+    mc_wflush();
+}
+
 /* Draw one line in a window */
 void mc_wdrawelm(WIN *w, int y, ELM *e)
 {
@@ -1399,7 +1911,8 @@ void mc_wclrel(WIN *w)
  */
 void mc_wclreol(WIN *w)
 {
-  if (_wclreol(w) && w->direct)
+  _wclreol(w);
+  if (w->direct)
     _gotoxy(w->x1 + w->curx, w->y1 + w->cury);
   if (dirflush)
     mc_wflush();
@@ -1452,7 +1965,8 @@ void mc_wclreos(WIN *w)
   }
   w->curx = ocurx;
   w->cury = ocury;
-  if (_wclreol(w) && w->direct)
+  _wclreol(w);
+  if (w->direct)
     _gotoxy(w->x1 + w->curx, w->y1 + w->cury);
   if (dirflush && w->direct)
     mc_wflush();
@@ -1486,13 +2000,12 @@ void mc_wclrbos(WIN *w)
 void mc_winclr(WIN *w)
 {
   int y;
-  int olddir = w->direct;
-  ELM *e, *f;
+  ELM *e;
   int i;
   int m;
 
   /* If this window has history, save the image. */
-  if (w->histbuf) {
+  if (w->hist) {
     /* MARK updated 02/17/95 - Scan backwards from the bottom of the */
     /* window for the first non-empty line.  We should save all other */
     /* blank lines inside screen, since some nice BBS ANSI menus */
@@ -1511,33 +2024,17 @@ void mc_winclr(WIN *w)
     }
 
     /* Copy window into history buffer line-by-line. */
-    for (y = w->y1; y <= m; y++) {
-      /* Start of this line in the global map. */
-      e = gmap + y * COLS + w->x1;
-
-      /* Now copy this line. */
-      f = w->histbuf + (w->xs * w->histline); /* History buffer */
-      memcpy((char *)f, (char *)e, w->xs * sizeof(ELM));
-      w->histline++;
-      if (w->histline >= w->histlines)
-        w->histline = 0;
-    }
+    for (y = w->y1; y <= m; y++)
+      hist_add(w->hist, gmap + y * COLS + w->x1, w->xs,
+               y < m && w->wrapped && w->wrapped[y - w->y1]);
   }
 
-  _setattr(w->attr, w->color);
   w->curx = 0;
 
-  if (CL && w->y1 == 0 && w->y2 == LINES-1 && w->x1 == 0 && w->x2 == COLS-1) {
-    w->direct = 0;
-    curx = 0;
-    cury = 0;
-    outstr(CL);
-  }
   for (y = w->ys - 1; y >= 0; y--) {
     w->cury = y;
     _wclreol(w);
   }
-  w->direct = olddir;
   _gotoxy(w->x1, w->y1);
   if (dirflush)
     mc_wflush();
@@ -1611,23 +2108,25 @@ void mc_winschar2(WIN *w, wchar_t c, int move)
     return;
   }
 
+  y = w->y1 + w->cury;
+  x = w->x1 + w->curx;
+
   odir = w->direct;
   if (w->xs == COLS && IC != NULL) {
     /* We can use the insert character capability. */
-    if (w->direct)
+    if (w->direct) {
+      _draw();
+      _moveto(x, y);
       outstr(IC);
-
-    /* No need to draw the character if it's a space. */
-    if (c == ' ')
-      w->direct = 0;
+      _memmove(fmap + y * COLS + x + 1, fmap + y * COLS + x, COLS - x - 1);
+      _unknown(fmap + y * COLS + x, 1);
+    }
 
     /* We don't need to draw the new line at all. */
     doit = 0;
   }
 
   /* Get the rest of line into buffer */
-  y = w->y1 + w->cury;
-  x = w->x1 + w->curx;
   oldx = w->curx;
   len = w->xs - w->curx;
 
@@ -1644,7 +2143,7 @@ void mc_winschar2(WIN *w, wchar_t c, int move)
   /* Write buffer to screen */
   e = buf;
   for (++x; x <= w->x2; x++) {
-    _write(e->value, doit && w->direct, x, y, e->attr, e->color);
+    _write(e->value, w->direct ? (doit ? 1 : 2) : 0, x, y, e->attr, e->color);
     e++;
   }
   free(buf);
@@ -1675,19 +2174,21 @@ void mc_wdelchar(WIN *w)
   y = w->y1 + w->cury;
 
   if (w->direct && w->xs == COLS && DC != NULL) {
-    /*_gotoxy(x - 1, y);*/
-    _gotoxy(x, y);
+    _draw();
+    _moveto(x, y);
     outstr(DC);
+    _memmove(fmap + y * COLS + x, fmap + y * COLS + x + 1, COLS - x - 1);
+    _unknown(fmap + y * COLS + COLS - 1, 1);
     doit = 0;
   }
 
   e = gmap + y * COLS + x + 1;
 
   for (; x < w->x2; x++) {
-    _write(e->value, doit && w->direct, x, y, e->attr, e->color);
+    _write(e->value, w->direct ? (doit ? 1 : 2) : 0, x, y, e->attr, e->color);
     e++;
   }
-  _write(' ', doit && w->direct, x, y, w->attr, w->color);
+  _write(' ', w->direct ? (doit ? 1 : 2) : 0, x, y, w->attr, w->color);
   mc_wlocate(w, w->curx, w->cury);
 }
 
@@ -1928,7 +2429,7 @@ int win_init(int fg, int bg, int attr)
   char *term;
 #endif
   static WIN _stdwin;
-  int f, olduseattr;
+  int f, y, olduseattr;
 
   if (w_init)
     return 0;
@@ -2058,6 +2559,8 @@ int win_init(int fg, int bg, int attr)
 
   _has_am = tgetflag("am");
   _mv_standout = tgetflag("ms");
+  _cmcost = 0;
+  tputs(tgoto(CM, COLS - 1, LINES - 1), 1, countchar);
   if (tgetflag("bs")) {
     if (BC == NULL)
       BC = "\b";
@@ -2102,10 +2605,17 @@ int win_init(int fg, int bg, int attr)
 
 
   /* Memory for global map */
-  if ((gmap = malloc(sizeof(ELM) * (LINES + 1) * COLS)) == NULL) {
+  if ((gmap = malloc(sizeof(ELM) * (LINES + 1) * COLS)) == NULL ||
+      (fmap = malloc(sizeof(ELM) * (LINES + 1) * COLS)) == NULL ||
+      (damage = malloc(sizeof(struct damage) * (LINES + 1))) == NULL) {
     fprintf(stderr, "Not enough memory\n");
     return -1;
   };
+  _unknown(fmap, (LINES + 1) * COLS);
+  for (y = 0; y <= LINES; y++) {
+    damage[y].x1 = COLS;
+    damage[y].x2 = -1;
+  }
   _buffend = _bufstart + BUFFERSIZE;
 
   /* Initialize stdwin */
@@ -2124,7 +2634,8 @@ int win_init(int fg, int bg, int attr)
   stdwin->attr     = attr;
   stdwin->color    = COLATTR(fg, bg);
   stdwin->direct   = 1;
-  stdwin->histbuf  = NULL;
+  stdwin->hist     = NULL;
+  stdwin->wrapped  = NULL;
 
   if (EA != NULL)
     outstr(EA);          /* Graphics init. */
@@ -2162,6 +2673,10 @@ void win_end(void)
   mc_wflush();
   free(gmap);
   gmap = NULL;
+  free(fmap);
+  fmap = NULL;
+  free(damage);
+  damage = NULL;
   stdwin = NULL;
   w_init = 0;
 }
@@ -53,11 +53,12 @@ typedef struct _win {
   char o_attr;
   char o_color;		/* Position & attributes before window was opened */
   ELM *map;		/* Map of contents */
-  ELM *histbuf;		/* History buffer. */
-  int histlines;	/* How many lines we keep in the history buffer */
-  int histline;		/* Current line in the history buffer. */
+  struct hist *hist;	/* Lines scrolled off the top, see history.c */
+  char *wrapped;	/* Rows whose text went on in the next one */
 } WIN;
 
+struct wsave;
+
 /*
  * Stdwin is the whole screen
  */
@@ -141,11 +142,16 @@ extern const char *J_col[]; /* Color's names */
  */
 
 int wxgetch(void);
+extern void (*wxgetch_wait)(void);
 
 void mc_wflush(void);
+int mc_wready(void);
+void mc_wdefer(int on);
 WIN *mc_wopen(int x1, int y1, int x2, int y2, int border,
-           int attr, int fg, int bg, int direct, int hl, int rel);
+           int attr, int fg, int bg, int direct, long histmem, int rel);
 void mc_wclose(WIN *win, int replace);
+struct wsave *mc_wsave(WIN *w);
+void mc_wrestore(WIN *w, struct wsave *s);
 void mc_wleave(void);
 void mc_wreturn(void);
 void mc_wresize(WIN *w, int x, int y);
@@ -154,7 +160,9 @@ void mc_wscroll(WIN *win, int dir);
 void mc_wlocate(WIN *win, int x, int y);
 void mc_wputc(WIN *win, wchar_t c);
 void mc_wdrawelm(WIN *win, int y, ELM *e);
+ELM *mc_wgetelm(WIN *win, int x, int y);
 void mc_wputs(WIN *win, const char *s);
+void mc_wputsn(WIN *win, const char *s, int len);
 int mc_wprintf(WIN *, const char *, ...)
         __attribute__((format(printf, 2, 3)));
 void mc_wbell(void);
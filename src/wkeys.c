@@ -44,6 +44,9 @@ static int gotalrm;
 int pendingkeys = 0;
 int io_pending = 0;
 
+/* If set, called instead of sleeping until a key can be read. */
+void (*wxgetch_wait)(void);
+
 #ifndef NCURSES_CONST
 #define NCURSES_CONST
 #endif
@@ -192,6 +195,9 @@ int wxgetch(void)
         break;
     }
 
+    if (len == 1 && keys_in_buf == 0 && wxgetch_wait)
+      wxgetch_wait();
+
 #if KEY_KLUDGE
     while ((nfound = cread(&c)) < 0 && (errno == EINTR && !gotalrm))
       ;